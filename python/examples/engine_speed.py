@@ -0,0 +1,29 @@
+# nanoseconds per update for each engine that orders a window, across window sizes and
+# a few kinds of signal. they all produce identical outputs, so speed is all that differs.
+
+import numpy as np
+import rolling_quantiles as rq
+import time
+
+length = 2_000_000
+signals = {
+  "noise": np.random.standard_normal(length),
+  "random walk": np.cumsum(np.random.standard_normal(length)),
+  "ramp": np.arange(length, dtype=np.float64),
+}
+
+def time_update(engine, window, x, repeats=3):
+  best = np.inf
+  for _ in range(repeats):
+    pipe = rq.Pipeline(rq.LowPass(window=window, portion=window//2, engine=engine))
+    start = time.perf_counter()
+    pipe.feed(x)
+    best = min(best, time.perf_counter() - start)
+  return 1e9 * best / len(x)
+
+for name, x in signals.items():
+  print(f"{name}:")
+  for window in [5, 31, 95, 1001, 100_001, 1_000_001]:
+    engines = ["sorted", "heap", "tree"] if window < 1000 else ["heap", "tree"]
+    timings = ", ".join(f"{engine} {time_update(engine, window, x):6.1f}" for engine in engines)
+    print(f"  window {window:9d}: {timings} ns/update")
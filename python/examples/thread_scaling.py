@@ -0,0 +1,31 @@
+# measure how the throughput of independent pipelines scales with the number of Python
+# threads feeding them. each thread owns its pipelines, and the GIL is released while the
+# native loop churns through an array, so the streams should proceed side by side.
+
+import numpy as np
+import rolling_quantiles as rq
+import time
+import os
+from concurrent.futures import ThreadPoolExecutor
+
+n_streams = 64
+chunk_length = 1_000_000
+window_size = 101
+
+chunks = [np.random.standard_normal(chunk_length) for _ in range(n_streams)]
+
+def run(n_threads):
+  pipes = [rq.Pipeline(rq.LowPass(window=window_size, quantile=0.5)) for _ in range(n_streams)]
+  start = time.perf_counter()
+  with ThreadPoolExecutor(max_workers=n_threads) as pool:
+    list(pool.map(lambda pair: pair[0].feed(pair[1]), zip(pipes, chunks)))
+  return time.perf_counter() - start
+
+baseline = None
+n_threads = 1
+while n_threads <= os.cpu_count():
+  elapsed = run(n_threads)
+  baseline = baseline or elapsed
+  throughput = n_streams * chunk_length / elapsed / 1e6
+  print(f"{n_threads:3d} threads: {throughput:8.2f} million samples per second, {baseline/elapsed:5.2f}x speedup")
+  n_threads *= 2
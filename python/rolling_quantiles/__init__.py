@@ -5,8 +5,8 @@ __version__ = "1.1.0"
 from .triton import *
 
 # expose a rolling-median convenience method as a direct replacement to scipy.signal.medfilt
-def medfilt(signal, window_size):
+def medfilt(signal, window_size, threads=1): # long signals may be split into chunks over several threads
   import numpy as np # don't pollute the top-level namespace
   pipeline = Pipeline(
     LowPass(window=window_size, quantile=0.5, subsample_rate=1))
-  return pipeline.feed(np.array(signal))
+  return pipeline.feed(np.array(signal), threads=threads)
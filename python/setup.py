@@ -17,7 +17,10 @@ os.makedirs("src", exist_ok=True)
 for file in source_files:
   shutil.copy(file, "src")
 
-ext_files = ["filter.c", "heap.c", "quantile.c", "python.c"] # cryptic errors all ove rthe place...
+ext_files = ["arena.c", "filter.c", "heap.c", "quantile.c", "tree.c", "sketch.c", "histogram.c", "parallel.c", "lanes.c", "stream.c", "python.c"] # cryptic errors all ove rthe place...
+thread_flags = [] if os.name == "nt" else ["-pthread"] # Win32 threads need no flag
+atomic_flags = ["/std:c11", "/experimental:c11atomics"] if os.name == "nt" else [] # MSVC only has <stdatomic.h> under these. see stream.h
+counter_macros = [("ROLLING_QUANTILES_COUNTERS", None)] if os.environ.get("ROLLING_QUANTILES_COUNTERS") else [] # for `Pipeline.stats`, at the cost of an add here and there
 
 setup(
   ext_package = "rolling_quantiles", # important to specify that triton's fully qualified name should be rolling_quantiles.triton
@@ -25,6 +28,8 @@ setup(
     Extension("triton", # does a triton/__init__.py need to exist as a placeholder marker for my extension module?
       [os.path.join("src", file) for file in ext_files],
       include_dirs = [np.get_include()],
-      extra_compile_args=["-O3"])
+      define_macros = counter_macros,
+      extra_compile_args=["-O3"] + thread_flags + atomic_flags,
+      extra_link_args=thread_flags)
   ]
 )
@@ -0,0 +1,38 @@
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def test_rank_error(window_size=100_000, length=600_000, error=0.01):
+  x = np.random.standard_cauchy(length) # heavy tails, so that values would mislead
+  for quantile in [0.05, 0.5, 0.9]:
+    pipe = rq.Pipeline(rq.ApproxLowPass(window=window_size, quantile=quantile, error=error))
+    y = pipe.feed(x)
+    for t in np.linspace(window_size, length-1, 25).astype(int):
+      present = np.sort(x[t-window_size+1 : t+1])
+      lower = np.searchsorted(present, y[t], side="left")
+      upper = np.searchsorted(present, y[t], side="right")
+      target = quantile * window_size
+      assert lower - error*window_size <= target <= upper + error*window_size
+
+def test_cascade_with_exact_stages(length=200_000):
+  x = example_input(length)
+  x[5000:6000] = np.nan
+  pipe = rq.Pipeline(
+    rq.LowPass(window=21, quantile=0.5),
+    rq.ApproxHighPass(window=2_000_000, quantile=0.5, error=0.02), # blocks of 10,000 entries
+    rq.LowPass(window=5, portion=2, subsample_rate=2))
+  y = pipe.feed(x)
+  assert y.shape == x.shape
+  assert np.isnan(y[:9999]).all() # until the first block fills
+  assert not np.isnan(y[-2:]).all()
+
+def test_approximate_guards():
+  with pytest.raises(ValueError):
+    rq.ApproxLowPass(window=1000) # needs a quantile
+  with pytest.raises(ValueError):
+    rq.ApproxLowPass(window=1000, quantile=0.5, error=1.5)
+  with pytest.raises(ValueError):
+    rq.LowPass(window=1000, quantile=0.5, error=0.01)
+  assert rq.ApproxLowPass(window=1000, quantile=0.5).error == 0.001
+  assert isinstance(rq.ApproxLowPass(window=1000, quantile=0.5), rq.LowPass)
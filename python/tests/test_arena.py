@@ -0,0 +1,22 @@
+import numpy as np
+import rolling_quantiles as rq
+from input import example_input
+
+def make_stages():
+  return (rq.LowPass(window=2001, portion=1000, subsample_rate=2), rq.HighPass(window=501, quantiles=[0.2, 0.8]))
+
+def test_large_bank_matches_lone_pipelines(n_channels=150, length=3000): # a pool past the size where huge pages kick in
+  x = np.stack([example_input(length) for _ in range(n_channels)])
+  x[::7, 1000:1300] = np.nan
+  y = rq.Pipeline(*make_stages(), channels=n_channels).feed(x)
+  for c in range(0, n_channels, 37):
+    assert np.array_equal(y[c], rq.Pipeline(*make_stages()).feed(x[c]), equal_nan=True)
+
+def test_channels_leave_the_pool_one_by_one(n_channels=5, length=2000):
+  x = (np.random.rand(n_channels, length) * 255).astype(np.uint8)
+  bank = rq.Pipeline(rq.LowPass(window=301, portion=150), channels=n_channels)
+  y = bank.feed(x) # quantized input swaps each channel for a counting twin, in turn
+  assert np.array_equal(y, np.stack([rq.Pipeline(rq.LowPass(window=301, portion=150)).feed(row) for row in x]))
+  twin = rq.Pipeline.from_bytes(bank.to_bytes())
+  del bank
+  assert np.array_equal(twin.feed(x), rq.Pipeline(rq.LowPass(window=301, portion=150), channels=n_channels).feed(np.concatenate([x, x], axis=1))[:, length:])
@@ -0,0 +1,33 @@
+import numpy as np
+import rolling_quantiles as rq
+from input import example_input
+
+def make_descriptions():
+  return (rq.LowPass(window=11, portion=5, subsample_rate=2),
+    rq.HighPass(window=7, quantile=0.3))
+
+def separately(x): # one channel per row
+  return np.stack([rq.Pipeline(*make_descriptions()).feed(row) for row in x])
+
+def test_matches_separate_pipelines(n_channels=37, length=3000):
+  x = np.stack([example_input(length) for _ in range(n_channels)])
+  bank = rq.Pipeline(*make_descriptions(), channels=n_channels, threads=4)
+  assert bank.channels == n_channels
+  y = bank.feed(x)
+  assert np.array_equal(y, separately(x), equal_nan=True)
+
+def test_strided_time_axis(n_channels=9, length=2000):
+  x = np.stack([example_input(2*length) for _ in range(n_channels)])
+  bank = rq.Pipeline(*make_descriptions(), channels=n_channels)
+  y = bank.feed(x.T[::2], axis=0) # time along the first axis, with a stride, and no copy
+  assert y.shape == (length, n_channels)
+  assert np.array_equal(y.T, separately(x[:, ::2]), equal_nan=True)
+
+def test_streaming_steps(n_channels=5, length=50):
+  x = np.stack([example_input(length) for _ in range(n_channels)])
+  bank = rq.Pipeline(rq.LowPass(window=5, quantiles=[0.2, 0.8]), channels=n_channels)
+  y = np.stack([bank.feed(x[:, t]) for t in range(length)], axis=1)
+  assert y.shape == (n_channels, length, 2)
+  for c in range(n_channels):
+    z = rq.Pipeline(rq.LowPass(window=5, quantiles=[0.2, 0.8])).feed(x[c])
+    assert np.array_equal(y[c], z, equal_nan=True)
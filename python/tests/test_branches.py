@@ -0,0 +1,56 @@
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def make_branches(): # a baseline, its residual, and that residual smoothed, off of one shared prefix
+  return (rq.LowPass(window=5, portion=2),
+    [rq.LowPass(window=201, quantile=0.5, tap=True)],
+    rq.HighPass(window=201, quantile=0.5, tap=True),
+    rq.LowPass(window=21, quantile=0.5, subsample_rate=3, tap=True))
+
+def test_matches_separate_pipelines(length=20_000):
+  x = example_input(length)
+  x[3000:3100] = np.nan
+  pipe = rq.Pipeline(*make_branches())
+  assert pipe.n_columns == 3 and pipe.stride == 3
+  y = pipe.feed(x)
+  assert y.shape == (length, 3)
+  separate = [rq.Pipeline(rq.LowPass(window=5, portion=2), rq.LowPass(window=201, quantile=0.5)),
+    rq.Pipeline(rq.LowPass(window=5, portion=2), rq.HighPass(window=201, quantile=0.5)),
+    rq.Pipeline(rq.LowPass(window=5, portion=2), rq.HighPass(window=201, quantile=0.5), rq.LowPass(window=21, quantile=0.5, subsample_rate=3))]
+  for column, other in enumerate(separate):
+    assert np.array_equal(y[:, column], other.feed(x), equal_nan=True)
+  streamed = np.array([pipe.feed(v) for v in x[:500]]) # one entry at a time yields a row apiece
+  assert np.array_equal(streamed, rq.Pipeline(*make_branches()).feed(np.concatenate([x, x[:500]]))[length:], equal_nan=True)
+
+def test_leaves_and_quantiles(length=5000):
+  x = example_input(length)
+  pipe = rq.Pipeline(rq.LowPass(window=9, portion=4), [rq.LowPass(window=51, quantiles=[0.1, 0.9])], rq.HighPass(window=31, portion=15))
+  assert pipe.n_columns == 3 # without taps, every stage that feeds no other reports
+  y = pipe.feed(x)
+  z = rq.Pipeline(rq.LowPass(window=9, portion=4), rq.LowPass(window=51, quantiles=[0.1, 0.9])).feed(x)
+  w = rq.Pipeline(rq.LowPass(window=9, portion=4), rq.HighPass(window=31, portion=15)).feed(x)
+  assert np.array_equal(y[:, :2], z, equal_nan=True) and np.array_equal(y[:, 2], w, equal_nan=True)
+  single = rq.Pipeline(rq.LowPass(window=9, portion=4, tap=True), rq.HighPass(window=31, portion=15))
+  assert single.n_columns == 0 # an intermediate tap alone still yields a flat series
+  assert np.array_equal(single.feed(x), rq.Pipeline(rq.LowPass(window=9, portion=4)).feed(x), equal_nan=True)
+
+def test_banks_threads_and_snapshots(length=50_000):
+  x = example_input(length)
+  y = rq.Pipeline(*make_branches()).feed(x)
+  assert np.array_equal(rq.Pipeline(*make_branches()).feed(x, threads=4), y, equal_nan=True)
+  bank = rq.Pipeline(*make_branches(), channels=2)
+  assert np.array_equal(bank.feed(np.stack([x, x]))[1], y, equal_nan=True)
+  pipe = rq.Pipeline(*make_branches())
+  pipe.feed(x[:1001])
+  twin = rq.Pipeline.from_bytes(pipe.to_bytes())
+  assert np.array_equal(twin.feed(x[1001:]), pipe.feed(x[1001:]), equal_nan=True)
+
+def test_branch_guards():
+  with pytest.raises(ValueError):
+    rq.Pipeline(rq.LowPass(window=9, quantiles=[0.1, 0.9]), rq.LowPass(window=5, portion=2)) # nothing may feed off of several quantiles
+  with pytest.raises(ValueError):
+    rq.Pipeline(rq.LowPass(window=9, quantiles=[0.1, 0.9]), rq.LowPass(window=5, portion=2, tap=True)) # nor may they go unreported
+  with pytest.raises(ValueError):
+    rq.Pipeline(rq.LowPass(window=9, portion=4), [rq.LowPass(window=5, portion=2)], rq.HighPass(window=5, portion=2)).feed(np.zeros(100), inplace=True)
@@ -0,0 +1,42 @@
+import numpy as np
+import scipy.signal
+import rolling_quantiles as rq
+from input import example_input
+
+def make_descriptions():
+  return (rq.LowPass(window=101, portion=50, subsample_rate=3),
+    rq.HighPass(window=17, quantile=0.3, subsample_rate=2),
+    rq.LowPass(window=9, quantiles=[0.1, 0.5, 0.9]))
+
+def test_matches_serial(length=200_000):
+  x = example_input(length)
+  x[1000:1300] = np.nan
+  head, tail = example_input(1001), example_input(5000)
+  serial = rq.Pipeline(*make_descriptions())
+  chunked = rq.Pipeline(*make_descriptions())
+  for pipe, threads in [(serial, 1), (chunked, 7)]: # an odd prelude puts the subsampling clocks out of phase
+    pipe.feed(head)
+  y = serial.feed(x)
+  z = chunked.feed(x, threads=7)
+  assert np.array_equal(y, z, equal_nan=True)
+  assert np.array_equal(serial.feed(tail), chunked.feed(tail), equal_nan=True) # the state carries on
+
+def test_lone_quantile_in_place(length=100_000):
+  x = example_input(length)
+  y = rq.Pipeline(rq.LowPass(window=30, quantile=0.7)).feed(x)
+  rq.Pipeline(rq.LowPass(window=30, quantile=0.7)).feed(x, threads=4, inplace=True)
+  assert np.array_equal(x, y, equal_nan=True)
+
+def test_one_column_of_quantiles(length=100_000): # a chain of width one
+  x = example_input(length)
+  y = rq.Pipeline(rq.LowPass(window=30, quantiles=[0.5])).feed(x)
+  z = rq.Pipeline(rq.LowPass(window=30, quantiles=[0.5])).feed(x, threads=4)
+  assert z.shape == (length, 1)
+  assert np.array_equal(y, z, equal_nan=True)
+
+def test_medfilt(window_size=51, length=300_000):
+  x = example_input(length)
+  y = rq.medfilt(x, window_size, threads=8)
+  z = scipy.signal.medfilt(x, window_size)
+  half = window_size // 2
+  assert np.array_equal(y[window_size-1:], z[half:-half])
@@ -0,0 +1,44 @@
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def make_cascade():
+  return rq.Pipeline(rq.LowPass(window=31, quantile=0.5, subsample_rate=4), rq.HighPass(window=11, portion=5, subsample_rate=25))
+
+def test_matches_slicing(length=20_011, split=7003):
+  x = example_input(length)
+  x[500:900] = np.nan
+  full = make_cascade().feed(x)
+  pipe = make_cascade()
+  assert pipe.stride == 100
+  y, i = pipe.feed(x[:split], compact=True, return_indices=True)
+  assert pipe.phase == split % 100 and i.dtype == np.intp
+  z, j = pipe.feed(x[split:], compact=True, return_indices=True) # the phase carries across calls
+  indices = np.concatenate([i, j + split])
+  assert np.array_equal(indices, np.arange(99, length, 100))
+  assert np.array_equal(np.concatenate([y, z]), full[99::100], equal_nan=True)
+  assert make_cascade().feed(x.astype(np.float32), compact=True).dtype == np.float32
+
+def test_branches_quantiles_and_time(length=5000):
+  x = example_input(length)
+  pipe = rq.Pipeline(rq.LowPass(window=9, portion=4, subsample_rate=2),
+    [rq.LowPass(window=21, quantiles=[0.2, 0.8], subsample_rate=5)], rq.HighPass(window=11, portion=5, subsample_rate=3))
+  full = pipe.feed(x)
+  pipe = rq.Pipeline(rq.LowPass(window=9, portion=4, subsample_rate=2),
+    [rq.LowPass(window=21, quantiles=[0.2, 0.8], subsample_rate=5)], rq.HighPass(window=11, portion=5, subsample_rate=3))
+  y, i = pipe.feed(x, compact=True, return_indices=True)
+  steps = np.arange(length)
+  assert np.array_equal(i, steps[((steps + 1) % 10 == 0) | ((steps + 1) % 6 == 0)]) # whenever any tap yields
+  assert np.array_equal(y, full[i], equal_nan=True)
+  t = np.arange(length, dtype=np.double)
+  timed = rq.Pipeline(rq.LowPass(duration=20.0, quantile=0.5, subsample_rate=7))
+  assert np.array_equal(timed.feed(x, t, compact=True), rq.Pipeline(rq.LowPass(duration=20.0, quantile=0.5, subsample_rate=7)).feed(x, t)[6::7])
+
+def test_compact_guards():
+  with pytest.raises(ValueError):
+    make_cascade().feed(np.zeros(100), compact=True, out=np.zeros(100))
+  with pytest.raises(ValueError):
+    make_cascade().feed(np.zeros(100), return_indices=True)
+  with pytest.raises(ValueError):
+    rq.Pipeline(rq.LowPass(window=5, portion=2), channels=2).feed(np.zeros((2, 10)), compact=True)
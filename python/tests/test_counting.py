@@ -0,0 +1,68 @@
+import pickle
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+
+def adc_counts(length, dtype=np.uint16, high=4095): # a wandering 12-bit signal
+  walk = 2000 + np.cumsum(np.random.randint(-20, 21, size=length))
+  return np.clip(walk, 0, high).astype(dtype)
+
+def test_integer_dtypes(window_size=5001, length=50_000):
+  for dtype in [np.uint8, np.int8, np.int16, np.uint16]:
+    info = np.iinfo(dtype)
+    x = adc_counts(length, dtype, high=info.max) + (info.min if info.min < 0 else 0)
+    x = x.astype(dtype)
+    make = lambda engine: rq.Pipeline(rq.LowPass(window=window_size, quantile=0.3, engine=engine),
+      rq.HighPass(window=11, portion=5))
+    y = make("auto").feed(x) # counted, by virtue of the dtype
+    z = make("heap").feed(x.astype(np.double))
+    assert np.array_equal(y, z, equal_nan=True)
+
+def test_declared_range(window_size=200, length=20_000):
+  x = adc_counts(length).astype(np.double)
+  x[1000:1400] = np.nan
+  counted = rq.LowPass(window=window_size, portion=60, value_range=(0, 4095))
+  assert counted.engine == "counting" and counted.value_range == (0, 4095)
+  y = rq.Pipeline(counted).feed(x)
+  z = rq.Pipeline(rq.LowPass(window=window_size, portion=60, engine="sorted")).feed(x)
+  assert np.array_equal(y, z, equal_nan=True)
+  bank = rq.Pipeline(rq.LowPass(window=window_size, quantile=0.5), channels=3)
+  w = bank.feed(np.stack([adc_counts(length, np.int16)] * 3))
+  assert np.array_equal(w[0], w[2], equal_nan=True)
+
+def test_counting_guards():
+  with pytest.raises(ValueError):
+    rq.LowPass(window=10, portion=3, engine="counting") # needs a range
+  with pytest.raises(ValueError):
+    rq.LowPass(window=10, portion=3, value_range=(5, 1))
+  with pytest.raises(ValueError):
+    rq.LowPass(window=10, portion=3, value_range=(0.5, 10))
+  with pytest.raises(ValueError):
+    rq.LowPass(window=10, portion=3, value_range=(0, 10), engine="tree")
+
+def test_later_feeds_keep_to_the_domain(window_size=5001, length=20_000):
+  x = adc_counts(length, np.int8, high=127)
+  pipe = rq.Pipeline(rq.LowPass(window=window_size, quantile=0.5))
+  y = pipe.feed(x) # counted from here on
+  with pytest.raises(ValueError):
+    pipe.feed(np.random.uniform(-1e6, 1e6, size=100)) # would have been clamped to the domain
+  with pytest.raises(ValueError):
+    pipe.feed(0.5)
+  with pytest.raises(ValueError):
+    pipe.feed(x.astype(np.int16)) # a wider type, whatever its values
+  z = pipe.feed(x[:100]) # still takes more of the same
+  assert pipe.feed(3) == pipe.clone().feed(np.array([3], dtype=np.int8))[0]
+  heap = rq.Pipeline(rq.LowPass(window=window_size, quantile=0.5, engine="heap"))
+  assert np.array_equal(np.concatenate([y, z]), heap.feed(np.concatenate([x, x[:100]]).astype(np.double)), equal_nan=True)
+
+def test_restored_pipelines_keep_to_the_domain(window_size=5001, length=20_000):
+  x = adc_counts(length, np.int8, high=127)
+  pipe = rq.Pipeline(rq.LowPass(window=window_size, quantile=0.5))
+  pipe.feed(x)
+  for restored in [pickle.loads(pickle.dumps(pipe)), rq.Pipeline.from_bytes(pipe.to_bytes()), pipe.clone()]:
+    with pytest.raises(ValueError):
+      restored.feed(np.full(400, 1e6))
+    assert np.array_equal(restored.feed(x[:100]), pipe.clone().feed(x[:100]), equal_nan=True)
+  declared = rq.Pipeline(rq.LowPass(window=200, portion=60, value_range=(0, 4095)))
+  declared.feed(adc_counts(1000).astype(np.double))
+  rq.Pipeline.from_bytes(declared.to_bytes()).feed(np.full(10, 0.5)) # declared ranges take whatever they are given
@@ -0,0 +1,48 @@
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def make_pipeline():
+  return rq.Pipeline(rq.LowPass(window=21, portion=7, subsample_rate=2), rq.HighPass(window=9, quantile=0.4))
+
+def test_single_precision(length=5000):
+  x = example_input(length).astype(np.float32)
+  y = make_pipeline().feed(x)
+  assert y.dtype == np.float32
+  z = make_pipeline().feed(x.astype(np.double))
+  assert np.array_equal(y, z.astype(np.float32), equal_nan=True)
+  assert make_pipeline().feed(x, dtype=np.double).dtype == np.double
+  strided = np.repeat(x, 2)[::2] # through the iterator instead
+  assert np.array_equal(make_pipeline().feed(strided), y, equal_nan=True)
+
+def test_integers(length=5000):
+  x = np.round(example_input(length) * 100)
+  z = make_pipeline().feed(x)
+  for dtype in [np.int16, np.int32, np.int64, np.uint32]:
+    y = make_pipeline().feed((x - x.min()).astype(dtype) if dtype == np.uint32 else x.astype(dtype))
+    assert y.dtype == np.double
+    if dtype != np.uint32:
+      assert np.array_equal(y, z, equal_nan=True)
+  assert make_pipeline().feed(x.astype(np.int32), dtype="float32").dtype == np.float32
+
+def test_single_precision_buffers(length=3000):
+  x = example_input(length)
+  expected = make_pipeline().feed(x).astype(np.float32)
+  out = np.empty(length, dtype=np.float32)
+  assert make_pipeline().feed(x, out=out) is out
+  assert np.array_equal(out, expected, equal_nan=True)
+  single = x.astype(np.float32)
+  make_pipeline().feed(single, inplace=True)
+  assert np.array_equal(single, make_pipeline().feed(x.astype(np.float32)), equal_nan=True)
+  chunked = make_pipeline().feed(x.astype(np.float32), threads=3)
+  assert chunked.dtype == np.float32 and np.array_equal(chunked, single, equal_nan=True)
+  with pytest.raises(ValueError):
+    make_pipeline().feed(x, dtype=np.int32)
+
+def test_bank_in_single_precision(length=1000):
+  x = example_input(3 * length).reshape(3, length).astype(np.float32)
+  bank = rq.Pipeline(rq.LowPass(window=21, portion=7, subsample_rate=2), rq.HighPass(window=9, quantile=0.4), channels=3)
+  y = bank.feed(x)
+  assert y.dtype == np.float32
+  assert np.array_equal(y[1], make_pipeline().feed(x[1]), equal_nan=True)
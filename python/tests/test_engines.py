@@ -0,0 +1,49 @@
+import numpy as np
+import rolling_quantiles as rq
+from input import example_input
+
+def compare_engines(length, make_descriptions):
+  x = example_input(length)
+  x[length//3 : length//3 + 50] = np.nan
+  outputs = [rq.Pipeline(*make_descriptions(engine)).feed(x) for engine in ["heap", "tree", "sorted"]]
+  for output in outputs[1:]:
+    assert np.array_equal(outputs[0], output, equal_nan=True) # exact equality
+
+def test_engines_agree(length=20000):
+  for window in [1, 2, 17, 64, 65, 1000]:
+    compare_engines(length, lambda engine: [rq.LowPass(window=window, portion=window//3, engine=engine)])
+    compare_engines(length, lambda engine: [
+      rq.HighPass(window=window, quantile=0.8, alpha=0.3, beta=0.3, subsample_rate=2, engine=engine),
+      rq.LowPass(window=11, portion=5, engine=engine)])
+
+def test_ties(length=20000, window=301):
+  x = np.floor(example_input(length) * 3) # heaps of duplicates
+  outputs = [rq.Pipeline(rq.LowPass(window=window, quantile=0.4, engine=engine)).feed(x)
+    for engine in ["heap", "tree", "sorted"]]
+  for output in outputs[1:]:
+    assert np.array_equal(outputs[0], output, equal_nan=True)
+
+def test_automatic_choice(length=5000):
+  x = example_input(length)
+  for window in [5, 96, 97]:
+    y = rq.Pipeline(rq.LowPass(window=window, quantile=0.3, alpha=0.5, beta=0.5)).feed(x)
+    z = rq.Pipeline(rq.LowPass(window=window, quantile=0.3, alpha=0.5, beta=0.5, engine="heap")).feed(x)
+    assert np.array_equal(y, z, equal_nan=True)
+
+def test_large_window(window=100001, length=300000):
+  x = example_input(length)
+  auto = rq.LowPass(window=window, portion=window//2)
+  assert auto.engine == "auto"
+  y = rq.Pipeline(auto).feed(x)
+  z = rq.Pipeline(rq.LowPass(window=window, portion=window//2, engine="heap")).feed(x)
+  assert np.array_equal(y, z, equal_nan=True) # the heaps used to overflow their rank at this size
+  assert y[-1] == np.median(x[-window:])
+
+def test_heap_arity(length=20000):
+  x = example_input(length)
+  x[1000:1100] = np.nan
+  for window in [2, 17, 1001]:
+    outputs = [rq.Pipeline(rq.LowPass(window=window, quantile=0.3, engine="heap", arity=arity)).feed(x)
+      for arity in [2, 4, 8]]
+    for output in outputs[1:]:
+      assert np.array_equal(outputs[0], output, equal_nan=True)
@@ -0,0 +1,56 @@
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def make_pipeline():
+  return rq.Pipeline(rq.LowPass(window=101, quantile=0.5, subsample_rate=3), rq.HighPass(window=21, portion=10))
+
+def test_matches_feed(tmp_path, length=100_000):
+  x = example_input(length)
+  source, destination = tmp_path / "x.f64", tmp_path / "y.f64"
+  x.tofile(source)
+  pipe = make_pipeline()
+  assert pipe.feed_file(source, destination, chunk=7777) == length # an odd chunk, to cross plenty of boundaries
+  y = np.fromfile(destination)
+  assert np.array_equal(y, make_pipeline().feed(x), equal_nan=True)
+  tail = example_input(1000) # carries on from where the file left off
+  reference = make_pipeline()
+  reference.feed(x)
+  assert np.array_equal(pipe.feed(tail), reference.feed(tail), equal_nan=True)
+
+def test_types_and_offsets(tmp_path, length=20_000):
+  x = np.round(example_input(length) * 1000)
+  header = b"sixteen byte hdr"
+  for dtype in [np.float32, np.int16, np.int64]:
+    source, destination = tmp_path / "x.bin", tmp_path / "y.bin"
+    with open(source, "wb") as f:
+      f.write(header)
+      f.write(x.astype(dtype).tobytes())
+      f.write(b"\0") # a stray byte that makes no whole entry
+    make_pipeline().feed_file(str(source), str(destination), dtype=dtype, offset=len(header))
+    output_type = np.float32 if dtype == np.float32 else np.double
+    y = np.fromfile(destination, dtype=output_type)
+    assert np.array_equal(y, make_pipeline().feed(x.astype(dtype)), equal_nan=True)
+  several = rq.Pipeline(rq.LowPass(window=31, quantiles=[0.2, 0.8]))
+  x.tofile(source)
+  several.feed_file(source, destination)
+  assert np.array_equal(np.fromfile(destination).reshape(-1, 2), rq.Pipeline(rq.LowPass(window=31, quantiles=[0.2, 0.8])).feed(x), equal_nan=True)
+  lone = rq.Pipeline(rq.LowPass(window=31, quantiles=[0.5])) # a chain of width one
+  lone.feed_file(source, destination)
+  assert np.array_equal(np.fromfile(destination), rq.Pipeline(rq.LowPass(window=31, quantile=0.5)).feed(x), equal_nan=True)
+
+def test_file_guards(tmp_path):
+  source = tmp_path / "x.f64"
+  np.zeros(10).tofile(source)
+  with pytest.raises(FileNotFoundError):
+    make_pipeline().feed_file(tmp_path / "missing", tmp_path / "y")
+  with pytest.raises(ValueError):
+    make_pipeline().feed_file(source, tmp_path / "y", dtype=">f8")
+  with pytest.raises(ValueError):
+    make_pipeline().feed_file(source, tmp_path / "y", dtype=np.complex128)
+  with pytest.raises(TypeError):
+    rq.Pipeline(rq.LowPass(window=5, portion=2), channels=2).feed_file(source, tmp_path / "y")
+  with pytest.raises(ValueError):
+    make_pipeline().feed_file(source, source) # would truncate it before reading
+  assert np.array_equal(np.fromfile(source), np.zeros(10))
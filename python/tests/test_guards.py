@@ -13,3 +13,17 @@ def test_interpolator_bounds():
   with pytest.raises(ValueError):
     rq.Pipeline(rq.LowPass(
       window=10, portion=2, subsample_rate=1, quantile=2.5))
+
+def test_quantiles_only_at_the_end():
+  with pytest.raises(ValueError):
+    rq.Pipeline(rq.LowPass(window=10, quantiles=[0.1, 0.9]), rq.LowPass(window=5))
+  with pytest.raises(ValueError):
+    rq.Pipeline(rq.LowPass(window=10, quantiles=[0.1, 1.5]))
+
+def test_unknown_engine():
+  with pytest.raises(ValueError):
+    rq.LowPass(window=3, portion=1, engine="skiplist")
+
+def test_heap_arity():
+  with pytest.raises(ValueError):
+    rq.Pipeline(rq.LowPass(window=10, portion=3, arity=3))
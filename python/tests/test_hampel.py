@@ -0,0 +1,68 @@
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def hampel_by_hand(x, window, k, scores=False): # over whatever the window holds so far, as every stage builds up
+  half = window // 2
+  outputs = np.empty(len(x))
+  for t in range(len(x)):
+    present = x[max(0, t-window+1):t+1]
+    present = np.sort(present[~np.isnan(present)])
+    middle = x[t-half] if t+1 >= window else x[(t+1)//2]
+    if len(present) == 0:
+      outputs[t] = np.nan if scores else middle
+      continue
+    rank = min((half * len(present)) // window, len(present) - 1)
+    median = present[rank]
+    deviation = 1.482602218505602 * np.sort(np.abs(present - median))[rank]
+    if scores:
+      with np.errstate(divide="ignore", invalid="ignore"): # NaN middles stay NaN
+        outputs[t] = 0.0 if middle == median else (middle - median) / deviation
+    else:
+      outputs[t] = median if abs(middle - median) > k * deviation else middle
+  return outputs
+
+def spiky_input(length):
+  x = example_input(length)
+  spikes = np.random.randint(0, length, length // 50)
+  x[spikes] += np.random.choice([-1e3, 1e3], len(spikes))
+  x[length//3:length//3+25] = np.nan
+  return x
+
+@pytest.mark.parametrize("window,engine", [(1, "auto"), (9, "auto"), (31, "sorted"), (31, "tree"), (1501, "auto")])
+def test_matches_by_hand(window, engine, length=4000):
+  x = spiky_input(length)
+  cleaned = rq.Pipeline(rq.Hampel(window, 2.5, engine=engine)).feed(x)
+  assert np.array_equal(cleaned, hampel_by_hand(x, window, 2.5), equal_nan=True)
+  scores = rq.Pipeline(rq.Hampel(window, scores=True, engine=engine)).feed(x)
+  assert np.allclose(scores, hampel_by_hand(x, window, 3.0, scores=True), equal_nan=True)
+
+def test_despikes_and_carries_on(length=5000):
+  x = np.sin(np.arange(length) / 50.0)
+  y = x.copy()
+  y[::97] += 10.0
+  cleaned = rq.Pipeline(rq.Hampel(21)).feed(y)[10:] # lagged by half the window
+  assert np.max(np.abs(cleaned[:-10] - x[:-20])) < 0.1
+  pipe = rq.Pipeline(rq.Hampel(21, subsample_rate=2), rq.LowPass(window=5, portion=2))
+  pipe.feed(y[:1234])
+  twin = rq.Pipeline.from_bytes(pipe.to_bytes())
+  assert np.array_equal(twin.feed(y[1234:]), pipe.feed(y[1234:]), equal_nan=True)
+  quantized = np.round(y * 10).astype(np.int16) # counted, past the sorted array's reach
+  assert np.array_equal(rq.Pipeline(rq.Hampel(1501)).feed(quantized), hampel_by_hand(quantized.astype(float), 1501, 3.0))
+
+def test_rejects():
+  for make in [lambda: rq.Hampel(20), lambda: rq.Hampel(21, -1.0), lambda: rq.Hampel(21, engine="heap")]:
+    with pytest.raises(ValueError):
+      make()
+
+def test_flat_windows(): # a spread of zero, whichever sign, leaves the score with the middle's, and zero on the median
+  for engine in ["sorted", "tree"]:
+    pipe = rq.Pipeline(rq.Hampel(3, scores=True, engine=engine))
+    assert pipe.feed(np.array([-0.0, -1.0, 0.0]))[2] == -np.inf
+    assert pipe.feed(np.array([0.0, 1.0, -0.0]))[2] == np.inf
+    assert np.array_equal(pipe.feed(np.array([-0.0, 0.0, 0.0, -0.0])), np.zeros(4))
+    flat = rq.Pipeline(rq.Hampel(5, scores=True, engine=engine)).feed(np.ones(50))
+    assert np.array_equal(flat, np.zeros(50))
+    quantized = rq.Pipeline(rq.Hampel(5, scores=True, engine=engine)).feed(np.array([1.0, 1, 2, 1, 1, 1, 1]))
+    assert np.array_equal(quantized[4:], [np.inf, 0.0, 0.0])
@@ -0,0 +1,45 @@
+import array
+import itertools
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def make_pipeline():
+  return rq.Pipeline(rq.LowPass(window=21, portion=10, subsample_rate=2), rq.HighPass(window=11, portion=5))
+
+def test_lists_and_generators(length=5555): # across several chunks, and not a multiple of them
+  x = example_input(length)
+  x[1000:1100] = np.nan
+  expected = make_pipeline().feed(x)
+  assert np.array_equal(make_pipeline().feed(x.tolist()), expected, equal_nan=True)
+  assert np.array_equal(make_pipeline().feed(tuple(x)), expected, equal_nan=True)
+  assert np.array_equal(make_pipeline().feed(v for v in x), expected, equal_nan=True) # no length to hint at
+  assert make_pipeline().feed([]).shape == (0,)
+  assert make_pipeline().feed(range(10), dtype=np.float32).dtype == np.float32
+  with pytest.raises(TypeError):
+    make_pipeline().feed([1.0, "two"])
+
+def test_lazily(length=3333):
+  x = example_input(length)
+  pipe = make_pipeline()
+  stream = pipe.feed(iter(x.tolist()), lazy=True)
+  head = list(itertools.islice(stream, 1500))
+  assert np.array_equal(head + list(stream), make_pipeline().feed(x), equal_nan=True)
+  endless = make_pipeline().feed(itertools.cycle([1.0, 2.0, 3.0]), lazy=True)
+  assert len(list(itertools.islice(endless, 5000))) == 5000
+  several = rq.Pipeline(rq.LowPass(window=5, quantiles=[0.2, 0.8]))
+  rows = list(several.feed(range(10), lazy=True))
+  assert np.array_equal(np.stack(rows), rq.Pipeline(rq.LowPass(window=5, quantiles=[0.2, 0.8])).feed(np.arange(10.0)))
+  with pytest.raises(ValueError):
+    make_pipeline().feed([1.0], lazy=True, compact=True)
+
+def test_buffers(length=4000):
+  x = example_input(length)
+  expected = make_pipeline().feed(x)
+  buffer = array.array("d", x)
+  assert np.array_equal(make_pipeline().feed(memoryview(buffer)), expected, equal_nan=True)
+  make_pipeline().feed(buffer, inplace=True)
+  assert np.array_equal(np.array(buffer), expected, equal_nan=True)
+  raw = bytes(np.random.randint(0, 256, length, dtype=np.uint8)) # read as unsigned bytes, so counted
+  assert np.array_equal(make_pipeline().feed(raw), make_pipeline().feed(np.frombuffer(raw, np.uint8)), equal_nan=True)
@@ -0,0 +1,31 @@
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def lone(filt, x): # each channel through its own pipeline, as a bank would have done before lanes
+  return np.stack([rq.Pipeline(filt()).feed(row) for row in x])
+
+@pytest.mark.parametrize("window", [1, 4, 9, 16, 17])
+def test_matches_lone_channels(window, n_channels=21, length=2000):
+  x = np.stack([example_input(length) for _ in range(n_channels)]) # not a multiple of the block
+  x[3, 100:150] = np.nan
+  x[5] = np.nan # a channel that never sees a thing
+  x[7, ::3] = 0.0
+  x[7, 1::3] = -0.0 # signed zeros must land in the same order
+  x[9, ::5] = np.nan
+  filt = lambda: rq.LowPass(window=window, portion=window // 3, subsample_rate=3)
+  bank = rq.Pipeline(filt(), channels=n_channels)
+  y = np.concatenate([bank.feed(x[:, :777]), bank.feed(x[:, 777:])], axis=1) # the state goes back to the channels in between
+  assert np.array_equal(y.view(np.int64), lone(filt, x).view(np.int64))
+
+def test_interpolation_and_threads(n_channels=50, length=3000):
+  x = np.stack([example_input(length) for _ in range(n_channels)])
+  x[::4, 1000:1010] = np.nan
+  filt = lambda: rq.LowPass(window=11, quantile=0.3, alpha=1, beta=1)
+  y = rq.Pipeline(filt(), channels=n_channels, threads=4).feed(x)
+  assert np.array_equal(y, lone(filt, x), equal_nan=True)
+  bank = rq.Pipeline(filt(), channels=n_channels)
+  bank.feed(x[:, :1234])
+  twin = rq.Pipeline.from_bytes(bank.to_bytes())
+  assert np.array_equal(twin.feed(x[:, 1234:]), y[:, 1234:], equal_nan=True)
@@ -0,0 +1,48 @@
+import numpy as np
+import rolling_quantiles as rq
+from input import example_input
+
+def test_matches_separate_pipelines(window_size=51, length=2000):
+  quantiles = [0.05, 0.5, 0.25, 0.95, 0.75] # deliberately out of order
+  pipe = rq.Pipeline(rq.LowPass(window=window_size, quantiles=quantiles))
+  assert pipe.n_quantiles == len(quantiles)
+  x = example_input(length)
+  x[300:400] = np.nan # make sure the shared window depletes identically
+  y = pipe.feed(x)
+  assert y.shape == (length, len(quantiles))
+  for i, q in enumerate(quantiles):
+    single = rq.Pipeline(rq.LowPass(window=window_size, quantile=q))
+    z = single.feed(x)
+    assert np.array_equal(y[:, i], z, equal_nan=True) # exact equality
+
+def test_cascaded_high_pass(window_size=20, length=500):
+  quantiles = [0.1, 0.9]
+  pipe = rq.Pipeline(
+    rq.LowPass(window=5, portion=2, subsample_rate=2),
+    rq.HighPass(window=window_size, quantiles=quantiles, alpha=0.5, beta=0.5))
+  x = example_input(length)
+  y = np.stack([pipe.feed(v) for v in x])
+  for i, q in enumerate(quantiles):
+    single = rq.Pipeline(
+      rq.LowPass(window=5, portion=2, subsample_rate=2),
+      rq.HighPass(window=window_size, quantile=q, alpha=0.5, beta=0.5))
+    assert np.array_equal(y[:, i], single.feed(x), equal_nan=True)
+
+def test_lone_quantile(window_size=5, length=300): # one column, through the same path as several
+  x = example_input(length)
+  pipe = rq.Pipeline(rq.LowPass(window=window_size, quantiles=[0.5]))
+  single = rq.Pipeline(rq.LowPass(window=window_size, quantile=0.5))
+  expected = single.feed(x)
+  assert np.array_equal(pipe.feed(x)[:, 0], expected, equal_nan=True)
+  pipe = rq.Pipeline(rq.LowPass(window=window_size, quantiles=[0.5]))
+  assert np.array_equal(pipe.feed(list(x))[:, 0], expected, equal_nan=True)
+  pipe = rq.Pipeline(rq.LowPass(window=window_size, quantiles=[0.5]))
+  y = np.stack([pipe.feed(v) for v in x])
+  assert np.array_equal(y[:, 0], expected, equal_nan=True)
+  cascaded = rq.Pipeline(
+    rq.LowPass(window=3, subsample_rate=2),
+    rq.HighPass(window=window_size, quantiles=[0.3], alpha=0.5, beta=0.5))
+  single = rq.Pipeline(
+    rq.LowPass(window=3, subsample_rate=2),
+    rq.HighPass(window=window_size, quantile=0.3, alpha=0.5, beta=0.5))
+  assert np.array_equal(cascaded.feed(x)[:, 0], single.feed(x), equal_nan=True)
@@ -0,0 +1,49 @@
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def make_pipeline():
+  return rq.Pipeline(rq.LowPass(window=21, quantile=0.3, subsample_rate=3), rq.HighPass(window=5, portion=2))
+
+def test_out_matches_allocation(length=3000, chunk=1000):
+  x = example_input(length)
+  expected = make_pipeline().feed(x)
+  pipe = make_pipeline()
+  buffer = np.empty(chunk)
+  for start in range(0, length, chunk): # the same buffer gets recycled
+    y = pipe.feed(x[start:start+chunk], out=buffer)
+    assert y is buffer
+    assert np.array_equal(buffer, expected[start:start+chunk], equal_nan=True)
+
+def test_inplace(length=1000):
+  x = example_input(length)
+  expected = make_pipeline().feed(x)
+  y = make_pipeline().feed(x, inplace=True)
+  assert y is x
+  assert np.array_equal(x, expected, equal_nan=True)
+
+def test_out_casts_input(length=500):
+  x = np.random.randint(-100, 100, size=length, dtype=np.int32)
+  out = np.empty(length)
+  make_pipeline().feed(x, out=out)
+  assert np.array_equal(out, make_pipeline().feed(x.astype(np.float64)), equal_nan=True)
+
+def test_several_quantiles_out(length=400):
+  x = example_input(length)
+  pipe = rq.Pipeline(rq.LowPass(window=15, quantiles=[0.25, 0.75]))
+  out = np.empty((length, 2))
+  pipe.feed(x, out=out)
+  expected = rq.Pipeline(rq.LowPass(window=15, quantiles=[0.25, 0.75])).feed(x)
+  assert np.array_equal(out, expected, equal_nan=True)
+
+def test_unfit_buffers(length=100):
+  x = example_input(length)
+  with pytest.raises(ValueError):
+    make_pipeline().feed(x, out=np.empty(length - 1))
+  with pytest.raises(ValueError):
+    make_pipeline().feed(x, out=np.empty(length, dtype=np.float16))
+  with pytest.raises(ValueError):
+    make_pipeline().feed(x, out=np.empty(2*length)[::2])
+  with pytest.raises(ValueError):
+    make_pipeline().feed(x.astype(np.int32), inplace=True)
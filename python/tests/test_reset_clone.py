@@ -0,0 +1,48 @@
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def make_stages(): # one of every kind of engine, branches included
+  return (rq.LowPass(window=21, portion=10, engine="heap"),
+    [rq.LowPass(window=51, quantiles=[0.1, 0.9], tap=True)],
+    rq.HighPass(window=33, portion=16, engine="tree", subsample_rate=2, tap=True),
+    [rq.ApproxLowPass(window=1000, quantile=0.5, error=0.05, tap=True)],
+    rq.LowPass(window=9, quantile=0.3, alpha=1, beta=1, tap=True))
+
+def test_reset_matches_fresh(length=5000):
+  x = example_input(length)
+  x[1000:1100] = np.nan
+  fresh = rq.Pipeline(*make_stages()).feed(x)
+  pipe = rq.Pipeline(*make_stages())
+  pipe.feed(example_input(3333))
+  pipe.reset()
+  assert np.array_equal(pipe.feed(x), fresh, equal_nan=True)
+  t = np.cumsum(np.random.rand(length))
+  timed = rq.Pipeline(rq.HighPass(duration=10.0, quantile=0.5))
+  first = timed.feed(x, t)
+  timed.reset()
+  assert np.array_equal(timed.feed(x, t), first, equal_nan=True)
+
+def test_clone_carries_on(length=6000, split=2345):
+  x = example_input(length)
+  pipe = rq.Pipeline(*make_stages())
+  pipe.feed(x[:split])
+  twin = pipe.clone()
+  assert type(twin) is type(pipe) and twin.n_columns == pipe.n_columns and twin.stride == pipe.stride
+  ahead = twin.feed(x[split:]) # the original must not notice
+  assert np.array_equal(pipe.feed(x[split:]), ahead, equal_nan=True)
+  assert np.array_equal(rq.Pipeline(*make_stages()).clone().feed(x), rq.Pipeline(*make_stages()).feed(x), equal_nan=True)
+
+def test_banks(n_channels=6, length=3000):
+  x = np.stack([example_input(length) for _ in range(n_channels)])
+  x8 = (np.random.rand(n_channels, length) * 255).astype(np.uint8)
+  for lowpass in [lambda: rq.LowPass(window=7, portion=3), lambda: rq.LowPass(window=301, portion=150)]: # the lanes, then counting on quantized input
+    data = x if lowpass().window < 100 else x8
+    bank = rq.Pipeline(lowpass(), channels=n_channels)
+    first = bank.feed(data[:, :1000])
+    twin = bank.clone()
+    assert twin.channels == n_channels
+    assert np.array_equal(twin.feed(data[:, 1000:]), bank.feed(data[:, 1000:]), equal_nan=True)
+    bank.reset()
+    assert np.array_equal(bank.feed(data[:, :1000]), first, equal_nan=True)
@@ -0,0 +1,53 @@
+import pickle
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def make_pipelines():
+  return [
+    rq.Pipeline(rq.LowPass(window=201, portion=80, subsample_rate=3), rq.HighPass(window=31, quantile=0.4)),
+    rq.Pipeline(rq.LowPass(window=50, quantile=0.5, engine="sorted"), rq.HighPass(window=500, portion=100, engine="tree")),
+    rq.Pipeline(rq.HighPass(window=301, quantile=0.3, arity=4), rq.LowPass(window=21, quantiles=[0.1, 0.5, 0.9])),
+    rq.Pipeline(rq.ApproxLowPass(window=100_000, quantile=0.5, error=0.01)),
+    rq.Pipeline(rq.LowPass(window=40, quantile=0.5, subsample_rate=2), channels=3),
+  ]
+
+def feed(pipe, x):
+  return pipe.feed(np.stack([x, -x, 2*x]) if pipe.channels > 0 else x)
+
+def test_round_trips(length=30_000):
+  head, tail = example_input(length), example_input(length)
+  head[100:400] = np.nan
+  for pipe in make_pipelines():
+    feed(pipe, head)
+    snapshot = pipe.to_bytes()
+    restored = rq.Pipeline.from_bytes(snapshot)
+    assert restored.to_bytes() == snapshot
+    unpickled = pickle.loads(pickle.dumps(pipe))
+    assert (restored.stride, restored.lag, restored.channels) == (pipe.stride, pipe.lag, pipe.channels)
+    expected = feed(pipe, tail)
+    assert np.array_equal(feed(restored, tail), expected, equal_nan=True)
+    assert np.array_equal(feed(unpickled, tail), expected, equal_nan=True)
+
+def test_timed_and_counted(length=5000):
+  t = np.cumsum(np.random.exponential(1.0, size=2*length))
+  x = example_input(2*length)
+  pipe = rq.Pipeline(rq.LowPass(duration=60.0, quantile=0.5))
+  pipe.feed(x[:length], t[:length])
+  restored = pickle.loads(pickle.dumps(pipe))
+  assert restored.timed
+  assert np.array_equal(restored.feed(x[length:], t[length:]), pipe.feed(x[length:], t[length:]), equal_nan=True)
+  counts = np.random.randint(0, 1000, size=2*length).astype(np.int16)
+  pipe = rq.Pipeline(rq.LowPass(window=1001, quantile=0.5))
+  pipe.feed(counts[:length])
+  restored = rq.Pipeline.from_bytes(pipe.to_bytes())
+  assert np.array_equal(restored.feed(counts[length:]), pipe.feed(counts[length:]))
+
+def test_malformed_snapshots():
+  pipe = make_pipelines()[0]
+  pipe.feed(example_input(1000))
+  snapshot = pipe.to_bytes()
+  for broken in [b"", snapshot[:-1], snapshot + b"\0", b"\0" * len(snapshot), snapshot[:4] + b"\x63" + snapshot[5:]]:
+    with pytest.raises(ValueError):
+      rq.Pipeline.from_bytes(broken)
@@ -0,0 +1,34 @@
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def counted(pipe): # operation counters are compiled out unless built with ROLLING_QUANTILES_COUNTERS set
+  if pipe.stats is None:
+    pytest.skip("built without operation counters")
+  return pipe.stats
+
+def test_stages(length=10_000):
+  pipe = rq.Pipeline(rq.LowPass(window=101, quantile=0.5, subsample_rate=4), rq.HighPass(window=31, portion=15))
+  stats = counted(pipe)
+  assert len(stats) == 2 and all(count == 0 for stage in stats for count in stage.values())
+  pipe.feed(example_input(length))
+  low, high = pipe.stats
+  assert low["updates"] == length and high["updates"] == length // 4
+  assert low["rebalances"] == low["updates"] - 1 # once per update, save for the very first
+  assert high["swaps"] == 0 # a window this short goes to the sorted array, which keeps no heaps
+  assert low["swaps"] > 0 and low["sift_up_steps"] + low["sift_down_steps"] > 0
+  assert low["left_expiries"] + low["right_expiries"] + low["current_expiries"] == length - 101
+  assert 1 <= low["deepest_rebalance"] <= 2
+
+def test_resets_and_channels(length=1000):
+  x = example_input(length)
+  x[500:600] = np.nan # long enough to empty the window
+  pipe = rq.Pipeline(rq.LowPass(window=21, quantile=0.5, engine="heap"))
+  counted(pipe)
+  pipe.feed(x)
+  assert pipe.stats[0]["resets"] == 1
+  bank = rq.Pipeline(rq.LowPass(window=21, quantile=0.5, engine="heap"), channels=3)
+  bank.feed(np.stack([x, x, x]))
+  (stage,) = bank.stats
+  assert stage["updates"] == 3 * length and stage["resets"] == 3
@@ -0,0 +1,13 @@
+import numpy as np
+from concurrent.futures import ThreadPoolExecutor
+import rolling_quantiles as rq
+from input import example_input
+
+def test_concurrent_pipelines(n_streams=8, length=20000):
+  streams = [example_input(length) for _ in range(n_streams)]
+  pipes = [rq.Pipeline(rq.LowPass(window=31, quantile=0.5)) for _ in range(n_streams)]
+  with ThreadPoolExecutor(max_workers=4) as pool: # each stream owns its pipeline
+    outputs = list(pool.map(lambda pair: pair[0].feed(pair[1]), zip(pipes, streams)))
+  for x, y in zip(streams, outputs):
+    z = rq.Pipeline(rq.LowPass(window=31, quantile=0.5)).feed(x)
+    assert np.array_equal(y, z, equal_nan=True)
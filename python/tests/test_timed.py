@@ -0,0 +1,59 @@
+import numpy as np
+import pandas as pd
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def irregular_timestamps(length, mean_gap=1.0):
+  return np.cumsum(np.random.exponential(mean_gap, size=length))
+
+def test_against_pandas(length=5000, duration=60.0):
+  x = example_input(length)
+  t = irregular_timestamps(length)
+  for quantile in [0.0, 0.3, 0.5, 0.95]:
+    pipe = rq.Pipeline(rq.LowPass(duration=duration, quantile=quantile))
+    assert pipe.timed and np.isnan(pipe.lag)
+    y = pipe.feed(x, t)
+    index = pd.to_datetime(t, unit="s")
+    z = pd.Series(x, index=index).rolling(f"{duration}s").quantile(quantile, interpolation="linear")
+    assert np.allclose(y, z.values, rtol=0, atol=1e-12)
+
+def test_regular_samples(window_size=25, length=2000):
+  x = example_input(length)
+  t = np.arange(length, dtype=np.double)
+  timed = rq.Pipeline(rq.LowPass(duration=window_size, quantile=0.4), rq.HighPass(duration=9, quantile=0.5))
+  counted = rq.Pipeline(rq.LowPass(window=window_size, quantile=0.4), rq.HighPass(window=9, quantile=0.5))
+  y = timed.feed(x, t)
+  z = counted.feed(x)
+  warmup = window_size + 9
+  assert np.equal(y[warmup:], z[warmup:]).all()
+
+def test_streaming_and_gaps(length=1000):
+  x = example_input(length)
+  x[100:150] = np.nan
+  t = irregular_timestamps(length, mean_gap=0.2)
+  t[500:] += 100.0 # a long silence empties the window
+  batch = rq.Pipeline(rq.LowPass(duration=10.0, quantile=0.5)).feed(x, t)
+  pipe = rq.Pipeline(rq.LowPass(duration=10.0, quantile=0.5))
+  streamed = np.array([pipe.feed(v, s) for v, s in zip(x, t)])
+  assert np.array_equal(batch, streamed, equal_nan=True)
+  assert not np.isnan(batch[500]) # the fresh entry alone makes up the window
+  out = np.empty(length)
+  pipe = rq.Pipeline(rq.LowPass(duration=10.0, quantile=0.5))
+  assert pipe.feed(x, t, out=out) is out
+  assert np.array_equal(out, batch, equal_nan=True)
+
+def test_timed_guards():
+  with pytest.raises(ValueError):
+    rq.LowPass(duration=10.0) # needs a quantile
+  with pytest.raises(ValueError):
+    rq.LowPass(duration=10.0, window=5, quantile=0.5)
+  with pytest.raises(ValueError):
+    rq.LowPass(duration=-1.0, quantile=0.5)
+  pipe = rq.Pipeline(rq.LowPass(duration=10.0, quantile=0.5))
+  with pytest.raises(TypeError):
+    pipe.feed(np.zeros(10)) # missing timestamps
+  with pytest.raises(ValueError):
+    pipe.feed(np.zeros(10), np.zeros(9))
+  with pytest.raises(TypeError):
+    rq.Pipeline(rq.LowPass(window=5, portion=2)).feed(np.zeros(10), np.zeros(10))
@@ -0,0 +1,70 @@
+import threading
+import numpy as np
+import pytest
+import rolling_quantiles as rq
+from input import example_input
+
+def make_pipeline():
+  return rq.Pipeline(rq.LowPass(window=21, portion=10, subsample_rate=2), rq.HighPass(window=11, portion=5))
+
+def test_push_and_poll(length=20000):
+  x = example_input(length)
+  x[1000:1100] = np.nan
+  pipe = make_pipeline()
+  outputs = []
+  with pipe.start_worker(capacity=1000) as worker: # small enough to push back
+    with pytest.raises(RuntimeError):
+      pipe.feed(1.0)
+    taken = 0
+    while taken < length:
+      n = worker.push(x[taken:taken+300])
+      taken += n
+      outputs.append(worker.poll(wait=(n < 300)))
+    for value in x[:10]: # a sample at a time
+      assert worker.push(value) == 1
+    outputs.append(worker.poll(wait=True))
+    stats = worker.stats
+  assert stats["pushed"] == stats["filtered"] == stats["polled"] == length + 10
+  assert stats["turned_away"] > 0 and stats["peak_backlog"] <= 1024
+  expected = make_pipeline().feed(np.concatenate([x, x[:10]]))
+  assert np.array_equal(np.concatenate(outputs), expected, equal_nan=True)
+  assert np.array_equal(pipe.feed(x), make_pipeline().feed(np.concatenate([x, x[:10], x]))[length+10:], equal_nan=True) # handed back, state and all
+
+def test_producer_and_consumer_threads(length=50000):
+  x = example_input(length)
+  worker = make_pipeline().start_worker(capacity=512)
+  chunks = []
+  def consume():
+    n_polled = 0
+    while n_polled < length:
+      chunks.append(worker.poll(wait=True))
+      n_polled += len(chunks[-1])
+  consumer = threading.Thread(target=consume)
+  consumer.start()
+  for start in range(0, length, 16):
+    taken = 0
+    while taken < len(x[start:start+16]):
+      taken += worker.push(x[start+taken:start+16])
+  consumer.join()
+  worker.close()
+  assert np.array_equal(np.concatenate(chunks), make_pipeline().feed(x), equal_nan=True)
+
+def test_timed_and_several(length=3000):
+  x = example_input(length)
+  t = np.cumsum(np.random.rand(length))
+  worker = rq.Pipeline(rq.HighPass(duration=10.0, quantile=0.5)).start_worker()
+  assert worker.push(x, t) == length
+  assert np.array_equal(worker.poll(wait=True), rq.Pipeline(rq.HighPass(duration=10.0, quantile=0.5)).feed(x, t), equal_nan=True)
+  worker.close()
+  with pytest.raises(ValueError):
+    worker.push(1.0)
+  several = rq.Pipeline(rq.LowPass(window=5, quantiles=[0.2, 0.8])).start_worker()
+  several.push(x)
+  assert several.poll(wait=True).shape == (length, 2)
+  several.close()
+  lone = rq.Pipeline(rq.LowPass(window=5, quantiles=[0.5])).start_worker() # a chain of width one
+  lone.push(x)
+  assert np.array_equal(lone.poll(wait=True), rq.Pipeline(rq.LowPass(window=5, quantiles=[0.5])).feed(x), equal_nan=True)
+  lone.close()
+  with pytest.raises(ValueError):
+    rq.Pipeline(rq.LowPass(window=5, portion=2), channels=3).start_worker()
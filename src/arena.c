@@ -0,0 +1,118 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE // for MAP_ANONYMOUS and madvise, which a strict -std=c11 hides
+#endif
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+size_t align_to_cache_line(size_t size) {
+  return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+static char* map_huge_pages(size_t length) { // aligned to a huge page, since the kernel only backs whole aligned ones
+  size_t padded = length + HUGE_PAGE_SIZE;
+  char* mapping = mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED)
+    return NULL;
+  char* start = (char*)(((uintptr_t)mapping + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+  if (start > mapping)
+    munmap(mapping, (size_t)(start - mapping));
+  size_t tail = (size_t)(mapping + padded - (start + length));
+  if (tail > 0)
+    munmap(start + length, tail);
+  madvise(start, length, MADV_HUGEPAGE); // merely a hint, and harmless if the system declines
+  return start;
+}
+#endif
+
+struct arena* open_arena(size_t capacity, unsigned n_tenants) {
+  size_t header = align_to_cache_line(sizeof(struct arena));
+  capacity = align_to_cache_line(capacity);
+  size_t length = header + capacity;
+  char* block = NULL;
+  size_t mapped = 0;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (length >= HUGE_PAGE_SIZE) {
+    mapped = (length + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    block = map_huge_pages(mapped); // comes zeroed
+    if (block == NULL)
+      mapped = 0;
+  }
+#endif
+  if (block == NULL) {
+#ifdef _WIN32
+    block = _aligned_malloc(length, ARENA_ALIGNMENT);
+#else
+    if (posix_memalign((void**)&block, ARENA_ALIGNMENT, length) != 0)
+      block = NULL;
+#endif
+    if (block == NULL)
+      return NULL;
+    memset(block, 0, length);
+  }
+  struct arena* arena = (struct arena*)block;
+  arena->memory = block + header;
+  arena->capacity = capacity;
+  arena->used = 0;
+  arena->mapped = mapped;
+  arena->n_tenants = n_tenants;
+  return arena;
+}
+
+void* allocate_within(struct arena* arena, size_t size) {
+  if (arena == NULL)
+    return malloc(size);
+  size = align_to_cache_line(size);
+  if (size > arena->capacity - arena->used)
+    return NULL; // the footprint was measured wrong
+  void* block = arena->memory + arena->used;
+  arena->used += size;
+  return block;
+}
+
+void release_within(struct arena* arena, void* block) {
+  if (arena == NULL)
+    free(block);
+}
+
+void leave_arena(struct arena* arena) {
+  if (--arena->n_tenants > 0)
+    return;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (arena->mapped > 0) {
+    munmap(arena, arena->mapped);
+    return;
+  }
+#endif
+#ifdef _WIN32
+  _aligned_free(arena);
+#else
+  free(arena);
+#endif
+}
@@ -0,0 +1,54 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+  One block of memory that every fixed-size piece of a pipeline is carved out of in turn,
+  so that its heaps, queues, and buffers sit next to each other rather than wherever
+  malloc found room, each on a cache line of its own. The footprint is measured up front
+  from the descriptions, so the arena never grows. Large ones are mapped onto huge pages
+  where the system offers them (transparent huge pages on Linux), which spares the TLB on
+  long windows and big banks. Several pipelines may share one arena as its tenants, in
+  which case the last to leave closes it. Structures that grow as they go, like the
+  order-statistic tree and the ring of a timed window, keep to malloc.
+
+  Every function that takes an arena falls back to plain malloc and free when it is NULL,
+  so that the pieces may still be made on their own.
+ */
+
+#define ARENA_ALIGNMENT 64 // a cache line
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+struct arena {
+  char* memory; // right past this header, aligned
+  size_t capacity;
+  size_t used;
+  size_t mapped; // length of the huge-page mapping this lives in, if any
+  unsigned n_tenants;
+};
+
+size_t align_to_cache_line(size_t size);
+struct arena* open_arena(size_t capacity, unsigned n_tenants); // zeroed. NULL if the memory could not be had
+void* allocate_within(struct arena* arena, size_t size); // cache-line-aligned when carved
+void release_within(struct arena* arena, void* block); // only frees what was not carved
+void leave_arena(struct arena* arena); // closes it once no tenant is left
+
+#endif
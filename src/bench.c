@@ -0,0 +1,265 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+
+#include "filter.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/*
+  A sweep of pipelines over a handful of signals, printed as one JSON document. Samples are
+  timed in batches, since reading the clock around every update costs about as much as the
+  update itself, and the spread across batches gives the percentiles. Each pipeline first
+  warms up on as many samples as it remembers, so that only the steady state is timed.
+
+    make bench && ./bench --samples 1000000 > bench.json
+
+  Built with `make COUNTERS=1 bench`, each result also says how many sifts, swaps, and so on
+  the timed samples took on average, which is the likeliest explanation for any outlier.
+ */
+
+#define BATCH_LENGTH 256
+#define PI 3.14159265358979323846 // M_PI is not standard C
+#define MAX_STAGES 3
+
+enum signal_kind {
+  WHITE_NOISE, BROWNIAN_MOTION, LEVY_FLIGHT, SORTED_RAMP, CONSTANT, GAPPED_NOISE, N_SIGNAL_KINDS
+};
+
+static const char* signal_names[] = {
+  "white_noise", "brownian_motion", "levy_flight", "sorted", "constant", "nan_gapped"
+};
+
+static const char* engine_names[] = { "automatic", "heap", "tree", "sorted", "counting" }; // as in `enum quantile_engine`
+
+static unsigned long long random_state = 0x9E3779B97F4A7C15ull;
+
+static double draw_uniform(void) { // xorshift64*, so that every run sees the same signals on every platform
+  random_state ^= random_state >> 12;
+  random_state ^= random_state << 25;
+  random_state ^= random_state >> 27;
+  return (double)((random_state * 0x2545F4914F6CDD1Dull) >> 11) * 0x1.0p-53;
+}
+
+static double draw_gaussian(void) { // Box-Muller, wasting half of it
+  double u = draw_uniform(), v = draw_uniform();
+  return sqrt(-2.0 * log(1.0 - u)) * cos(2.0 * PI * v);
+}
+
+static double* generate_signal(enum signal_kind kind, size_t length) {
+  double* signal = malloc(length * sizeof(double));
+  double level = 0.0;
+  size_t gap_left = 0;
+  for (size_t t = 0; t < length; t += 1) {
+    switch (kind) {
+      case WHITE_NOISE: signal[t] = draw_gaussian(); break;
+      case BROWNIAN_MOTION: signal[t] = (level += draw_gaussian()); break;
+      case LEVY_FLIGHT: signal[t] = (level += tan(PI * (draw_uniform() - 0.5))); break; // Cauchy steps, which now and then leap far away
+      case SORTED_RAMP: signal[t] = (double)t; break;
+      case CONSTANT: signal[t] = 1.0; break;
+      case GAPPED_NOISE: // bursts of missing values, a tenth of them in all
+        if ((gap_left == 0) && (draw_uniform() < 0.001))
+          gap_left = 1 + (size_t)(200.0 * draw_uniform());
+        signal[t] = (gap_left > 0)? NAN : draw_gaussian();
+        gap_left -= (gap_left > 0);
+        break;
+      default: signal[t] = 0.0;
+    }
+  }
+  return signal;
+}
+
+struct benchmark_case {
+  const char* shape;
+  unsigned n_stages;
+  struct cascade_description stages[MAX_STAGES];
+};
+
+static double read_clock(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return 1e9 * (double)now.tv_sec + (double)now.tv_nsec;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+static void print_number(const char* format, double value) { // JSON has no NaN
+  if (isnan(value))
+    printf("null");
+  else
+    printf(format, value);
+}
+
+static double sink = 0.0; // so that no output is optimized away
+
+static struct operation_counters tally_pipeline_operations(struct filter_pipeline* pipeline) {
+  struct operation_counters sums = {0};
+  for (unsigned i = 0; i < pipeline->n_filters; i += 1)
+    tally_stage_operations(pipeline->filters + i, &sums);
+  return sums;
+}
+
+static void print_operations_per_sample(struct operation_counters* before, struct operation_counters* after, size_t n_samples) {
+  printf(", \"operations_per_sample\": {");
+  const char* separator = "";
+#define PRINT_OPERATIONS_PER_SAMPLE(name) \
+  if (strcmp(#name, "deepest_rebalance") == 0) /* a maximum rather than a count, so it stays as is */ \
+    printf("%s\"%s\": %llu", separator, #name, after->name); \
+  else \
+    printf("%s\"%s\": %.4f", separator, #name, (double)(after->name - before->name) / (double)n_samples); \
+  separator = ", ";
+  OPERATION_COUNTERS(PRINT_OPERATIONS_PER_SAMPLE)
+#undef PRINT_OPERATIONS_PER_SAMPLE
+  printf("}");
+}
+
+static void run_case(struct benchmark_case* bench, enum signal_kind kind, const double* signal, size_t n_samples, bool* first) {
+  struct filter_pipeline* pipeline = create_filter_pipeline(bench->n_stages, bench->stages);
+  if (pipeline == NULL)
+    return;
+  size_t warm_up = measure_pipeline_memory(pipeline);
+  double* outputs = malloc(pipeline->width * sizeof(double));
+  for (size_t t = 0; t < warm_up; t += 1) {
+    feed_filter_pipeline_into(pipeline, signal[t], outputs);
+    sink += outputs[0];
+  }
+  size_t n_batches = n_samples / BATCH_LENGTH;
+  double* timings = malloc(n_batches * sizeof(double));
+  const double* timed = signal + warm_up;
+  double total = 0.0;
+  struct operation_counters before = tally_pipeline_operations(pipeline);
+  for (size_t b = 0; b < n_batches; b += 1) {
+    double begin = read_clock();
+    if (pipeline->width == 1) {
+      for (size_t t = b * BATCH_LENGTH; t < (b+1) * BATCH_LENGTH; t += 1)
+        sink += feed_filter_pipeline(pipeline, timed[t]);
+    } else {
+      for (size_t t = b * BATCH_LENGTH; t < (b+1) * BATCH_LENGTH; t += 1) {
+        feed_filter_pipeline_into(pipeline, timed[t], outputs);
+        sink += outputs[0];
+      }
+    }
+    timings[b] = (read_clock() - begin) / BATCH_LENGTH;
+    total += timings[b];
+  }
+  struct operation_counters after = tally_pipeline_operations(pipeline);
+  qsort(timings, n_batches, sizeof(double), compare_doubles);
+  struct cascade_description* first_stage = bench->stages;
+  unsigned stride = measure_pipeline_stride(pipeline);
+  printf("%s\n    {\"signal\": \"%s\", \"shape\": \"%s\", \"stages\": %u, \"engine\": \"%s\", \"window\": %u, \"quantile\": ",
+    *first? "" : ",", signal_names[kind], bench->shape, bench->n_stages,
+    (pipeline->filters[0].chain != NULL)? "chain" : engine_names[pipeline->filters[0].monitor.engine], first_stage->window);
+  print_number("%g", first_stage->interpolation.target_quantile); // null for several at once
+  printf(", \"subsample_rate\": %u, \"stride\": %u, \"samples\": %zu, \"ns_per_sample\": "
+    "{\"mean\": %.2f, \"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f}",
+    first_stage->subsample_rate, stride, n_batches * BATCH_LENGTH,
+    total / n_batches, timings[n_batches / 2], timings[n_batches * 9 / 10], timings[n_batches * 99 / 100], timings[n_batches - 1]);
+  if (COUNTERS_ENABLED)
+    print_operations_per_sample(&before, &after, n_batches * BATCH_LENGTH);
+  printf("}");
+  *first = false;
+  fflush(stdout);
+  free(timings);
+  free(outputs);
+  destroy_filter_pipeline(pipeline);
+}
+
+static struct cascade_description describe_stage(unsigned window, double quantile, unsigned subsample_rate, enum cascade_mode mode, enum quantile_engine engine) {
+  return (struct cascade_description) {
+    .window = window,
+    .interpolation = { .target_quantile = quantile, .alpha = 1.0, .beta = 1.0 },
+    .subsample_rate = subsample_rate,
+    .mode = mode,
+    .engine = engine,
+  };
+}
+
+static unsigned plan_cases(struct benchmark_case* cases, bool quick) {
+  static const unsigned windows[] = { 5, 31, 95, 1001, 100001 };
+  static const double quantiles[] = { 0.05, 0.5, 0.95 };
+  static const unsigned rates[] = { 1, 4, 16 };
+  static double several[] = { 0.1, 0.5, 0.9 };
+  unsigned n_cases = 0;
+  unsigned n_windows = quick? 4 : sizeof(windows) / sizeof(unsigned);
+  for (unsigned w = 0; w < n_windows; w += 1) { // every engine that can take the window, at the median
+    for (enum quantile_engine engine = HEAP_ENGINE; engine <= SORTED_ENGINE; engine += 1) {
+      if ((engine == SORTED_ENGINE) && (windows[w] > 4 * SORTED_ENGINE_THRESHOLD))
+        continue;
+      cases[n_cases++] = (struct benchmark_case) { "window_sweep", 1, { describe_stage(windows[w], 0.5, 1, LOW_PASS, engine) } };
+    }
+  }
+  for (unsigned q = 0; q < sizeof(quantiles) / sizeof(double); q += 1)
+    cases[n_cases++] = (struct benchmark_case) { "quantile_sweep", 1, { describe_stage(1001, quantiles[q], 1, LOW_PASS, AUTOMATIC_ENGINE) } };
+  for (unsigned r = 0; r < sizeof(rates) / sizeof(unsigned); r += 1)
+    cases[n_cases++] = (struct benchmark_case) { "subsample_sweep", 1, { describe_stage(1001, 0.5, rates[r], LOW_PASS, AUTOMATIC_ENGINE) } };
+  cases[n_cases++] = (struct benchmark_case) { "low_then_high_pass", 2, {
+    describe_stage(1001, 0.5, 1, LOW_PASS, AUTOMATIC_ENGINE), describe_stage(31, 0.5, 1, HIGH_PASS, AUTOMATIC_ENGINE) } };
+  cases[n_cases++] = (struct benchmark_case) { "decimating_cascade", 3, {
+    describe_stage(101, 0.5, 4, LOW_PASS, AUTOMATIC_ENGINE), describe_stage(301, 0.5, 4, LOW_PASS, AUTOMATIC_ENGINE),
+    describe_stage(1001, 0.3, 1, HIGH_PASS, AUTOMATIC_ENGINE) } };
+  struct cascade_description chain = describe_stage(1001, NAN, 1, LOW_PASS, AUTOMATIC_ENGINE);
+  chain.n_quantiles = 3;
+  chain.quantiles = several;
+  cases[n_cases++] = (struct benchmark_case) { "several_quantiles", 1, { chain } };
+  return n_cases;
+}
+
+int main(int argc, char** argv) {
+  size_t n_samples = 1000000;
+  bool quick = false;
+  for (int i = 1; i < argc; i += 1) {
+    if ((strcmp(argv[i], "--samples") == 0) && (i + 1 < argc)) {
+      n_samples = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--quick") == 0) {
+      quick = true;
+      n_samples = 100000;
+    } else {
+      fprintf(stderr, "usage: %s [--samples N] [--quick]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (n_samples < BATCH_LENGTH)
+    n_samples = BATCH_LENGTH;
+  struct benchmark_case cases[64];
+  unsigned n_cases = plan_cases(cases, quick);
+  size_t longest_memory = 0;
+  for (unsigned c = 0; c < n_cases; c += 1) {
+    size_t memory = 0, stride = 1;
+    for (unsigned i = 0; i < cases[c].n_stages; i += 1) {
+      memory += cases[c].stages[i].window * stride;
+      stride *= cases[c].stages[i].subsample_rate;
+    }
+    if (memory > longest_memory)
+      longest_memory = memory;
+  }
+  printf("{\n  \"benchmark\": \"rolling_quantiles\",\n  \"batch_length\": %d,\n  \"results\": [", BATCH_LENGTH);
+  bool first = true;
+  for (enum signal_kind kind = 0; kind < N_SIGNAL_KINDS; kind += 1) {
+    double* signal = generate_signal(kind, longest_memory + n_samples);
+    for (unsigned c = 0; c < n_cases; c += 1)
+      run_case(cases + c, kind, signal, n_samples, &first);
+    free(signal);
+  }
+  printf("\n  ]\n}\n");
+  return (sink == 12345.678); // practically always zero
+}
@@ -0,0 +1,58 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+/*
+  Optional tallies of the work behind every update, for telling why some signal runs slower
+  than another. They are compiled out unless ROLLING_QUANTILES_COUNTERS is defined, in which
+  case each one costs an add. Heaps tally their own sifts and moves, and monitors tally the
+  rest. The fields are listed once here, so that anything reporting them can walk the list.
+ */
+#define OPERATION_COUNTERS(X) \
+  X(updates) /* entries that went in, NaNs included */ \
+  X(sift_up_steps) /* levels that sifted elements rose */ \
+  X(sift_down_steps) \
+  X(swaps) /* elements moved into another's place, whether by a swap or into a hole */ \
+  X(rebalances) /* calls to `rebalance_rolling_quantile`, or to its counterpart for a chain */ \
+  X(rebalance_rounds) /* elements handed across the middle by all of them together */ \
+  X(deepest_rebalance) /* most rounds, and thus recursion depth, of any one of them */ \
+  X(left_expiries) /* stale entries found in the left heap */ \
+  X(right_expiries) \
+  X(current_expiries) /* stale entries that were the current value itself */ \
+  X(resets) /* times the window emptied out, as missing values do, and started over */
+
+#define DECLARE_OPERATION_COUNTER(name) unsigned long long name;
+
+struct operation_counters {
+  OPERATION_COUNTERS(DECLARE_OPERATION_COUNTER)
+};
+
+#ifdef ROLLING_QUANTILES_COUNTERS
+#define COUNTERS_ENABLED 1
+#define COUNT_OPERATIONS(counters, name, n) ((counters).name += (n))
+#define RECORD_DEEPEST(counters, name, n) ((counters).name = ((n) > (counters).name)? (n) : (counters).name)
+#else
+#define COUNTERS_ENABLED 0
+#define COUNT_OPERATIONS(counters, name, n) ((void)(n)) // consumed, so that locals kept only for the tally go unwarned
+#define RECORD_DEEPEST(counters, name, n) ((void)(n))
+#endif
+
+void add_operation_counters(struct operation_counters* sums, const struct operation_counters* counters); // takes the deepest of `deepest_rebalance` rather than the sum
+
+#endif
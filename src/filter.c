@@ -15,8 +15,10 @@
  */
 
 #include "filter.h"
+#include "parallel.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <tgmath.h>
 #include <stdbool.h>
 
@@ -30,8 +32,12 @@ struct high_pass_buffer {
   double entries[];
 };
 
-static struct high_pass_buffer* create_high_pass_buffer(unsigned size) {
-  struct high_pass_buffer* buffer = malloc(sizeof(struct high_pass_buffer) + sizeof(double)*size);
+static size_t size_high_pass_buffer(unsigned size) {
+  return sizeof(struct high_pass_buffer) + sizeof(double)*size;
+}
+
+static struct high_pass_buffer* create_high_pass_buffer(struct arena* arena, unsigned size) {
+  struct high_pass_buffer* buffer = allocate_within(arena, size_high_pass_buffer(size));
   buffer->head = 0;
   buffer->size = size;
   buffer->full = false;
@@ -61,58 +67,318 @@ static double find_high_pass_buffer_middle(struct high_pass_buffer* buffer) {
   return buffer->entries[index];
 }
 
-static void destroy_high_pass_buffer(struct high_pass_buffer* buffer) {
-  free(buffer);
+static void reset_high_pass_buffer(struct high_pass_buffer* buffer) {
+  buffer->head = 0;
+  buffer->full = false;
 }
 
-struct cascade_filter create_cascade_filter(struct cascade_description description) {
-  unsigned portion = description.portion;
-  double target = description.interpolation.target_quantile;
-  if (!isnan(target)) {
-    double target = compute_interpolation_target(
-      description.window, description.interpolation);
-    portion = (unsigned)fmax(floor(target), 1.0) - 1;
+static void destroy_high_pass_buffer(struct arena* arena, struct high_pass_buffer* buffer) {
+  release_within(arena, buffer);
+}
+
+static void save_high_pass_buffer(struct high_pass_buffer* buffer, struct state_stream* stream) {
+  WRITE_STATE(stream, buffer->size);
+  WRITE_STATE(stream, buffer->head);
+  WRITE_STATE(stream, buffer->full);
+  write_state(stream, buffer->entries, (buffer->full? buffer->size : buffer->head) * sizeof(double)); // the rest was never written
+}
+
+static void restore_high_pass_buffer(struct high_pass_buffer* buffer, struct state_stream* stream) {
+  expect_state(stream, buffer->size);
+  READ_STATE(stream, buffer->head);
+  READ_STATE(stream, buffer->full);
+  if (buffer->head > buffer->size)
+    stream->failed = true;
+  if (!stream->failed)
+    read_state(stream, buffer->entries, (buffer->full? buffer->size : buffer->head) * sizeof(double));
+}
+
+static unsigned locate_interpolation_portion(unsigned window, struct interpolation interpolation) {
+  double target = compute_interpolation_target(window, interpolation);
+  return (unsigned)fmax(floor(target), 1.0) - 1;
+}
+
+static void locate_chain_portions(struct cascade_description description, unsigned* portions, struct interpolation* interps) {
+  for (unsigned i = 0; i < description.n_quantiles; i += 1) {
+    interps[i] = description.interpolation;
+    interps[i].target_quantile = description.quantiles[i];
+    portions[i] = locate_interpolation_portion(description.window, interps[i]);
   }
+}
+
+static struct rolling_quantile_chain* create_cascade_chain(struct arena* arena, struct cascade_description description) {
+  unsigned n_quantiles = description.n_quantiles;
+  unsigned* portions = malloc(n_quantiles * sizeof(unsigned));
+  struct interpolation* interps = malloc(n_quantiles * sizeof(struct interpolation));
+  locate_chain_portions(description, portions, interps);
+  struct rolling_quantile_chain* chain = create_rolling_quantile_chain_within(arena,
+    description.window, n_quantiles, portions, interps);
+  free(portions);
+  free(interps);
+  return chain;
+}
+
+static unsigned locate_stage_portion(struct cascade_description description) {
+  if (isnan(description.interpolation.target_quantile))
+    return description.portion;
+  return locate_interpolation_portion(description.window, description.interpolation);
+}
+
+static inline bool is_hampel_stage(struct cascade_description description) {
+  return (description.mode == HAMPEL) || (description.mode == HAMPEL_SCORE);
+}
+
+#define HAMPEL_SORTED_THRESHOLD 1024 // the sorted array's direct selections make up for its linear updates up to about here
+
+static enum quantile_engine locate_stage_engine(struct cascade_description description) {
+  if (!is_hampel_stage(description) || (description.engine != AUTOMATIC_ENGINE))
+    return description.engine;
+  return (description.window <= HAMPEL_SORTED_THRESHOLD)? SORTED_ENGINE : TREE_ENGINE; // the deviations need selection by rank
+}
+
+static size_t measure_cascade_filter(struct cascade_description description) { // everything `create_cascade_filter_within` carves out of its arena
+  description.engine = locate_stage_engine(description);
+  if (description.duration > 0.0)
+    return 0; // the timed window grows as it goes, so it keeps to malloc
+  if (description.error > 0.0)
+    return measure_sliding_sketch(description.window, description.error);
+  size_t footprint;
+  if (description.n_quantiles > 0) {
+    unsigned* portions = malloc(description.n_quantiles * sizeof(unsigned));
+    struct interpolation* interps = malloc(description.n_quantiles * sizeof(struct interpolation));
+    locate_chain_portions(description, portions, interps);
+    footprint = measure_rolling_quantile_chain(description.window, description.n_quantiles, portions);
+    free(portions);
+    free(interps);
+  } else if (description.engine == COUNTING_ENGINE) {
+    footprint = measure_rolling_quantile_monitor_over_domain(description.window, description.lowest, description.highest);
+  } else {
+    footprint = measure_rolling_quantile_monitor(description.window, locate_stage_portion(description), description.engine);
+  }
+  if (description.mode != LOW_PASS)
+    footprint += align_to_cache_line(size_high_pass_buffer(description.window));
+  return footprint;
+}
+
+struct cascade_filter create_cascade_filter(struct cascade_description description) {
+  return create_cascade_filter_within(NULL, description);
+}
+
+struct cascade_filter create_cascade_filter_within(struct arena* arena, struct cascade_description description) {
+  unsigned portion = locate_stage_portion(description);
+  description.engine = locate_stage_engine(description);
   struct cascade_filter filter = {
-    .monitor = create_rolling_quantile_monitor(
-      description.window, portion, description.interpolation),
     .clock = 0,
     .subsample_rate = description.subsample_rate,
     .high_pass_buffer = NULL,
+    .chain = NULL,
+    .timed = NULL,
+    .sketch = NULL,
+    .mode = description.mode,
+    .threshold = description.threshold,
+    .tapped = false, // up to the pipeline
+    .ticked = false,
+    .latest = NAN,
   };
-  if (description.mode == HIGH_PASS) {
-    filter.high_pass_buffer = create_high_pass_buffer(description.window);
+  if (description.duration > 0.0) {
+    filter.timed = create_timed_quantile_monitor(description.duration, description.interpolation);
+    return filter; // the timed window keeps its own entries in order, so a high pass needs no buffer
+  }
+  if (description.error > 0.0) {
+    filter.sketch = create_sliding_sketch_within(arena, description.window, description.error, description.interpolation);
+    return filter; // an approximate high pass subtracts from the latest entry, since holding back half the window would defeat the purpose
+  }
+  if (description.n_quantiles > 0) {
+    filter.chain = create_cascade_chain(arena, description); // `monitor` stays zeroed out
+  } else if (description.engine == COUNTING_ENGINE) {
+    filter.monitor = create_rolling_quantile_monitor_over_domain_within(arena,
+      description.window, portion, description.interpolation, description.lowest, description.highest);
+  } else {
+    filter.monitor = create_rolling_quantile_monitor_within(arena,
+      description.window, portion, description.interpolation, description.engine, description.arity);
+  }
+  if (description.mode != LOW_PASS) { // Hampel stages look back to the middle all the same
+    filter.high_pass_buffer = create_high_pass_buffer(arena, description.window);
   }
   return filter;
 }
 
-struct filter_pipeline* create_filter_pipeline(unsigned n_filters, struct cascade_description* descriptions) {
+static inline int find_stage_source(struct cascade_description* descriptions, unsigned stage) {
+  return (int)stage - 1 - (int)descriptions[stage].skip;
+}
+
+int locate_stage_source(struct filter_pipeline* pipeline, unsigned stage) {
+  return find_stage_source(pipeline->descriptions, stage);
+}
+
+static bool is_stage_tapped(unsigned n_filters, struct cascade_description* descriptions, bool any_taps, unsigned stage) {
+  if (any_taps)
+    return descriptions[stage].tap;
+  for (unsigned j = stage + 1; j < n_filters; j += 1) { // otherwise, whether it is a leaf
+    if (find_stage_source(descriptions, j) == (int)stage)
+      return false;
+  }
+  return true;
+}
+
+static bool vet_pipeline_descriptions(unsigned n_filters, struct cascade_description* descriptions, unsigned* width, bool* branched) {
   for (struct cascade_description* description = descriptions;
       description != (descriptions + n_filters); description += 1) {
     if (!validate_interpolation(description->interpolation))
-      return NULL; // before allocating anything
+      return false; // before allocating anything
+    for (unsigned i = 0; i < description->n_quantiles; i += 1) {
+      struct interpolation interp = description->interpolation;
+      interp.target_quantile = description->quantiles[i];
+      if (isnan(interp.target_quantile) || !validate_interpolation(interp))
+        return false;
+    }
+    if ((description->n_quantiles >= MAX_HEAPS_PER_QUEUE) || ((description->arity != 0) && !is_valid_heap_arity(description->arity)))
+      return false;
+    if ((description->duration > 0.0) && ((description->n_quantiles > 0) || isnan(description->interpolation.target_quantile)))
+      return false; // spans of time only know how to interpolate a single quantile
+    if (isnan(description->duration) || isinf(description->duration))
+      return false;
+    if ((description->error > 0.0) && ((description->error >= 1.0) || (description->duration > 0.0)
+        || (description->n_quantiles > 0) || isnan(description->interpolation.target_quantile)))
+      return false; // approximate stages interpolate a single quantile over a count of samples
+    if (isnan(description->error))
+      return false;
+    if ((description->engine == COUNTING_ENGINE) && !validate_histogram_domain(description->lowest, description->highest))
+      return false;
+    if (is_hampel_stage(*description) && ((description->engine == HEAP_ENGINE) || (description->n_quantiles > 0)
+        || (description->duration > 0.0) || (description->error > 0.0) || !isnan(description->interpolation.target_quantile)))
+      return false; // a plain median over a count of samples, ordered by something that selects by rank
+    if ((description->mode == HAMPEL) && !(description->threshold >= 0.0))
+      return false;
   }
-  struct filter_pipeline* pipeline = malloc(
+  bool any_taps = false;
+  for (unsigned i = 0; i < n_filters; i += 1) {
+    if (descriptions[i].skip > i)
+      return false; // there is nothing before the raw input
+    any_taps |= descriptions[i].tap;
+  }
+  *width = 0;
+  *branched = false;
+  for (unsigned i = 0; i < n_filters; i += 1) {
+    int source = find_stage_source(descriptions, i);
+    if ((source >= 0) && (descriptions[source].n_quantiles > 0))
+      return false; // several quantiles cannot trickle down any further
+    bool tapped = is_stage_tapped(n_filters, descriptions, any_taps, i);
+    if ((descriptions[i].n_quantiles > 0) && !tapped)
+      return false; // nor go unreported
+    if (tapped)
+      *width += (descriptions[i].n_quantiles > 0)? descriptions[i].n_quantiles : 1;
+    *branched |= (descriptions[i].skip > 0) || (tapped && (i != n_filters - 1));
+  }
+  return true;
+}
+
+static size_t measure_pipeline_footprint(unsigned n_filters, struct cascade_description* descriptions) {
+  size_t footprint = align_to_cache_line(sizeof(struct filter_pipeline) + n_filters*sizeof(struct cascade_filter))
+    + align_to_cache_line(n_filters * sizeof(struct cascade_description));
+  for (unsigned i = 0; i < n_filters; i += 1) {
+    if (descriptions[i].n_quantiles > 0)
+      footprint += align_to_cache_line(descriptions[i].n_quantiles * sizeof(double));
+    footprint += measure_cascade_filter(descriptions[i]);
+  }
+  return footprint;
+}
+
+static struct filter_pipeline* place_filter_pipeline(struct arena* arena, unsigned n_filters, struct cascade_description* descriptions,
+    unsigned width, bool branched) {
+  bool any_taps = false;
+  for (unsigned i = 0; i < n_filters; i += 1)
+    any_taps |= descriptions[i].tap;
+  struct filter_pipeline* pipeline = allocate_within(arena,
     sizeof(struct filter_pipeline) + n_filters*sizeof(struct cascade_filter));
   pipeline->n_filters = n_filters;
+  pipeline->width = (width > 0)? width : 1; // an empty pipeline passes its input right through
+  pipeline->timed = false;
+  pipeline->branched = branched;
+  pipeline->arena = arena;
+  pipeline->descriptions = allocate_within(arena, n_filters * sizeof(struct cascade_description));
+  memcpy(pipeline->descriptions, descriptions, n_filters * sizeof(struct cascade_description));
   for (unsigned i = 0; i < n_filters; i += 1) {
-    pipeline->filters[i] = create_cascade_filter(descriptions[i]);
+    unsigned n_quantiles = descriptions[i].n_quantiles;
+    if (n_quantiles > 0) { // the caller keeps theirs
+      pipeline->descriptions[i].quantiles = allocate_within(arena, n_quantiles * sizeof(double));
+      memcpy(pipeline->descriptions[i].quantiles, descriptions[i].quantiles, n_quantiles * sizeof(double));
+    } else {
+      pipeline->descriptions[i].quantiles = NULL;
+    }
+    pipeline->filters[i] = create_cascade_filter_within(arena, descriptions[i]);
+    pipeline->filters[i].tapped = is_stage_tapped(n_filters, descriptions, any_taps, i);
+    pipeline->timed |= (pipeline->filters[i].timed != NULL);
   }
   return pipeline;
 }
 
-double feed_filter_pipeline(struct filter_pipeline* pipeline, double entry) {
+struct filter_pipeline* create_filter_pipeline(unsigned n_filters, struct cascade_description* descriptions) {
+  struct filter_pipeline* pipeline = NULL;
+  if (!create_filter_pipelines(1, n_filters, descriptions, &pipeline))
+    return NULL;
+  return pipeline;
+}
+
+bool create_filter_pipelines(unsigned n_pipelines, unsigned n_filters, struct cascade_description* descriptions, struct filter_pipeline** pipelines) {
+  unsigned width;
+  bool branched;
+  if ((n_pipelines == 0) || !vet_pipeline_descriptions(n_filters, descriptions, &width, &branched))
+    return false; // before allocating anything
+  struct arena* arena = open_arena(n_pipelines * measure_pipeline_footprint(n_filters, descriptions), n_pipelines);
+  if (arena == NULL)
+    return false;
+  for (unsigned p = 0; p < n_pipelines; p += 1) // one after the other, so that each one's pieces sit together
+    pipelines[p] = place_filter_pipeline(arena, n_filters, descriptions, width, branched);
+  return true;
+}
+
+// for Hampel stages. a missing middle stays missing, and a window without spread flags every departure from its median, and scores the median itself zero rather than 0/0
+static inline double judge_against_deviation(struct cascade_filter* filter, double middle, double median) {
+  double deviation = MAD_TO_DEVIATION * find_rolling_deviation(&filter->monitor, median);
+  if (filter->mode == HAMPEL_SCORE)
+    return (middle == median)? 0.0 : ((middle - median) / deviation);
+  return (fabs(middle - median) > filter->threshold * deviation)? median : middle;
+}
+
+static inline double pass_through_stage(struct cascade_filter* filter, double value, double timestamp) { // for stages without a chain
+  if (filter->timed != NULL) {
+    double quantile = update_timed_quantile(filter->timed, value, timestamp);
+    return (filter->mode == HIGH_PASS)? (find_timed_window_middle(filter->timed) - quantile) : quantile;
+  }
+  if (filter->sketch != NULL) {
+    double estimate = update_sliding_sketch(filter->sketch, value);
+    return (filter->mode == HIGH_PASS)? (value - estimate) : estimate;
+  }
+  double quantile = update_rolling_quantile(&filter->monitor, value);
+  if (filter->high_pass_buffer != NULL) { // explicit conditional for enhanced clarity
+    add_to_high_pass_buffer(filter->high_pass_buffer, value);
+    double middle = find_high_pass_buffer_middle(filter->high_pass_buffer);
+    if (filter->mode != HIGH_PASS)
+      return judge_against_deviation(filter, middle, quantile);
+    return middle - quantile;
+  }
+  return quantile;
+}
+
+static inline void pass_through_chain(struct cascade_filter* filter, double value, double* outputs) {
+  update_rolling_quantile_chain(filter->chain, value, outputs);
+  if (filter->high_pass_buffer != NULL) {
+    add_to_high_pass_buffer(filter->high_pass_buffer, value);
+    double middle = find_high_pass_buffer_middle(filter->high_pass_buffer);
+    for (unsigned j = 0; j < filter->chain->n_cuts; j += 1)
+      outputs[j] = middle - outputs[j];
+  }
+}
+
+static inline double trickle_down_pipeline(struct filter_pipeline* pipeline, double entry, double timestamp) {
   double trickling_value = entry;
   for (unsigned i = 0; i < pipeline->n_filters; i += 1) { // trickle down the pipeline
     struct cascade_filter* filter = pipeline->filters + i;
-    double quantile = update_rolling_quantile(&filter->monitor, trickling_value);
-    if (filter->high_pass_buffer != NULL) { // explicit conditional for enhanced clarity
-      add_to_high_pass_buffer(filter->high_pass_buffer, trickling_value);
-      double middle = find_high_pass_buffer_middle(filter->high_pass_buffer);
-      trickling_value = middle - quantile;
-    } else {
-      trickling_value = quantile;
-    }
+    if (filter->chain != NULL) // the final stage, with a lone quantile since the width is one
+      pass_through_chain(filter, trickling_value, &trickling_value);
+    else
+      trickling_value = pass_through_stage(filter, trickling_value, timestamp);
     if ((++filter->clock) < filter->subsample_rate)
       return NAN;
     filter->clock = 0;
@@ -120,19 +386,585 @@ double feed_filter_pipeline(struct filter_pipeline* pipeline, double entry) {
   return trickling_value; // made it all the way through the torturous path!
 }
 
+static void fill_with_nans(double* outputs, unsigned width) {
+  for (unsigned i = 0; i < width; i += 1)
+    outputs[i] = NAN;
+}
+
+/*
+  Branched pipelines go stage by stage all the same, since every stage comes after its
+  source. Each one remembers whether it let anything through, and what, for those that
+  feed off of it. Taps write into their own columns as they go.
+ */
+static inline void trickle_through_graph(struct filter_pipeline* pipeline, double entry, double timestamp, double* outputs) {
+  double* columns = outputs;
+  for (unsigned i = 0; i < pipeline->n_filters; i += 1) {
+    struct cascade_filter* filter = pipeline->filters + i;
+    unsigned width = (filter->chain != NULL)? filter->chain->n_cuts : 1;
+    int source = find_stage_source(pipeline->descriptions, i);
+    bool fed = (source < 0) || pipeline->filters[source].ticked;
+    filter->ticked = false;
+    if (fed) {
+      double value = (source < 0)? entry : pipeline->filters[source].latest;
+      if (filter->chain != NULL) // necessarily a tap
+        pass_through_chain(filter, value, columns);
+      else
+        filter->latest = pass_through_stage(filter, value, timestamp);
+      filter->ticked = (++filter->clock) >= filter->subsample_rate;
+      if (filter->ticked)
+        filter->clock = 0;
+    }
+    if (!filter->tapped)
+      continue;
+    if (!filter->ticked)
+      fill_with_nans(columns, width);
+    else if (filter->chain == NULL)
+      columns[0] = filter->latest;
+    columns += width;
+  }
+}
+
+double feed_filter_pipeline(struct filter_pipeline* pipeline, double entry) {
+  if (pipeline->branched) {
+    double output;
+    trickle_through_graph(pipeline, entry, NAN, &output);
+    return output;
+  }
+  return trickle_down_pipeline(pipeline, entry, NAN);
+}
+
+double feed_filter_pipeline_at(struct filter_pipeline* pipeline, double entry, double timestamp) {
+  if (pipeline->branched) {
+    double output;
+    trickle_through_graph(pipeline, entry, timestamp, &output);
+    return output;
+  }
+  return trickle_down_pipeline(pipeline, entry, timestamp);
+}
+
+static inline void trickle_down_pipeline_into(struct filter_pipeline* pipeline, double entry, double timestamp, double* outputs) {
+  unsigned width = pipeline->width;
+  double trickling_value = entry;
+  for (unsigned i = 0; i < pipeline->n_filters; i += 1) {
+    struct cascade_filter* filter = pipeline->filters + i;
+    if (filter->chain != NULL) { // necessarily the final stage
+      pass_through_chain(filter, trickling_value, outputs);
+    } else {
+      trickling_value = pass_through_stage(filter, trickling_value, timestamp);
+    }
+    if ((++filter->clock) < filter->subsample_rate) {
+      fill_with_nans(outputs, width);
+      return;
+    }
+    filter->clock = 0;
+  }
+  if ((pipeline->n_filters == 0) || (pipeline->filters[pipeline->n_filters-1].chain == NULL))
+    outputs[0] = trickling_value;
+}
+
+void feed_filter_pipeline_into(struct filter_pipeline* pipeline, double entry, double* outputs) {
+  if (pipeline->branched)
+    trickle_through_graph(pipeline, entry, NAN, outputs);
+  else
+    trickle_down_pipeline_into(pipeline, entry, NAN, outputs);
+}
+
+void feed_filter_pipeline_at_into(struct filter_pipeline* pipeline, double entry, double timestamp, double* outputs) {
+  if (pipeline->branched)
+    trickle_through_graph(pipeline, entry, timestamp, outputs);
+  else
+    trickle_down_pipeline_into(pipeline, entry, timestamp, outputs);
+}
+
+static size_t measure_path_memory(struct filter_pipeline* pipeline, int stage, size_t* stride) { // from the raw input down to `stage`
+  if (stage < 0) {
+    *stride = 1;
+    return 0;
+  }
+  size_t memory = measure_path_memory(pipeline, locate_stage_source(pipeline, (unsigned)stage), stride);
+  memory += (size_t)pipeline->descriptions[stage].window * (*stride); // each stage looks back on its own window of its source's subsamples
+  *stride *= pipeline->descriptions[stage].subsample_rate;
+  return memory;
+}
+
+size_t measure_pipeline_memory(struct filter_pipeline* pipeline) {
+  size_t memory = 0;
+  size_t stride;
+  for (unsigned i = 0; i < pipeline->n_filters; i += 1) { // the longest path, in a branched pipeline
+    size_t path_memory = measure_path_memory(pipeline, (int)i, &stride);
+    if (path_memory > memory)
+      memory = path_memory;
+  }
+  return memory;
+}
+
+unsigned measure_pipeline_stride(struct filter_pipeline* pipeline) {
+  size_t stride;
+  measure_path_memory(pipeline, (int)pipeline->n_filters - 1, &stride);
+  return (unsigned)stride;
+}
+
+static unsigned locate_path_phase(struct filter_pipeline* pipeline, int stage, unsigned* stride) {
+  if (stage < 0) {
+    *stride = 1;
+    return 0;
+  }
+  struct cascade_filter* filter = pipeline->filters + stage;
+  unsigned phase = locate_path_phase(pipeline, locate_stage_source(pipeline, (unsigned)stage), stride);
+  phase += filter->clock * (*stride);
+  *stride *= filter->subsample_rate;
+  return phase;
+}
+
+unsigned locate_pipeline_phase(struct filter_pipeline* pipeline) { // the clocks along the last stage's path spell it out in mixed radix
+  unsigned stride;
+  return locate_path_phase(pipeline, (int)pipeline->n_filters - 1, &stride);
+}
+
+/*
+  Subsampling pipelines only yield anything once every `stride` entries, so rather than
+  write out all the NaNs in between, they may just as well skip them. A plain cascade
+  yielded when every clock has just come back around to zero, and a branched one when
+  any of its taps ticked.
+ */
+static inline bool has_pipeline_yielded(struct filter_pipeline* pipeline) { // right after an entry went in
+  for (unsigned i = 0; i < pipeline->n_filters; i += 1) {
+    struct cascade_filter* filter = pipeline->filters + i;
+    if (pipeline->branched && filter->tapped && filter->ticked)
+      return true;
+    if (!pipeline->branched && (filter->clock != 0))
+      return false;
+  }
+  return !pipeline->branched;
+}
+
+size_t bound_pipeline_outputs(struct filter_pipeline* pipeline, size_t n_entries) {
+  if (!pipeline->branched)
+    return n_entries / measure_pipeline_stride(pipeline) + 1;
+  size_t bound = 0;
+  for (unsigned i = 0; i < pipeline->n_filters; i += 1) { // as if the taps never yielded together
+    size_t stride;
+    measure_path_memory(pipeline, (int)i, &stride);
+    if (pipeline->filters[i].tapped)
+      bound += n_entries / stride + 1;
+  }
+  return (bound < n_entries)? bound : n_entries;
+}
+
+size_t feed_filter_pipeline_compactly(struct filter_pipeline* pipeline, const double* input, const double* timestamps, size_t n_entries, double* outputs, size_t* indices) {
+  unsigned width = pipeline->width;
+  double* scratch = malloc(width * sizeof(double)); // since entries that yield nothing still write NaNs
+  size_t n_yielded = 0;
+  for (size_t t = 0; t < n_entries; t += 1) {
+    feed_filter_pipeline_at_into(pipeline, input[t], (timestamps != NULL)? timestamps[t] : NAN, scratch);
+    if (!has_pipeline_yielded(pipeline))
+      continue;
+    memcpy(outputs + n_yielded*width, scratch, width * sizeof(double));
+    if (indices != NULL)
+      indices[n_yielded] = t;
+    n_yielded += 1;
+  }
+  free(scratch);
+  return n_yielded;
+}
+
+/*
+  Offline filtering of one long series, split into contiguous chunks. Every output only
+  depends on the last `measure_pipeline_memory(...)` entries, so a pristine pipeline that
+  warms up on that many entries before its chunk (rounded back so that its subsampling
+  clocks line up) reports exactly what the original would have. The original takes the
+  first chunk, and the twin that took the last chunk ends up holding the state. The warm-ups
+  are copied out beforehand, because the outputs may be overwriting the input as we go.
+ */
+#define MINIMUM_CHUNK_LENGTH 16384 // below which the warm-up and thread spawning don't pay off
+
+struct chunk_plan {
+  struct filter_pipeline** pipelines; // one per chunk, the first being the original
+  double** warm_ups; // what comes before each chunk, long enough to settle into the same state
+  size_t warm_up_length;
+  const double* input;
+  double* outputs;
+  size_t n_entries;
+  size_t chunk_length;
+};
+
+static void feed_span(struct filter_pipeline* pipeline, const double* input, double* outputs, size_t n_entries) {
+  unsigned width = pipeline->width;
+  if (width == 1) {
+    for (size_t t = 0; t < n_entries; t += 1)
+      outputs[t] = feed_filter_pipeline(pipeline, input[t]);
+  } else {
+    for (size_t t = 0; t < n_entries; t += 1)
+      feed_filter_pipeline_into(pipeline, input[t], outputs + t*width);
+  }
+}
+
+static void feed_chunks(void* context, unsigned first, unsigned last) {
+  struct chunk_plan* plan = context;
+  for (unsigned c = first; c < last; c += 1) {
+    size_t start = c * plan->chunk_length;
+    size_t end = (start + plan->chunk_length < plan->n_entries)? (start + plan->chunk_length) : plan->n_entries;
+    struct filter_pipeline* pipeline = plan->pipelines[c];
+    if (c > 0) {
+      struct filter_pipeline* original = plan->pipelines[0];
+      pipeline = create_filter_pipeline(original->n_filters, original->descriptions);
+      plan->pipelines[c] = pipeline;
+      double* scratch = malloc(pipeline->width * sizeof(double));
+      for (size_t t = 0; t < plan->warm_up_length; t += 1)
+        feed_filter_pipeline_into(pipeline, plan->warm_ups[c][t], scratch);
+      free(scratch);
+    }
+    feed_span(pipeline, plan->input + start, plan->outputs + start*pipeline->width, end - start);
+  }
+}
+
+static void carry_operation_counters(struct filter_pipeline* from, struct filter_pipeline* to) { // onto each stage's own counters, so that the tallies survive the twins' destruction
+  for (unsigned i = 0; i < from->n_filters; i += 1) {
+    struct operation_counters sums = {0};
+    tally_stage_operations(from->filters + i, &sums);
+    if (to->filters[i].chain != NULL)
+      add_operation_counters(&to->filters[i].chain->counters, &sums);
+    else
+      add_operation_counters(&to->filters[i].monitor.counters, &sums); // sketches never get split into chunks, and neither do timed stages
+  }
+}
+
+struct filter_pipeline* feed_filter_pipeline_in_chunks(struct filter_pipeline* pipeline, const double* input, double* outputs, size_t n_entries, unsigned n_threads) {
+  size_t memory = measure_pipeline_memory(pipeline);
+  unsigned stride = measure_pipeline_stride(pipeline);
+  size_t shortest = memory + stride; // so that every warm-up fits in front of its chunk
+  if (shortest < MINIMUM_CHUNK_LENGTH)
+    shortest = MINIMUM_CHUNK_LENGTH;
+  size_t n_chunks = n_entries / shortest;
+  if (n_chunks > n_threads)
+    n_chunks = n_threads;
+  bool approximate = false;
+  for (unsigned i = 0; i < pipeline->n_filters; i += 1)
+    approximate |= (pipeline->filters[i].sketch != NULL);
+  if (pipeline->timed || approximate || pipeline->branched || (n_chunks <= 1)) { // no bounded memory in entries, sketches whose blocks would have to line up as well, or clocks in several phases at once
+    feed_span(pipeline, input, outputs, n_entries);
+    return pipeline;
+  }
+  unsigned phase = locate_pipeline_phase(pipeline);
+  size_t chunk_length = (n_entries + n_chunks - 1) / n_chunks;
+  chunk_length += (stride - chunk_length % stride) % stride; // chunks start on the same phase
+  n_chunks = (n_entries + chunk_length - 1) / chunk_length;
+  size_t warm_up_length = memory + (phase + stride - memory % stride) % stride; // back to where the clocks read zero
+  struct chunk_plan plan = {
+    .pipelines = calloc(n_chunks, sizeof(struct filter_pipeline*)),
+    .warm_ups = calloc(n_chunks, sizeof(double*)),
+    .warm_up_length = warm_up_length,
+    .input = input,
+    .outputs = outputs,
+    .n_entries = n_entries,
+    .chunk_length = chunk_length,
+  };
+  plan.pipelines[0] = pipeline;
+  for (size_t c = 1; c < n_chunks; c += 1) { // chunks are long enough for these never to run off the front
+    plan.warm_ups[c] = malloc(warm_up_length * sizeof(double));
+    memcpy(plan.warm_ups[c], input + c*chunk_length - warm_up_length, warm_up_length * sizeof(double));
+  }
+  run_in_parallel((unsigned)n_chunks, (unsigned)n_chunks, feed_chunks, &plan);
+  for (size_t c = 1; c < n_chunks; c += 1)
+    free(plan.warm_ups[c]);
+  free(plan.warm_ups);
+  struct filter_pipeline* successor = plan.pipelines[n_chunks-1];
+  for (size_t c = 0; c + 1 < n_chunks; c += 1) {
+    if (COUNTERS_ENABLED)
+      carry_operation_counters(plan.pipelines[c], successor); // warm-ups and all
+    destroy_filter_pipeline(plan.pipelines[c]); // they hold outdated states
+  }
+  free(plan.pipelines);
+  return successor;
+}
+
+/*
+  Signals known to be quantized into a small domain of integers, like the raw counts of an
+  ADC, are counted rather than sorted. Only the first stage sees them raw, and only when its
+  engine was left up to us, its window is too long for the sorted array, and it reports a
+  lone quantile. The window must also be dense enough in the domain that the histogram's
+  cursor does not wander far between neighboring entries.
+ */
+#define MAXIMUM_BINS_PER_ENTRY 16
+
+struct filter_pipeline* count_filter_pipeline_over_domain(struct filter_pipeline* pipeline, double lowest, double highest) {
+  if (pipeline->n_filters == 0)
+    return NULL;
+  struct cascade_description first = pipeline->descriptions[0];
+  if ((first.engine != AUTOMATIC_ENGINE) || (first.window <= SORTED_ENGINE_THRESHOLD) || (first.n_quantiles > 0)
+      || (first.duration > 0.0) || (first.error > 0.0) || !validate_histogram_domain(lowest, highest)
+      || ((highest - lowest + 1.0) > (double)first.window * MAXIMUM_BINS_PER_ENTRY))
+    return NULL;
+  struct cascade_description* descriptions = malloc(pipeline->n_filters * sizeof(struct cascade_description));
+  memcpy(descriptions, pipeline->descriptions, pipeline->n_filters * sizeof(struct cascade_description)); // shallow, since the twin makes its own copy
+  descriptions[0].engine = COUNTING_ENGINE;
+  descriptions[0].lowest = lowest;
+  descriptions[0].highest = highest;
+  descriptions[0].settled = true;
+  struct filter_pipeline* twin = create_filter_pipeline(pipeline->n_filters, descriptions);
+  free(descriptions);
+  return twin;
+}
+
+/*
+  Snapshots open with a magic number, which also catches a foreign byte order, and a format
+  version. The descriptions follow field by field, since they are all it takes to make a
+  pristine twin of the right shape, and then the state of every stage of every pipeline.
+  The channels of a bank share one snapshot, and a lone pipeline counts as zero channels.
+ */
+#define PIPELINE_STATE_MAGIC 0x51524E53u
+#define PIPELINE_STATE_VERSION 4u // the second added branches, the third Hampel stages, and the fourth settled engines. older versions still restore
+
+static void save_cascade_description(struct cascade_description* description, struct state_stream* stream) {
+  unsigned mode = (unsigned)description->mode, engine = (unsigned)description->engine, tap = description->tap, settled = description->settled;
+  WRITE_STATE(stream, description->window);
+  WRITE_STATE(stream, description->portion);
+  WRITE_STATE(stream, description->interpolation.target_quantile);
+  WRITE_STATE(stream, description->interpolation.alpha);
+  WRITE_STATE(stream, description->interpolation.beta);
+  WRITE_STATE(stream, description->subsample_rate);
+  WRITE_STATE(stream, mode);
+  WRITE_STATE(stream, engine);
+  WRITE_STATE(stream, description->lowest);
+  WRITE_STATE(stream, description->highest);
+  WRITE_STATE(stream, description->arity);
+  WRITE_STATE(stream, description->duration);
+  WRITE_STATE(stream, description->error);
+  WRITE_STATE(stream, description->skip);
+  WRITE_STATE(stream, tap);
+  WRITE_STATE(stream, description->threshold);
+  WRITE_STATE(stream, settled);
+  WRITE_STATE(stream, description->n_quantiles);
+  write_state(stream, description->quantiles, description->n_quantiles * sizeof(double));
+}
+
+static void restore_cascade_description(struct cascade_description* description, struct state_stream* stream, unsigned version) {
+  unsigned mode = 0, engine = 0, tap = 0, settled = 0;
+  READ_STATE(stream, description->window);
+  READ_STATE(stream, description->portion);
+  READ_STATE(stream, description->interpolation.target_quantile);
+  READ_STATE(stream, description->interpolation.alpha);
+  READ_STATE(stream, description->interpolation.beta);
+  READ_STATE(stream, description->subsample_rate);
+  READ_STATE(stream, mode);
+  READ_STATE(stream, engine);
+  READ_STATE(stream, description->lowest);
+  READ_STATE(stream, description->highest);
+  READ_STATE(stream, description->arity);
+  READ_STATE(stream, description->duration);
+  READ_STATE(stream, description->error);
+  if (version >= 2) {
+    READ_STATE(stream, description->skip);
+    READ_STATE(stream, tap);
+  }
+  if (version >= 3)
+    READ_STATE(stream, description->threshold);
+  if (version >= 4)
+    READ_STATE(stream, settled);
+  READ_STATE(stream, description->n_quantiles);
+  description->tap = (tap != 0);
+  description->settled = (settled != 0) && (engine == COUNTING_ENGINE);
+  description->mode = (mode <= HAMPEL_SCORE)? (enum cascade_mode)mode : HIGH_PASS;
+  description->engine = (engine <= COUNTING_ENGINE)? (enum quantile_engine)engine : AUTOMATIC_ENGINE;
+  if ((mode > HAMPEL_SCORE) || (engine > COUNTING_ENGINE) || (description->subsample_rate == 0)
+      || ((description->window == 0) && !(description->duration > 0.0)) // timed stages have no window
+      || ((description->error == 0.0) && !has_room_for(stream, description->window, sizeof(unsigned))) // every exact stage writes out at least that much
+      || !has_room_for(stream, description->n_quantiles, sizeof(double)))
+    stream->failed = true;
+  if (stream->failed) {
+    description->n_quantiles = 0;
+    return;
+  }
+  description->quantiles = malloc(description->n_quantiles * sizeof(double));
+  read_state(stream, description->quantiles, description->n_quantiles * sizeof(double));
+}
+
+static void save_cascade_filter(struct cascade_filter* filter, struct state_stream* stream) {
+  WRITE_STATE(stream, filter->clock);
+  if (filter->chain != NULL)
+    save_rolling_quantile_chain(filter->chain, stream);
+  else if (filter->timed != NULL)
+    save_timed_quantile(filter->timed, stream);
+  else if (filter->sketch != NULL)
+    save_sliding_sketch(filter->sketch, stream);
+  else
+    save_rolling_quantile(&filter->monitor, stream);
+  if (filter->high_pass_buffer != NULL)
+    save_high_pass_buffer(filter->high_pass_buffer, stream);
+}
+
+static void restore_cascade_filter(struct cascade_filter* filter, struct state_stream* stream) {
+  READ_STATE(stream, filter->clock);
+  if (filter->clock >= filter->subsample_rate)
+    stream->failed = true;
+  if (filter->chain != NULL)
+    restore_rolling_quantile_chain(filter->chain, stream);
+  else if (filter->timed != NULL)
+    restore_timed_quantile(filter->timed, stream);
+  else if (filter->sketch != NULL)
+    restore_sliding_sketch(filter->sketch, stream);
+  else
+    restore_rolling_quantile(&filter->monitor, stream);
+  if (filter->high_pass_buffer != NULL)
+    restore_high_pass_buffer(filter->high_pass_buffer, stream);
+}
+
+static bool copy_filter_pipeline_state(struct filter_pipeline* source, struct filter_pipeline* destination, struct state_stream* stream) { // through a stream that already has room
+  stream->length = 0;
+  for (unsigned i = 0; i < source->n_filters; i += 1)
+    save_cascade_filter(source->filters + i, stream);
+  stream->capacity = stream->length;
+  stream->length = 0;
+  for (unsigned i = 0; i < destination->n_filters; i += 1)
+    restore_cascade_filter(destination->filters + i, stream);
+  return !stream->failed;
+}
+
+struct filter_pipeline* clone_filter_pipeline(struct filter_pipeline* pipeline) {
+  struct filter_pipeline* clone = NULL;
+  if (!clone_filter_pipelines(&pipeline, 1, &clone))
+    return NULL;
+  return clone;
+}
+
+bool clone_filter_pipelines(struct filter_pipeline** pipelines, unsigned n_pipelines, struct filter_pipeline** clones) {
+  struct filter_pipeline* first = pipelines[0]; // the channels of a bank are all alike
+  if (!create_filter_pipelines(n_pipelines, first->n_filters, first->descriptions, clones))
+    return false;
+  struct state_stream stream = {0}; // measures the largest state first, since trees and timed windows vary
+  size_t largest = 0;
+  for (unsigned p = 0; p < n_pipelines; p += 1) {
+    stream.length = 0;
+    for (unsigned i = 0; i < first->n_filters; i += 1)
+      save_cascade_filter(pipelines[p]->filters + i, &stream);
+    largest = (stream.length > largest)? stream.length : largest;
+  }
+  stream.data = malloc((largest > 0)? largest : 1);
+  bool copied = true;
+  for (unsigned p = 0; (p < n_pipelines) && copied; p += 1)
+    copied = copy_filter_pipeline_state(pipelines[p], clones[p], &stream);
+  free(stream.data);
+  if (!copied) {
+    for (unsigned p = 0; p < n_pipelines; p += 1)
+      destroy_filter_pipeline(clones[p]);
+  }
+  return copied;
+}
+
+size_t save_filter_pipelines(struct filter_pipeline** pipelines, unsigned n_channels, unsigned char* buffer) {
+  struct state_stream stream = { .data = buffer };
+  unsigned magic = PIPELINE_STATE_MAGIC, version = PIPELINE_STATE_VERSION;
+  unsigned n_filters = pipelines[0]->n_filters;
+  unsigned n_pipelines = (n_channels > 0)? n_channels : 1;
+  WRITE_STATE(&stream, magic);
+  WRITE_STATE(&stream, version);
+  WRITE_STATE(&stream, n_channels);
+  WRITE_STATE(&stream, n_filters);
+  for (unsigned i = 0; i < n_filters; i += 1)
+    save_cascade_description(pipelines[0]->descriptions + i, &stream);
+  for (unsigned p = 0; p < n_pipelines; p += 1) {
+    for (unsigned i = 0; i < n_filters; i += 1)
+      save_cascade_filter(pipelines[p]->filters + i, &stream);
+  }
+  return stream.length;
+}
+
+struct filter_pipeline** restore_filter_pipelines(const unsigned char* buffer, size_t length, unsigned* n_channels) {
+  struct state_stream stream = { .data = (unsigned char*)buffer, .capacity = length }; // only ever read from
+  unsigned magic = 0, version = 0, n_filters = 0;
+  *n_channels = 0;
+  READ_STATE(&stream, magic);
+  READ_STATE(&stream, version);
+  READ_STATE(&stream, *n_channels);
+  READ_STATE(&stream, n_filters);
+  if ((magic != PIPELINE_STATE_MAGIC) || (version == 0) || (version > PIPELINE_STATE_VERSION)
+      || (n_filters > length / sizeof(struct cascade_description)) || (*n_channels > length)) // each needs at least a clock apiece, so these are generous
+    return NULL;
+  unsigned n_pipelines = (*n_channels > 0)? *n_channels : 1;
+  struct cascade_description* descriptions = calloc(n_filters, sizeof(struct cascade_description));
+  for (unsigned i = 0; i < n_filters; i += 1)
+    restore_cascade_description(descriptions + i, &stream, version);
+  struct filter_pipeline** pipelines = calloc(n_pipelines, sizeof(struct filter_pipeline*));
+  if (!stream.failed && !create_filter_pipelines(n_pipelines, n_filters, descriptions, pipelines))
+    stream.failed = true;
+  for (unsigned p = 0; (p < n_pipelines) && !stream.failed; p += 1) {
+    for (unsigned i = 0; i < n_filters; i += 1)
+      restore_cascade_filter(pipelines[p]->filters + i, &stream);
+  }
+  for (unsigned i = 0; i < n_filters; i += 1)
+    free(descriptions[i].quantiles);
+  free(descriptions);
+  if (stream.failed || (stream.length != length)) {
+    for (unsigned p = 0; p < n_pipelines; p += 1) {
+      if (pipelines[p] != NULL)
+        destroy_filter_pipeline(pipelines[p]);
+    }
+    free(pipelines);
+    return NULL;
+  }
+  return pipelines;
+}
+
+void tally_stage_operations(struct cascade_filter* filter, struct operation_counters* sums) { // timed and approximate stages keep no counters of their own
+  if (filter->chain != NULL) {
+    add_operation_counters(sums, &filter->chain->counters);
+    for (unsigned i = 0; i <= filter->chain->n_cuts; i += 1)
+      add_operation_counters(sums, &filter->chain->heaps[i]->counters);
+    return;
+  }
+  if ((filter->timed != NULL) || (filter->sketch != NULL))
+    return;
+  add_operation_counters(sums, &filter->monitor.counters);
+  if (filter->monitor.engine == HEAP_ENGINE) {
+    add_operation_counters(sums, &filter->monitor.left_heap->counters);
+    add_operation_counters(sums, &filter->monitor.right_heap->counters);
+  }
+}
+
 bool verify_pipeline(struct filter_pipeline* pipeline) {
   for (unsigned i = 0; i < pipeline->n_filters; i += 1) {
-    if (!verify_monitor(&pipeline->filters[i].monitor))
+    struct cascade_filter* filter = pipeline->filters + i;
+    bool valid = (filter->chain != NULL)? verify_rolling_quantile_chain(filter->chain)
+      : (filter->timed != NULL)? verify_timed_monitor(filter->timed)
+      : (filter->sketch != NULL)? verify_sliding_sketch(filter->sketch) : verify_monitor(&filter->monitor);
+    if (!valid)
       return false;
   }
   return true;
 }
 
+void reset_filter_pipeline(struct filter_pipeline* pipeline) {
+  for (unsigned i = 0; i < pipeline->n_filters; i += 1) {
+    struct cascade_filter* filter = pipeline->filters + i;
+    if (filter->chain != NULL)
+      reset_rolling_quantile_chain(filter->chain);
+    else if (filter->timed != NULL)
+      reset_timed_quantile(filter->timed);
+    else if (filter->sketch != NULL)
+      reset_sliding_sketch(filter->sketch);
+    else
+      reset_rolling_quantile(&filter->monitor);
+    if (filter->high_pass_buffer != NULL)
+      reset_high_pass_buffer(filter->high_pass_buffer);
+    filter->clock = 0;
+    filter->ticked = false;
+    filter->latest = NAN;
+  }
+}
+
 void destroy_filter_pipeline(struct filter_pipeline* pipeline) {
+  struct arena* arena = pipeline->arena;
   for (unsigned i = 0; i < pipeline->n_filters; i += 1) {
-    destroy_rolling_quantile_monitor(&pipeline->filters[i].monitor);
+    if (pipeline->filters[i].chain != NULL)
+      destroy_rolling_quantile_chain_within(arena, pipeline->filters[i].chain);
+    else if (pipeline->filters[i].timed != NULL)
+      destroy_timed_quantile_monitor(pipeline->filters[i].timed);
+    else if (pipeline->filters[i].sketch != NULL)
+      destroy_sliding_sketch_within(arena, pipeline->filters[i].sketch);
+    else
+      destroy_rolling_quantile_monitor_within(arena, &pipeline->filters[i].monitor);
     struct high_pass_buffer* buffer = pipeline->filters[i].high_pass_buffer;
-    if (buffer != NULL) destroy_high_pass_buffer(buffer);
+    if (buffer != NULL) destroy_high_pass_buffer(arena, buffer);
   }
-  free(pipeline);
+  leave_arena(arena); // along with the descriptions and the pipeline itself, if it was the last tenant
 }
@@ -18,6 +18,7 @@
 #define FILTER_H
 
 #include "quantile.h"
+#include "sketch.h"
 
 /*
   For a high-pass, wherein I would subtract a smoothed signal from the raw, I
@@ -29,6 +30,15 @@
       functionality/"DSL".
  */
 
+/*
+  Pipelines may branch. Every stage feeds off of the raw input or of one stage before it,
+  `skip` stages back from the one right before it, so that a plain cascade leaves them all
+  at zero. Several stages may then feed off of one, which runs only once for all of them.
+  The stages marked as taps report their outputs side by side, in order, and when none is
+  marked, every stage that feeds no other does. On steps where a tap's own subsampling
+  or that of any stage upstream holds it back, its columns are NaN.
+ */
+
 /*
   The high-pass filter does not support missing values demarcated by NaN, as
   that mode relies upon the raw signal's availability. One could affix a
@@ -36,8 +46,19 @@
   they have a chance of entering the high-pass filter down the line.
  */
 
+/*
+  Hampel stages despike. They compare the middle of the window, as the high pass does, against
+  the window's median and its median absolute deviation (scaled to match a standard deviation
+  under normal noise), both out of the same ordered state. HAMPEL passes the middle entry through
+  unless it lies more than `threshold` deviations off, in which case the median takes its place.
+  HAMPEL_SCORE reports how many deviations off it lies instead, as a robust z-score: zero on the
+  median itself, even in a window without spread, and infinite off it in one. They select
+  by rank, so the heaps are out: windows go to the sorted array or the tree when left to choose.
+ */
+#define MAD_TO_DEVIATION 1.482602218505602 // one over the normal distribution's third quartile
+
 enum cascade_mode {
-  HIGH_PASS, LOW_PASS
+  HIGH_PASS, LOW_PASS, HAMPEL, HAMPEL_SCORE
 };
 
 struct cascade_description {
@@ -46,6 +67,17 @@ struct cascade_description {
   struct interpolation interpolation; // if NAN, refer to `portion`
   unsigned subsample_rate;
   enum cascade_mode mode;
+  unsigned n_quantiles; // when positive, the stage reports several interpolated quantiles at once and must come last
+  double* quantiles; // targets that share the above interpolation's alpha and beta
+  enum quantile_engine engine; // AUTOMATIC_ENGINE (zero) goes by the window size
+  double lowest, highest; // the domain of integers that COUNTING_ENGINE tallies, inclusive
+  bool settled; // whether COUNTING_ENGINE was settled on from the type of the first input rather than declared, so that later inputs must keep to its domain
+  unsigned arity; // children per heap node: 2, 4, or 8. zero means binary
+  double duration; // when positive, the window spans this much time (in the units of the timestamps) rather than `window` samples. needs a target quantile
+  double error; // when positive, the stage is approximate to within this fraction of the window in rank. needs a target quantile
+  unsigned skip; // how many stages to skip over on the way back to the one this one feeds off of. see above
+  bool tap; // whether to report this stage's outputs
+  double threshold; // for HAMPEL, how many scaled deviations off the median make an outlier
 };
 
 struct high_pass_buffer;
@@ -55,17 +87,49 @@ struct cascade_filter {
   unsigned clock;
   unsigned subsample_rate;
   struct high_pass_buffer* high_pass_buffer; // set to NULL when a low pass is desired
+  struct rolling_quantile_chain* chain; // takes the place of `monitor` when several quantiles are desired
+  struct timed_quantile* timed; // takes the place of `monitor` when the window spans time, and of the high-pass buffer too
+  struct sliding_sketch* sketch; // takes the place of `monitor` for approximate stages
+  enum cascade_mode mode; // for the two above, which have no high-pass buffer, and for Hampel stages
+  double threshold; // only for HAMPEL
+  bool tapped; // whether marked as a tap, or implicitly so
+  bool ticked; // whether it let an output through on the current step, for the stages that branch off of it
+  double latest; // that output
 };
 
 struct filter_pipeline {
   unsigned n_filters;
+  unsigned width; // number of outputs per entry
+  bool timed; // whether any stage spans time, in which case every entry should come with a timestamp
+  bool branched; // whether it is anything but a plain cascade that reports its last stage
+  struct cascade_description* descriptions; // our own copy, from which pristine twins may be made
+  struct arena* arena; // that this and every fixed-size piece of it were carved out of, possibly shared with others. see arena.h
   struct cascade_filter filters[];
 };
 
 struct cascade_filter create_cascade_filter(struct cascade_description description);
+struct cascade_filter create_cascade_filter_within(struct arena* arena, struct cascade_description description);
 struct filter_pipeline* create_filter_pipeline(unsigned n_filters, struct cascade_description* descriptions);
-double feed_filter_pipeline(struct filter_pipeline* pipeline, double entry);
+bool create_filter_pipelines(unsigned n_pipelines, unsigned n_filters, struct cascade_description* descriptions, struct filter_pipeline** pipelines); // a pool of alike ones in a single arena, for banks. false if the descriptions are invalid
+double feed_filter_pipeline(struct filter_pipeline* pipeline, double entry); // for pipelines of unit width, a lone target quantile included
+void feed_filter_pipeline_into(struct filter_pipeline* pipeline, double entry, double* outputs); // writes `width` outputs
+double feed_filter_pipeline_at(struct filter_pipeline* pipeline, double entry, double timestamp); // the above, for timed pipelines
+void feed_filter_pipeline_at_into(struct filter_pipeline* pipeline, double entry, double timestamp, double* outputs);
+size_t measure_pipeline_memory(struct filter_pipeline* pipeline); // how many entries back any output may look, subsampling included
+unsigned measure_pipeline_stride(struct filter_pipeline* pipeline); // between the last stage's outputs
+int locate_stage_source(struct filter_pipeline* pipeline, unsigned stage); // the index of the stage it feeds off of, or -1 for the raw input
+unsigned locate_pipeline_phase(struct filter_pipeline* pipeline); // entries fed so far, modulo the stride
+size_t bound_pipeline_outputs(struct filter_pipeline* pipeline, size_t n_entries); // at most how many of the next `n_entries` could yield outputs
+size_t feed_filter_pipeline_compactly(struct filter_pipeline* pipeline, const double* input, const double* timestamps, size_t n_entries, double* outputs, size_t* indices); // only writes `width` outputs for the entries that yield any, and their positions in `input` unless `indices` is NULL. returns how many. `timestamps` may be NULL for pipelines that don't span time
+struct filter_pipeline* feed_filter_pipeline_in_chunks(struct filter_pipeline* pipeline, const double* input, double* outputs, size_t n_entries, unsigned n_threads); // returns the pipeline that now holds the state. if that is a new one, the original is destroyed
+struct filter_pipeline* count_filter_pipeline_over_domain(struct filter_pipeline* pipeline, double lowest, double highest); // a pristine twin whose first stage counts integers, or NULL if it had better not
+size_t save_filter_pipelines(struct filter_pipeline** pipelines, unsigned n_channels, unsigned char* buffer); // the channels of a bank, or zero for a lone pipeline. returns the length, and only measures when `buffer` is NULL
+struct filter_pipeline** restore_filter_pipelines(const unsigned char* buffer, size_t length, unsigned* n_channels); // NULL if the snapshot is malformed or of another version. see state.h
+void tally_stage_operations(struct cascade_filter* filter, struct operation_counters* sums); // adds this stage's counters, heaps and all, onto `sums`. see counters.h
 bool verify_pipeline(struct filter_pipeline* pipeline);
+void reset_filter_pipeline(struct filter_pipeline* pipeline); // back to its state when made, in place, with nothing reallocated
+struct filter_pipeline* clone_filter_pipeline(struct filter_pipeline* pipeline); // a pristine twin that takes over a copy of its state, warmed up or not
+bool clone_filter_pipelines(struct filter_pipeline** pipelines, unsigned n_pipelines, struct filter_pipeline** clones); // the whole bank, into one pool
 void destroy_filter_pipeline(struct filter_pipeline* pipeline);
 
 
@@ -23,25 +23,83 @@
 #include <string.h>
 #include <stdio.h>
 
+
+static size_t size_queue(unsigned size) {
+  return sizeof(struct ring_buffer) + size*sizeof(unsigned) + size*sizeof(unsigned short);
+}
+
+size_t measure_queue(unsigned size) {
+  return align_to_cache_line(size_queue(size));
+}
+
 struct ring_buffer* create_queue(unsigned size) {
-  unsigned buffer_size = size * sizeof(ring_buffer_elem);
-  struct ring_buffer* buffer = malloc(sizeof(struct ring_buffer) + buffer_size);
+  return create_queue_within(NULL, size);
+}
+
+struct ring_buffer* create_queue_within(struct arena* arena, unsigned size) {
+  size_t positions_size = size * sizeof(unsigned);
+  struct ring_buffer* buffer = allocate_within(arena, size_queue(size));
   buffer->size = size;
   buffer->n_entries = 0;
-  buffer->head = &buffer->entries[0]; // slight semantic (NOT teleological) distinction between this and `buffer->entries`
-  memset(buffer->entries, 0, buffer_size);
+  buffer->head = 0;
+  buffer->n_heaps = 0;
+  buffer->owners = (unsigned short*)((char*)buffer->positions + positions_size);
+  memset(buffer->owners, 0, size*sizeof(unsigned short)); // all VACANT_OWNER
   return buffer;
 }
 
-struct heap* create_heap(enum heap_mode mode, unsigned size, struct ring_buffer* queue) {
-  unsigned n_entries = size; // not necessarily trivial
-  struct heap* data = calloc(1, sizeof(struct heap) + n_entries*sizeof(struct heap_element)); // calloc in order to ensure our elements are zeroed out
+static const struct heap_sifts* resolve_heap_sifts(enum heap_mode mode, unsigned arity); // defined further down, next to the sifts themselves
+
+bool is_valid_heap_arity(unsigned arity) {
+  return (arity == 2) || (arity == 4) || (arity == 8);
+}
+
+static size_t size_heap(unsigned size) {
+  return sizeof(struct heap) + size*sizeof(double) + size*sizeof(unsigned);
+}
+
+size_t measure_heap(unsigned size) {
+  return align_to_cache_line(size_heap(size));
+}
+
+struct heap* create_d_ary_heap(enum heap_mode mode, unsigned arity, unsigned size, struct ring_buffer* queue) {
+  return create_d_ary_heap_within(NULL, mode, arity, size, queue);
+}
+
+struct heap* create_d_ary_heap_within(struct arena* arena, enum heap_mode mode, unsigned arity, unsigned size, struct ring_buffer* queue) {
+  if (!is_valid_heap_arity(arity) || ((mode == MIN_MAX_HEAP) && (arity != 2)))
+    return NULL;
+  if (queue->n_heaps >= MAX_HEAPS_PER_QUEUE)
+    return NULL;
+  size_t keys_size = size * sizeof(double); // keeps `slots` aligned, too
+  struct heap* data = allocate_within(arena, size_heap(size));
   data->mode = mode;
+  data->sifts = resolve_heap_sifts(mode, arity);
+  data->arity = arity;
+  data->tag = FIRST_HEAP_OWNER + queue->n_heaps++;
   data->size = size;
+  data->n_entries = 0;
   data->queue = queue;
+  data->slots = (unsigned*)((char*)data->keys + keys_size);
+  data->counters = (struct operation_counters) {0};
   return data;
 }
 
+struct heap* create_heap(enum heap_mode mode, unsigned size, struct ring_buffer* queue) {
+  return create_d_ary_heap(mode, 2, size, queue);
+}
+
+void clear_queue(struct ring_buffer* queue) {
+  queue->n_entries = 0;
+  queue->head = 0;
+  memset(queue->owners, 0, queue->size*sizeof(unsigned short)); // VACANT_OWNER again, while the heaps stay attached
+}
+
+void clear_heap(struct heap* heap) {
+  heap->n_entries = 0;
+  heap->counters = (struct operation_counters) {0};
+}
+
 void destroy_queue(struct ring_buffer* queue) {
   free(queue);
 }
@@ -60,195 +118,338 @@ bool is_ring_buffer_empty(struct ring_buffer* buffer) {
 
 void advance_ring_buffer(struct ring_buffer* buffer) {
   buffer->head++;
-  if (buffer->head == (buffer->entries + buffer->size)) {
-    buffer->head = buffer->entries;
+  if (buffer->head == buffer->size) {
+    buffer->head = 0;
   }
 }
 
-static // buffer does not have to be full as long as it isn't empty, but it might return NULL if it isn't full
-ring_buffer_elem extract_oldest_entry_from_ring_buffer(struct ring_buffer* buffer) { // removes the entry too, and increments the head
-  struct heap_element* entry = *buffer->head;
-  *buffer->head = NULL;
-  return entry;
+// every key inside a heap has a queue slot, so the links need no null checks
+static inline
+void relink_in_queue(struct heap* heap, unsigned i) {
+  heap->queue->positions[heap->slots[i]] = i;
 }
 
 static
-ring_buffer_elem* get_next_position_in_ring_buffer(struct ring_buffer* buffer) {
-  return buffer->head;
+void swap_elements_in_heap(struct heap* heap, unsigned a, unsigned b) {
+  double key = heap->keys[a];
+  unsigned slot = heap->slots[a];
+  heap->keys[a] = heap->keys[b];
+  heap->slots[a] = heap->slots[b];
+  heap->keys[b] = key;
+  heap->slots[b] = slot;
+  relink_in_queue(heap, a);
+  relink_in_queue(heap, b);
+  COUNT_OPERATIONS(heap->counters, swaps, 1);
 }
 
-static
-void xor_swap(void* a, void* b, size_t size) { // overkill hahah. do it byte by byte so that we are data-type agnostic
-  char* a_bytes = a;
-  char* b_bytes = b;
-  for (size_t i = 0; i < size; i += 1) {
-    a_bytes[i] ^= b_bytes[i];
-    b_bytes[i] ^= a_bytes[i];
-    a_bytes[i] ^= b_bytes[i];
-  }
+/*
+  Hole-based moves. Rather than swapping the sifted element at every level (three
+  copies and two queue fixups apiece), hold it aside, shift each displaced element
+  into the hole with a single copy, and drop the held element in at the very end.
+ */
+static inline
+void move_into_hole(struct heap* heap, unsigned hole, unsigned from) {
+  heap->keys[hole] = heap->keys[from];
+  heap->slots[hole] = heap->slots[from];
+  relink_in_queue(heap, hole);
+  COUNT_OPERATIONS(heap->counters, swaps, 1);
 }
 
-static
-void plain_swap(void* a, void* b, size_t size) {
-  char* a_bytes = a;
-  char* b_bytes = b;
-  for (size_t i = 0; i < size; i += 1) {
-    char c = a_bytes[i];
-    a_bytes[i] = b_bytes[i];
-    b_bytes[i] = c;
-  }
+static inline
+void fill_hole(struct heap* heap, unsigned hole, double key, unsigned slot) {
+  heap->keys[hole] = key;
+  heap->slots[hole] = slot;
+  relink_in_queue(heap, hole);
 }
 
-static
-void swap(void* a, void* b, size_t size) {
-  plain_swap(a, b, size);
-}
+#define PRECEDES_IN_MAX_HEAP(a, b) ((a) > (b))
+#define PRECEDES_IN_MIN_HEAP(a, b) ((a) < (b))
 
-static
-void swap_elements_in_heap(struct heap_element* a, struct heap_element* b) {
-  swap(&a->member, &b->member, sizeof(double));
-  /*if (a->loc_in_buffer && b->loc_in_buffer) { swap with actual addresses, rather than queue entries
-    swap(a->loc_in_buffer, b->loc_in_buffer, sizeof(struct heap_element*));
-  } else*/
-  if (a->loc_in_buffer) {
-    *a->loc_in_buffer = b;
+// stamps out iterative sifts for a heap of some ARITY whose front is the element that PRECEDES all others
+#define DEFINE_HEAP_SIFTS(kind, PRECEDES, ARITY) \
+  static unsigned sift_down_##kind(struct heap* heap, unsigned i) { \
+    double* keys = heap->keys; \
+    unsigned n_entries = heap->n_entries; \
+    if (i >= n_entries) /* the vacated slot past the end when the removed element was last */ \
+      return i; \
+    double key = keys[i]; \
+    unsigned slot = heap->slots[i]; \
+    for (unsigned first_child = ARITY*i + 1; first_child < n_entries; first_child = ARITY*i + 1) { \
+      unsigned child = first_child; \
+      unsigned last_child = (first_child + ARITY <= n_entries)? (first_child + ARITY) : n_entries; \
+      for (unsigned sibling = first_child + 1; sibling < last_child; sibling += 1) { \
+        if (PRECEDES(keys[sibling], keys[child])) \
+          child = sibling; \
+      } \
+      if (!PRECEDES(keys[child], key)) \
+        break; \
+      move_into_hole(heap, i, child); \
+      COUNT_OPERATIONS(heap->counters, sift_down_steps, 1); \
+      i = child; \
+    } \
+    fill_hole(heap, i, key, slot); \
+    return i; \
+  } \
+  static unsigned sift_up_##kind(struct heap* heap, unsigned i) { \
+    double* keys = heap->keys; \
+    double key = keys[i]; \
+    unsigned slot = heap->slots[i]; \
+    while (i > 0) { \
+      unsigned parent = (i - 1) / ARITY; \
+      if (!PRECEDES(key, keys[parent])) \
+        break; \
+      move_into_hole(heap, i, parent); \
+      COUNT_OPERATIONS(heap->counters, sift_up_steps, 1); \
+      i = parent; \
+    } \
+    fill_hole(heap, i, key, slot); \
+    return i; \
   }
-  if (b->loc_in_buffer) {
-    *b->loc_in_buffer = a;
-  }
-  swap(&a->loc_in_buffer, &b->loc_in_buffer, sizeof(struct heap_element**));
+
+DEFINE_HEAP_SIFTS(max_2, PRECEDES_IN_MAX_HEAP, 2)
+DEFINE_HEAP_SIFTS(min_2, PRECEDES_IN_MIN_HEAP, 2)
+DEFINE_HEAP_SIFTS(max_4, PRECEDES_IN_MAX_HEAP, 4)
+DEFINE_HEAP_SIFTS(min_4, PRECEDES_IN_MIN_HEAP, 4)
+DEFINE_HEAP_SIFTS(max_8, PRECEDES_IN_MAX_HEAP, 8)
+DEFINE_HEAP_SIFTS(min_8, PRECEDES_IN_MIN_HEAP, 8)
+
+static bool is_on_minimum_level(unsigned i) { // even depths hold minima in a MIN_MAX_HEAP
+  unsigned depth = 0;
+  for (unsigned j = i + 1; j > 1; j >>= 1)
+    depth += 1;
+  return (depth % 2) == 0;
+}
+
+static bool is_more_extreme(bool minimum_level, double a, double b) { // whether `a` ought to sit above `b` on this kind of level
+  return minimum_level? (a < b) : (a > b);
 }
 
+/*
+  Double-ended sifts, after Atkinson et al. (1986). Each node on a minimum level is
+  no greater than everything below it, and vice versa on a maximum level.
+  The downward sift returns wherever the original element came to rest, since it
+  may need to travel back up when it was transplanted from elsewhere in the heap.
+ */
 static
-void trickle_down(struct heap* heap, unsigned i) { // conscious of the tags in the queue that may be invalidated
-  struct heap_element* node         = heap->elements + i;
-  struct heap_element* first_child  = heap->elements + (2*i + 1);
-  struct heap_element* second_child = heap->elements + (2*i + 2);
-  struct heap_element* limit = heap->elements + heap->n_entries;
-  if (heap->mode == MAX_HEAP) {
-    if (first_child >= limit) {
-      if (second_child >= limit)
-        return;
-      if (node->member < second_child->member)
-        swap_elements_in_heap(second_child, node);
-      return;
-    }
-    if (second_child >= limit) {
-      if (node->member < first_child->member)
-        swap_elements_in_heap(first_child, node);
-      return;
+unsigned trickle_down_min_max(struct heap* heap, unsigned i) {
+  double* keys = heap->keys;
+  unsigned n_entries = heap->n_entries;
+  unsigned resting_place = i;
+  bool tracking = true; // stop following the original element once it parks in an intermediate level
+  for (;;) {
+    bool minimum_level = is_on_minimum_level(i);
+    unsigned first_child = 2*i + 1;
+    if (first_child >= n_entries)
+      return resting_place;
+    unsigned extremum = first_child;
+    unsigned descendants[] = {2*i + 2, 4*i + 3, 4*i + 4, 4*i + 5, 4*i + 6}; // sibling and then all grandchildren
+    for (unsigned d = 0; d < sizeof(descendants)/sizeof(unsigned); d += 1) {
+      unsigned candidate = descendants[d];
+      if (candidate < n_entries &&
+          is_more_extreme(minimum_level, keys[candidate], keys[extremum]))
+        extremum = candidate;
     }
-    if ((node->member > first_child->member) && (node->member > second_child->member))
-      return;
-    if (first_child->member > second_child->member) {
-      swap_elements_in_heap(first_child, node);
-      trickle_down(heap, 2*i + 1);
-    } else {
-      swap_elements_in_heap(second_child, node);
-      trickle_down(heap, 2*i + 2); // tail-call optimized
+    if (!is_more_extreme(minimum_level, keys[extremum], keys[i]))
+      return resting_place;
+    swap_elements_in_heap(heap, extremum, i);
+    COUNT_OPERATIONS(heap->counters, sift_down_steps, 1);
+    if (extremum <= first_child + 1) { // a child, so it's as far as we go
+      return tracking? extremum : resting_place;
     }
-  } else if (heap->mode == MIN_HEAP) {
-    if (first_child >= limit) { // redundant, since the first child is always right before the second child.
-      if (second_child >= limit)
-        return;
-      if (node->member > second_child->member)
-        swap_elements_in_heap(second_child, node);
-      return;
-    }
-    if (second_child >= limit) {
-      if (node->member > first_child->member)
-        swap_elements_in_heap(first_child, node);
-      return;
-    }
-    if ((node->member < first_child->member) && (node->member < second_child->member))
-      return;
-    if (first_child->member < second_child->member) {
-      swap_elements_in_heap(first_child, node);
-      trickle_down(heap, 2*i + 1);
-    } else {
-      swap_elements_in_heap(second_child, node);
-      trickle_down(heap, 2*i + 2);
+    unsigned parent = (extremum - 1) / 2;
+    if (tracking)
+      resting_place = extremum;
+    if (is_more_extreme(minimum_level, keys[parent], keys[extremum])) {
+      swap_elements_in_heap(heap, parent, extremum);
+      if (tracking)
+        resting_place = parent;
+      tracking = false;
     }
+    i = extremum;
   }
 }
 
 static
-unsigned trickle_up(struct heap* heap, unsigned i) {
+unsigned trickle_up_min_max(struct heap* heap, unsigned i) {
+  double* keys = heap->keys;
   if (i == 0) return 0;
-  unsigned pos = i;
-  unsigned parent_index = (i-1) / 2;
-  struct heap_element* node   = &heap->elements[i];
-  struct heap_element* parent = &heap->elements[parent_index]; // division should be efficient
-  if (heap->mode == MAX_HEAP) {
-    if (node->member > parent->member) {
-      swap_elements_in_heap(parent, node);
-      return trickle_up(heap, parent_index);
-    }
-  } else if (heap->mode == MIN_HEAP) {
-    if (node->member < parent->member) {
-      swap_elements_in_heap(parent, node);
-      return trickle_up(heap, parent_index);
-    }
+  bool minimum_level = is_on_minimum_level(i);
+  unsigned parent = (i - 1) / 2;
+  if (is_more_extreme(!minimum_level, keys[i], keys[parent])) { // belongs on the other kind of level
+    swap_elements_in_heap(heap, parent, i);
+    COUNT_OPERATIONS(heap->counters, sift_up_steps, 1);
+    i = parent;
+    minimum_level = !minimum_level;
+  }
+  while (i >= 3) { // has a grandparent
+    unsigned grandparent = ((i - 1)/2 - 1) / 2;
+    if (!is_more_extreme(minimum_level, keys[i], keys[grandparent]))
+      break;
+    swap_elements_in_heap(heap, grandparent, i);
+    COUNT_OPERATIONS(heap->counters, sift_up_steps, 1);
+    i = grandparent;
   }
-  return pos;
+  return i;
 }
 
-bool belongs_to_this_heap(struct heap* heap, struct heap_element* elem) { // when we come from a queue connected to many heaps, we need to locate the heap that contains each element
-  return (elem >= heap->elements) && (elem < (heap->elements + heap->n_entries));
+static
+unsigned sift_min_max(struct heap* heap, unsigned i) { // goes both ways, since a transplanted element may also need to rise
+  if (i >= heap->n_entries) // the vacated slot past the end when the removed element was last
+    return i;
+  return trickle_up_min_max(heap, trickle_down_min_max(heap, i));
 }
 
-void remove_front_element_from_heap(struct heap* heap, struct heap_element* dest) { // the circular queue still maintains its order, and simply skips over the entries that have already been extracted when it's their time to expire
+static const struct heap_sifts sifts_by_arity[][MIN_MAX_HEAP] = { // binary, quaternary, and octonary; then by mode
+  { [MAX_HEAP] = { .down = sift_down_max_2, .up = sift_up_max_2 },
+    [MIN_HEAP] = { .down = sift_down_min_2, .up = sift_up_min_2 } },
+  { [MAX_HEAP] = { .down = sift_down_max_4, .up = sift_up_max_4 },
+    [MIN_HEAP] = { .down = sift_down_min_4, .up = sift_up_min_4 } },
+  { [MAX_HEAP] = { .down = sift_down_max_8, .up = sift_up_max_8 },
+    [MIN_HEAP] = { .down = sift_down_min_8, .up = sift_up_min_8 } },
+};
+
+static const struct heap_sifts min_max_sifts = { .down = sift_min_max, .up = trickle_up_min_max };
+
+static const struct heap_sifts* resolve_heap_sifts(enum heap_mode mode, unsigned arity) {
+  if (mode == MIN_MAX_HEAP)
+    return &min_max_sifts;
+  unsigned row = (arity == 8)? 2 : ((arity == 4)? 1 : 0);
+  return &sifts_by_arity[row][mode];
+}
+
+static inline
+void trickle_down(struct heap* heap, unsigned i) { // conscious of the tags in the queue that may be invalidated
+  heap->sifts->down(heap, i);
+}
+
+static inline
+unsigned trickle_up(struct heap* heap, unsigned i) {
+  return heap->sifts->up(heap, i);
+}
+
+static
+void remove_element_from_heap(struct heap* heap, unsigned index, struct heap_element* dest) {
   if (heap->n_entries == 0) {
-    *dest = (struct heap_element) { .member = NAN, .loc_in_buffer = NULL };
+    *dest = (struct heap_element) { .member = NAN, .slot = NO_SLOT };
     return;
   }
-  struct heap_element* last_node = heap->elements + heap->n_entries - 1;
-  struct heap_element* root_node = heap->elements;
-  //struct heap_element extremum = *root_node;
-  swap_elements_in_heap(root_node, last_node);
+  dest->member = heap->keys[index];
+  dest->slot = heap->slots[index];
+  heap->queue->owners[dest->slot] = LOOSE_OWNER; // the circular queue still maintains its order
   heap->n_entries -= 1;
-  trickle_down(heap, 0);
-  //*extremum.loc_in_buffer = NULL; // clear our entry in the queue so that it doesn't mess up the guy that takes our address. keep track of loc_in_buffer so that it can be updated later.
-  swap_elements_in_heap(last_node, dest); // `last_node` cannot be affected by the trickler
-  if (last_node->loc_in_buffer != NULL) {
-    // since `swap_elements_in_heap` is quite aggressive with restoring previously-null queue entries, clear this out for the case that it is never brought back
-    // honestly, the (teleological! post hoc?) reasoning behind this line is a little confusing
-    *last_node->loc_in_buffer = NULL;
+  unsigned last = heap->n_entries;
+  if (index == last)
+    return;
+  move_into_hole(heap, index, last);
+  trickle_down(heap, index);
+}
+
+void remove_front_element_from_heap(struct heap* heap, struct heap_element* dest) { // the circular queue still maintains its order, and simply skips over the entries that have already been extracted when it's their time to expire
+  remove_element_from_heap(heap, 0, dest);
+}
+
+static unsigned locate_back_of_min_max_heap(struct heap* heap) { // the maximum lies on the first level below the root
+  if (heap->n_entries < 3)
+    return heap->n_entries - 1; // which is the root itself when alone
+  return (heap->keys[1] > heap->keys[2])? 1 : 2;
+}
+
+void remove_back_element_from_heap(struct heap* heap, struct heap_element* dest) {
+  if (heap->n_entries == 0) {
+    remove_element_from_heap(heap, 0, dest); // fills in the void
+    return;
   }
+  remove_element_from_heap(heap, locate_back_of_min_max_heap(heap), dest);
 }
 
 double view_front_of_heap(struct heap* heap) {
   if (heap->n_entries == 0)
     return NAN;
-  return heap->elements[0].member;
+  return heap->keys[0];
 }
 
-struct heap_element* add_value_to_heap(struct heap* heap, double value) {
-  // note: cannot swap into this local variable, even though its own `loc_in_buffer` is empty
-  struct heap_element new_entry = {
-    .member = value,
-    .loc_in_buffer = NULL };
-  return add_element_to_heap(heap, new_entry);
+double view_back_of_heap(struct heap* heap) {
+  if (heap->n_entries == 0)
+    return NAN;
+  return heap->keys[locate_back_of_min_max_heap(heap)];
+}
+
+double view_runner_up_of_heap(struct heap* heap) { // the candidates are the children of the root, along with its grandchildren when the levels alternate
+  unsigned last_candidate = (heap->mode == MIN_MAX_HEAP)? 6 : heap->arity;
+  bool minimum_front = (heap->mode != MAX_HEAP);
+  double runner_up = NAN;
+  for (unsigned i = 1; (i <= last_candidate) && (i < heap->n_entries); i += 1) {
+    double candidate = heap->keys[i];
+    if (isnan(runner_up) || is_more_extreme(minimum_front, candidate, runner_up))
+      runner_up = candidate;
+  }
+  return runner_up;
+}
+
+void add_element_to_heap(struct heap* heap, struct heap_element new_elem) {
+  if (heap->n_entries == heap->size)
+    return; // BY DESIGN SHOULD NEVER HAPPEN
+  unsigned index_to_place = heap->n_entries++;
+  heap->keys[index_to_place] = new_elem.member;
+  heap->slots[index_to_place] = new_elem.slot;
+  heap->queue->owners[new_elem.slot] = (unsigned short)heap->tag; // take ownership before trickling up, so that the correct position is propagated
+  relink_in_queue(heap, index_to_place); // in case it stays put
+  trickle_up(heap, index_to_place);
+}
+
+static unsigned claim_queue_slot(struct ring_buffer* queue) {
+  queue->n_entries += 1;
+  return queue->head;
 }
 
 // there is a shortcut path for inserting and then immediately extracting. Consider implementing that as a special case.
-struct heap_element* add_element_to_heap(struct heap* heap, struct heap_element new_elem) { // returns new heap element, not -> if it popped its oldest member in order to make space, then it returns heap_element with loc_in_buffer repurposed to act like an optional value's flag
+unsigned enqueue_value_into_heap(struct heap* heap, double value) {
   if (heap->n_entries == heap->size)
-    return NULL; // (struct heap_element) { .member = NAN, .loc_in_buffer = NULL };
-  unsigned index_to_place = heap->n_entries;
-  heap->elements[index_to_place] = new_elem;
-  if (new_elem.loc_in_buffer != NULL) { // if this element was taken from a different heap, rectify its stale pointer. do it before trickling up, so that the correct pointer is propagated
-    *new_elem.loc_in_buffer = heap->elements + index_to_place;
+    return NO_SLOT;
+  unsigned slot = claim_queue_slot(heap->queue);
+  unsigned index_to_place = heap->n_entries++;
+  heap->keys[index_to_place] = value;
+  heap->slots[index_to_place] = slot;
+  heap->queue->owners[slot] = (unsigned short)heap->tag;
+  relink_in_queue(heap, index_to_place);
+  return trickle_up(heap, index_to_place);
+}
+
+void enqueue_loose_element(struct ring_buffer* queue, struct heap_element* elem) { // modifies element to point to a fresh spot on the queue. will expire on its own after some time.
+  elem->slot = claim_queue_slot(queue);
+  queue->owners[elem->slot] = LOOSE_OWNER;
+}
+
+static
+void evict_element_from_heap(struct heap* heap, unsigned index_of_oldest) {
+  unsigned last = --heap->n_entries;
+  if (index_of_oldest == last)
+    return;
+  double oldest_value = heap->keys[index_of_oldest];
+  double last_value = heap->keys[last];
+  move_into_hole(heap, index_of_oldest, last); // no need to void the last slot, since we'll immediately add a new one on top of it
+  if (heap->mode == MIN_MAX_HEAP) {
+    trickle_down(heap, index_of_oldest); // which already goes both ways
+  } else if ((heap->mode == MIN_HEAP && oldest_value < last_value) ||
+      (heap->mode == MAX_HEAP && oldest_value > last_value)) {
+    trickle_down(heap, index_of_oldest); // we moved the last guy on top of the oldest, so we may have to trickle it down again
+  } else {
+    trickle_up(heap, index_of_oldest); // the element that got transplanted may have to go up or down depending on which parent it lands. comparing it to the previous occupant tells us which
   }
-  heap->n_entries += 1;
-  unsigned index_placed = trickle_up(heap, index_to_place);
-  return heap->elements + index_placed;
 }
 
-void register_in_queue(struct ring_buffer* queue, struct heap_element* elem) {
-  queue->n_entries += 1;
-  elem->loc_in_buffer = get_next_position_in_ring_buffer(queue);
-  *elem->loc_in_buffer = elem;
+static
+unsigned pop_stale_entry_from_queue(struct ring_buffer* queue, unsigned* position) { // returns who owned it
+  if (is_ring_buffer_empty(queue))
+    return VACANT_OWNER;
+  unsigned slot = queue->head;
+  unsigned owner = queue->owners[slot];
+  if (owner == VACANT_OWNER)
+    return VACANT_OWNER;
+  queue->owners[slot] = VACANT_OWNER;
+  *position = queue->positions[slot];
+  queue->n_entries -= 1;
+  return owner;
 }
 
 /*
@@ -256,65 +457,123 @@ void register_in_queue(struct ring_buffer* queue, struct heap_element* elem) {
   -> if -1, the queue was already empty
   -> if 0, the expired entry did not belong to a heap
   -> if positive, then the index of the expired entry's heap (1-based)
+  The owner's tag says outright which heap to evict from, given that the heaps
+  are passed in the order they were attached to the queue.
  */
 int expire_stale_entry_in_queue(struct ring_buffer* queue, unsigned n_heaps, ...) {
-  //if (!is_ring_buffer_full(queue)) drastic change of behavior since this...
-  //  return true;
-  if (is_ring_buffer_empty(queue))
+  unsigned position;
+  unsigned owner = pop_stale_entry_from_queue(queue, &position);
+  if (owner == VACANT_OWNER)
     return -1;
-  struct heap_element* oldest_elem = extract_oldest_entry_from_ring_buffer(queue);
-  if (oldest_elem == NULL)
-    return -1;
-  if (queue->n_entries > 0) { // this better not happen, but have a safeguard just in case...
-    queue->n_entries -= 1;
-  }
+  if (owner == LOOSE_OWNER)
+    return 0;
+  unsigned index = owner - FIRST_HEAP_OWNER;
+  if (index >= n_heaps)
+    return 0;
   va_list heaps;
   va_start(heaps, n_heaps);
-  unsigned i;
-  for (i = 0; i < n_heaps; i += 1) {
-    struct heap* heap = va_arg(heaps, struct heap*);
-    if (!belongs_to_this_heap(heap, oldest_elem))
-      continue;
-    //*oldest_elem->loc_in_buffer = NULL; // signal that it's already been removed. since we already advanced the buffer, we may not have to do this in practice.
-    struct heap_element* last_elem = heap->elements + heap->n_entries - 1;
-    heap->n_entries -= 1;
-    if (last_elem != oldest_elem) {
-      double oldest_value = oldest_elem->member;
-      double last_value = last_elem->member;
-      *oldest_elem = *last_elem; // last_entry will stay in the queue after another entry is added, since oldest_entry will be thrown instead. no need to void last_entry since we'll immediately add a new one on top of it
-      *last_elem->loc_in_buffer = oldest_elem; // in the end, we are swapping without care for the ultimate contents of the old last_elem
-      unsigned index_of_oldest = oldest_elem - heap->elements;
-      if ((heap->mode == MIN_HEAP && oldest_value < last_value) ||
-          (heap->mode == MAX_HEAP && oldest_value > last_value)) {
-        trickle_down(heap, index_of_oldest); // we moved the last guy on top of the oldest, so we may have to trickle it down again
-      } else {
-        trickle_up(heap, index_of_oldest); // DID THIS: can I somehow avoid having to do both? as it is, the last element that got transplanted may have to go up or down depending on which parent it lands. I know! If this really becomes an issue, I may compare this element to the previous occupant to know which direction it should take.
-      }
-    }
-    break;
-  }
+  struct heap* heap = NULL;
+  for (unsigned i = 0; i <= index; i += 1)
+    heap = va_arg(heaps, struct heap*);
   va_end(heaps);
-  if (i < n_heaps) { // did we locate an owner heap?
-    return (int)(i + 1);
-  } else {
+  evict_element_from_heap(heap, position);
+  return (int)(index + 1);
+}
+
+int expire_stale_entry_in_queue_among(struct ring_buffer* queue, unsigned n_heaps, struct heap** heaps) {
+  unsigned position;
+  unsigned owner = pop_stale_entry_from_queue(queue, &position);
+  if (owner == VACANT_OWNER)
+    return -1;
+  unsigned index = owner - FIRST_HEAP_OWNER;
+  if ((owner == LOOSE_OWNER) || (index >= n_heaps))
     return 0;
+  evict_element_from_heap(heaps[index], position);
+  return (int)(index + 1);
+}
+
+static bool verify_min_max_heap(struct heap* heap) { // checking against the parent and grandparent suffices by transitivity
+  for (unsigned i = 1; i < heap->n_entries; i += 1) {
+    unsigned parent = (i - 1) / 2;
+    double member = heap->keys[i];
+    if (is_more_extreme(is_on_minimum_level(parent), member, heap->keys[parent]))
+      return false;
+    if (parent == 0)
+      continue;
+    unsigned grandparent = (parent - 1) / 2;
+    if (is_more_extreme(is_on_minimum_level(grandparent), member, heap->keys[grandparent]))
+      return false;
   }
+  return true;
 }
 
-bool verify_heap(struct heap* heap) {
+static bool verify_queue_links(struct heap* heap) {
+  struct ring_buffer* queue = heap->queue;
   for (unsigned i = 0; i < heap->n_entries; i += 1) {
-    unsigned left_child = 2*i + 1;
-    unsigned right_child = 2*i + 2;
-    if (heap->mode == MAX_HEAP &&
-       ((left_child < heap->n_entries && heap->elements[i].member < heap->elements[left_child].member) ||
-       (right_child < heap->n_entries && heap->elements[i].member < heap->elements[right_child].member))) {
+    unsigned slot = heap->slots[i];
+    if ((slot >= queue->size) || (queue->owners[slot] != heap->tag) || (queue->positions[slot] != i))
       return false;
-    }
-    if (heap->mode == MIN_HEAP &&
-       ((left_child < heap->n_entries && heap->elements[i].member > heap->elements[left_child].member) ||
-       (right_child < heap->n_entries && heap->elements[i].member > heap->elements[right_child].member))) {
+  }
+  return true;
+}
+
+bool verify_heap(struct heap* heap) {
+  if (!verify_queue_links(heap))
+    return false;
+  if (heap->mode == MIN_MAX_HEAP)
+    return verify_min_max_heap(heap);
+  for (unsigned i = 1; i < heap->n_entries; i += 1) {
+    unsigned parent = (i - 1) / heap->arity;
+    if (heap->mode == MAX_HEAP && heap->keys[parent] < heap->keys[i])
+      return false;
+    if (heap->mode == MIN_HEAP && heap->keys[parent] > heap->keys[i])
       return false;
-    }
   }
   return true;
 }
+
+#define ADD_OPERATION_COUNTER(name) sums->name += counters->name;
+
+void add_operation_counters(struct operation_counters* sums, const struct operation_counters* counters) {
+  unsigned long long deepest = (sums->deepest_rebalance > counters->deepest_rebalance)? sums->deepest_rebalance : counters->deepest_rebalance;
+  OPERATION_COUNTERS(ADD_OPERATION_COUNTER)
+  sums->deepest_rebalance = deepest;
+}
+
+void save_queue(struct ring_buffer* queue, struct state_stream* stream) {
+  WRITE_STATE(stream, queue->size);
+  WRITE_STATE(stream, queue->n_entries);
+  WRITE_STATE(stream, queue->head);
+  write_state(stream, queue->positions, queue->size * sizeof(unsigned));
+  write_state(stream, queue->owners, queue->size * sizeof(unsigned short));
+}
+
+void restore_queue(struct ring_buffer* queue, struct state_stream* stream) {
+  expect_state(stream, queue->size);
+  READ_STATE(stream, queue->n_entries);
+  READ_STATE(stream, queue->head);
+  read_state(stream, queue->positions, queue->size * sizeof(unsigned));
+  read_state(stream, queue->owners, queue->size * sizeof(unsigned short));
+  if ((queue->n_entries > queue->size) || (queue->head >= queue->size))
+    stream->failed = true;
+}
+
+void save_heap(struct heap* heap, struct state_stream* stream) {
+  WRITE_STATE(stream, heap->size);
+  WRITE_STATE(stream, heap->n_entries);
+  write_state(stream, heap->keys, heap->n_entries * sizeof(double));
+  write_state(stream, heap->slots, heap->n_entries * sizeof(unsigned));
+}
+
+void restore_heap(struct heap* heap, struct state_stream* stream) {
+  expect_state(stream, heap->size);
+  unsigned n_entries = 0;
+  READ_STATE(stream, n_entries);
+  if (n_entries > heap->size)
+    stream->failed = true;
+  if (stream->failed)
+    return;
+  heap->n_entries = n_entries;
+  read_state(stream, heap->keys, n_entries * sizeof(double));
+  read_state(stream, heap->slots, n_entries * sizeof(unsigned));
+}
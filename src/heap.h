@@ -19,50 +19,96 @@
 
 #include <stddef.h> // no need to hassle over the myriad of different data types provided here, which seem to matter most in the stylized abstract world of the C standard
 #include <stdbool.h>
+#include "state.h"
+#include "counters.h"
+#include "arena.h"
 
 enum heap_mode {
-  MAX_HEAP, MIN_HEAP
+  MAX_HEAP, MIN_HEAP,
+  MIN_MAX_HEAP // double-ended: levels alternate between minima (even depths) and maxima (odd depths). the front is its minimum and the back is its maximum
 };
 
-typedef struct heap_element* ring_buffer_elem;
+#define NO_SLOT ((unsigned)-1)
 
-struct heap_element {
+enum queue_owner { // who holds each entry of a queue. heaps attached to the queue are tagged from FIRST_HEAP_OWNER onward, in order
+  VACANT_OWNER, // already expired or extracted
+  LOOSE_OWNER, // parked outside of any heap, like a monitor's current value
+  FIRST_HEAP_OWNER
+};
+
+#define MAX_HEAPS_PER_QUEUE (0xFFFF - FIRST_HEAP_OWNER) // since the tags are stored in 16 bits
+
+struct heap_element { // a key on its way between heaps, or parked outside of them. heaps themselves store their keys densely
   double member;
-  ring_buffer_elem* loc_in_buffer; // element is marked as nonexistent when this is set to null
+  unsigned slot; // its entry in the queue, or NO_SLOT if it has none
 };
 
+/*
+  Links between heaps and their queue are 32-bit indices in both directions, rather than
+  pointers: each heap position knows its queue slot, and each queue slot knows its owner's
+  tag and the position within that owner.
+ */
 struct ring_buffer {
   unsigned size; // could've called this the capacity
   unsigned n_entries;
-  ring_buffer_elem* head;
-  ring_buffer_elem entries[]; // the alternative would be preprocessor magic with fixed sizes, but I don't think that gives us much benefit for the cost it bears.
+  unsigned head;
+  unsigned n_heaps; // heaps attached so far, which is how their tags are handed out
+  unsigned short* owners; // an `enum queue_owner` or a heap's tag per slot. lives in the same block as `positions`
+  unsigned positions[]; // the alternative would be preprocessor magic with fixed sizes, but I don't think that gives us much benefit for the cost it bears.
+};
+
+struct heap;
+
+struct heap_sifts { // one set per mode, resolved once in `create_heap` so that no sift ever asks which way it points
+  unsigned (*down)(struct heap* heap, unsigned i); // both return where the element came to rest
+  unsigned (*up)(struct heap* heap, unsigned i);
 };
 
 struct heap { // I like this simple naming scheme best.
   enum heap_mode mode;
+  const struct heap_sifts* sifts;
+  unsigned arity; // children per node: 2, 4, or 8. wider nodes keep siblings on one cache line
+  unsigned tag; // marks this heap's entries in the queue
   unsigned size;
   unsigned n_entries; // multiple heaps may share a queue, so we need to maintain our own set of counting statistics
   struct ring_buffer* queue; // sadly, this must be a pointer in order to remain standard C because ring_buffer is also variably sized.
-  struct heap_element elements[]; // keep all data in one contiguous block---one less layer of indirection (funny grammer, since we would otherwise say "fewer layers")
+  unsigned* slots; // the queue slot of each key. lives in the same block, right after `keys`
+  struct operation_counters counters; // sifts and moves, should they be compiled in
+  double keys[]; // keep all data in one contiguous block---one less layer of indirection (funny grammer, since we would otherwise say "fewer layers")
 };
 
 
 // Let's see how rusty my C(++) is. This shall take advantage of the most elegant parts of C17 (i.e. C11.) Feels nice to get back into the groove!
 // Const-correctness is a pain in the ass. Instead, I shall trust myself to properly use my interfaces.
 
-bool belongs_to_this_heap(struct heap* heap, struct heap_element* elem);
-struct heap_element* add_value_to_heap(struct heap* heap, double value);
-struct heap_element* add_element_to_heap(struct heap* heap, struct heap_element new_elem); // this and the below should not remove from the conveyor-belt queue, since adding it back would cause it to lose its original position.
-void remove_front_element_from_heap(struct heap* heap, struct heap_element* destination); // swaps into the destination slot. no longer returns by value to signal transfer of ownership. all these methods exposed gives granular control to the operator
+unsigned enqueue_value_into_heap(struct heap* heap, double value); // claims the queue's current slot for a fresh value. returns where it landed, or NO_SLOT if the heap was full
+void enqueue_loose_element(struct ring_buffer* queue, struct heap_element* elem); // likewise, for an element that lives outside of any heap
+void add_element_to_heap(struct heap* heap, struct heap_element new_elem); // this and the below should not remove from the conveyor-belt queue, since adding it back would cause it to lose its original position.
+void remove_front_element_from_heap(struct heap* heap, struct heap_element* destination); // the removed element comes out loose. all these methods exposed gives granular control to the operator
+void remove_back_element_from_heap(struct heap* heap, struct heap_element* destination); // only sensible for a MIN_MAX_HEAP, whose back is its maximum
 double view_front_of_heap(struct heap* heap);
+double view_back_of_heap(struct heap* heap); // likewise
+double view_runner_up_of_heap(struct heap* heap); // the element that would take the front's place if it were removed
 bool is_ring_buffer_full(struct ring_buffer* queue);
 bool is_ring_buffer_empty(struct ring_buffer* queue);
 void advance_ring_buffer(struct ring_buffer* queue);
-void register_in_queue(struct ring_buffer* queue, struct heap_element* elem); // modifies element to point to a fresh spot on the queue. will expire on its own after some time.
-int expire_stale_entry_in_queue(struct ring_buffer* queue, unsigned n_heaps, ...); // pass pointers to all of the heaps attached to this queue
+int expire_stale_entry_in_queue(struct ring_buffer* queue, unsigned n_heaps, ...); // pass pointers to all of the heaps attached to this queue, in the order they were created
+int expire_stale_entry_in_queue_among(struct ring_buffer* queue, unsigned n_heaps, struct heap** heaps); // same as above, for when the number of heaps is only known at runtime
 struct ring_buffer* create_queue(unsigned size);
-struct heap* create_heap(enum heap_mode mode, unsigned size, struct ring_buffer* queue);
+struct heap* create_heap(enum heap_mode mode, unsigned size, struct ring_buffer* queue); // binary
+struct heap* create_d_ary_heap(enum heap_mode mode, unsigned arity, unsigned size, struct ring_buffer* queue); // NULL unless the arity is 2, 4, or 8. a MIN_MAX_HEAP is always binary
+struct ring_buffer* create_queue_within(struct arena* arena, unsigned size); // see arena.h
+struct heap* create_d_ary_heap_within(struct arena* arena, enum heap_mode mode, unsigned arity, unsigned size, struct ring_buffer* queue);
+size_t measure_queue(unsigned size); // footprints within an arena
+size_t measure_heap(unsigned size);
+bool is_valid_heap_arity(unsigned arity);
 bool verify_heap(struct heap* heap);
+void save_queue(struct ring_buffer* queue, struct state_stream* stream);
+void restore_queue(struct ring_buffer* queue, struct state_stream* stream); // into a queue of the same size
+void save_heap(struct heap* heap, struct state_stream* stream);
+void restore_heap(struct heap* heap, struct state_stream* stream); // likewise, and after its queue
+void clear_queue(struct ring_buffer* queue); // back to empty, as created
+void clear_heap(struct heap* heap);
 void destroy_queue(struct ring_buffer* queue);
 void destroy_heap(struct heap* heap);
 
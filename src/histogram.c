@@ -0,0 +1,159 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "histogram.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <tgmath.h>
+#include <stdbool.h>
+
+bool validate_histogram_domain(double lowest, double highest) {
+  return (lowest == floor(lowest)) && (highest == floor(highest)) // also rules out NaNs and infinities
+    && (lowest <= highest) && ((highest - lowest) < (double)MAX_HISTOGRAM_BINS);
+}
+
+size_t measure_counting_histogram(double lowest, double highest) {
+  unsigned n_bins = (unsigned)(highest - lowest) + 1;
+  return align_to_cache_line(sizeof(struct counting_histogram) + n_bins * sizeof(unsigned))
+    + align_to_cache_line((n_bins / HISTOGRAM_BLOCK_SIZE + 1) * sizeof(unsigned));
+}
+
+struct counting_histogram* create_counting_histogram(double lowest, double highest) {
+  return create_counting_histogram_within(NULL, lowest, highest);
+}
+
+struct counting_histogram* create_counting_histogram_within(struct arena* arena, double lowest, double highest) {
+  unsigned n_bins = (unsigned)(highest - lowest) + 1;
+  size_t counts_size = sizeof(struct counting_histogram) + n_bins * sizeof(unsigned);
+  size_t blocks_size = (n_bins / HISTOGRAM_BLOCK_SIZE + 1) * sizeof(unsigned);
+  struct counting_histogram* histogram = allocate_within(arena, counts_size);
+  memset(histogram, 0, counts_size); // arenas come zeroed, but malloc does not
+  histogram->lowest = (long long)lowest;
+  histogram->n_bins = n_bins;
+  histogram->block_counts = allocate_within(arena, blocks_size);
+  memset(histogram->block_counts, 0, blocks_size);
+  return histogram;
+}
+
+void clear_counting_histogram(struct counting_histogram* histogram) {
+  memset(histogram->counts, 0, histogram->n_bins * sizeof(unsigned));
+  memset(histogram->block_counts, 0, (histogram->n_bins / HISTOGRAM_BLOCK_SIZE + 1) * sizeof(unsigned));
+  histogram->n_entries = 0;
+  histogram->cursor = 0;
+  histogram->below = 0;
+}
+
+void destroy_counting_histogram(struct counting_histogram* histogram) {
+  destroy_counting_histogram_within(NULL, histogram);
+}
+
+void destroy_counting_histogram_within(struct arena* arena, struct counting_histogram* histogram) {
+  release_within(arena, histogram->block_counts);
+  release_within(arena, histogram);
+}
+
+void save_counting_histogram(struct counting_histogram* histogram, struct state_stream* stream) {
+  WRITE_STATE(stream, histogram->n_bins);
+  WRITE_STATE(stream, histogram->n_entries);
+  WRITE_STATE(stream, histogram->cursor);
+  WRITE_STATE(stream, histogram->below);
+  write_state(stream, histogram->counts, histogram->n_bins * sizeof(unsigned));
+  write_state(stream, histogram->block_counts, (histogram->n_bins / HISTOGRAM_BLOCK_SIZE + 1) * sizeof(unsigned));
+}
+
+void restore_counting_histogram(struct counting_histogram* histogram, struct state_stream* stream) {
+  expect_state(stream, histogram->n_bins);
+  READ_STATE(stream, histogram->n_entries);
+  READ_STATE(stream, histogram->cursor);
+  READ_STATE(stream, histogram->below);
+  read_state(stream, histogram->counts, histogram->n_bins * sizeof(unsigned));
+  read_state(stream, histogram->block_counts, (histogram->n_bins / HISTOGRAM_BLOCK_SIZE + 1) * sizeof(unsigned));
+  if (histogram->cursor >= histogram->n_bins)
+    stream->failed = true;
+}
+
+unsigned locate_histogram_bin(struct counting_histogram* histogram, double value) {
+  double offset = round(value) - (double)histogram->lowest;
+  if (offset <= 0.0)
+    return 0;
+  if (offset >= (double)(histogram->n_bins - 1))
+    return histogram->n_bins - 1;
+  return (unsigned)offset;
+}
+
+void add_to_histogram(struct counting_histogram* histogram, unsigned bin) {
+  histogram->counts[bin] += 1;
+  histogram->block_counts[bin / HISTOGRAM_BLOCK_SIZE] += 1;
+  histogram->below += (bin < histogram->cursor);
+  histogram->n_entries += 1;
+}
+
+void remove_from_histogram(struct counting_histogram* histogram, unsigned bin) {
+  histogram->counts[bin] -= 1;
+  histogram->block_counts[bin / HISTOGRAM_BLOCK_SIZE] -= 1;
+  histogram->below -= (bin < histogram->cursor);
+  histogram->n_entries -= 1;
+}
+
+double select_from_histogram(struct counting_histogram* histogram, unsigned rank) {
+  if (rank >= histogram->n_entries)
+    return NAN;
+  unsigned cursor = histogram->cursor;
+  unsigned below = histogram->below;
+  const unsigned* counts = histogram->counts;
+  const unsigned* block_counts = histogram->block_counts;
+  while (below > rank) { // walk down, a whole block at a time when we can
+    unsigned block = cursor / HISTOGRAM_BLOCK_SIZE;
+    if ((cursor % HISTOGRAM_BLOCK_SIZE == 0) && (below - block_counts[block-1] > rank)) {
+      below -= block_counts[block-1];
+      cursor -= HISTOGRAM_BLOCK_SIZE;
+    } else {
+      cursor -= 1;
+      below -= counts[cursor];
+    }
+  }
+  while (below + counts[cursor] <= rank) { // then up, likewise
+    unsigned block = cursor / HISTOGRAM_BLOCK_SIZE;
+    if ((cursor % HISTOGRAM_BLOCK_SIZE == 0) && (below + block_counts[block] <= rank)) {
+      below += block_counts[block];
+      cursor += HISTOGRAM_BLOCK_SIZE;
+    } else {
+      below += counts[cursor];
+      cursor += 1;
+    }
+  }
+  histogram->cursor = cursor;
+  histogram->below = below;
+  return (double)(histogram->lowest + (long long)cursor);
+}
+
+bool verify_histogram(struct counting_histogram* histogram) {
+  unsigned long long total = 0, below = 0;
+  for (unsigned bin = 0; bin < histogram->n_bins; bin += 1) {
+    if (bin == histogram->cursor)
+      below = total;
+    total += histogram->counts[bin];
+  }
+  for (unsigned block = 0; block <= (histogram->n_bins - 1) / HISTOGRAM_BLOCK_SIZE; block += 1) {
+    unsigned long long sum = 0;
+    for (unsigned bin = block * HISTOGRAM_BLOCK_SIZE; (bin < (block+1) * HISTOGRAM_BLOCK_SIZE) && (bin < histogram->n_bins); bin += 1)
+      sum += histogram->counts[bin];
+    if (sum != histogram->block_counts[block])
+      return false;
+  }
+  return (total == histogram->n_entries) && (below == histogram->below);
+}
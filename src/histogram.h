@@ -0,0 +1,62 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdbool.h>
+#include "state.h"
+#include "arena.h"
+
+/*
+  A histogram over a small domain of integers, for rolling quantiles of quantized signals
+  such as raw ADC counts. Adding and removing are a couple of increments, with no per-entry
+  storage at all. A cursor remembers where the last selection landed along with how many
+  entries lie below it, and walks from there to the next one, which is amortized O(1) for
+  signals that drift rather than leap. Coarse counts over blocks of bins let it stride
+  across long empty stretches. Values are rounded to the nearest integer and clamped into
+  the domain, which makes the results exact for integral inputs that lie within it.
+ */
+
+#define MAX_HISTOGRAM_BINS (1u << 24)
+#define HISTOGRAM_BLOCK_SIZE 64 // bins per coarse count
+
+struct counting_histogram {
+  long long lowest;
+  unsigned n_bins;
+  unsigned n_entries;
+  unsigned cursor; // bin of the latest selection
+  unsigned below; // entries in the bins before the cursor
+  unsigned* block_counts;
+  unsigned counts[];
+};
+
+bool validate_histogram_domain(double lowest, double highest);
+struct counting_histogram* create_counting_histogram(double lowest, double highest); // inclusive
+struct counting_histogram* create_counting_histogram_within(struct arena* arena, double lowest, double highest); // see arena.h
+size_t measure_counting_histogram(double lowest, double highest); // its footprint within an arena
+unsigned locate_histogram_bin(struct counting_histogram* histogram, double value);
+void add_to_histogram(struct counting_histogram* histogram, unsigned bin);
+void remove_from_histogram(struct counting_histogram* histogram, unsigned bin);
+double select_from_histogram(struct counting_histogram* histogram, unsigned rank); // zero-based; NaN when out of range
+bool verify_histogram(struct counting_histogram* histogram);
+void save_counting_histogram(struct counting_histogram* histogram, struct state_stream* stream);
+void restore_counting_histogram(struct counting_histogram* histogram, struct state_stream* stream); // into one over the same domain
+void clear_counting_histogram(struct counting_histogram* histogram);
+void destroy_counting_histogram(struct counting_histogram* histogram);
+void destroy_counting_histogram_within(struct arena* arena, struct counting_histogram* histogram);
+
+#endif
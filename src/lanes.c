@@ -0,0 +1,203 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "lanes.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <tgmath.h>
+#include <stdbool.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+struct lane_block {
+  double sorted[2][LANE_MAX_WINDOW + 1][LANE_BLOCK]; // each lane's present entries in ascending order, followed by NaNs. flips between the two every step
+  double entries[LANE_MAX_WINDOW][LANE_BLOCK]; // in order of arrival, the oldest at `head`
+  unsigned head;
+  unsigned flip; // which of the two sorted arrays is current
+  unsigned n_entries[LANE_BLOCK];
+  unsigned clocks[LANE_BLOCK];
+};
+
+bool can_feed_in_lanes(struct filter_pipeline* pipeline) {
+  if ((pipeline->n_filters != 1) || pipeline->branched)
+    return false;
+  struct cascade_filter* filter = pipeline->filters;
+  return (filter->chain == NULL) && (filter->timed == NULL) && (filter->sketch == NULL) && (filter->high_pass_buffer == NULL)
+    && (filter->monitor.engine == SORTED_ENGINE) && (filter->monitor.window <= LANE_MAX_WINDOW);
+}
+
+static void load_lane(struct lane_block* block, unsigned lane, struct cascade_filter* filter) {
+  struct rolling_quantile* monitor = &filter->monitor;
+  struct ranked_window* ranked = &monitor->ranked;
+  unsigned window = monitor->window;
+  for (unsigned k = 0; k < window; k += 1) {
+    unsigned slot = ranked->head + k;
+    block->entries[k][lane] = ranked->entries[(slot < window)? slot : (slot - window)]; // rotated so that the oldest comes first
+    block->sorted[0][k][lane] = (k < ranked->n_entries)? ranked->sorted[k] : NAN;
+  }
+  block->n_entries[lane] = ranked->n_entries;
+  block->clocks[lane] = filter->clock;
+}
+
+static void store_lane(struct lane_block* block, unsigned lane, struct cascade_filter* filter, size_t length) {
+  struct rolling_quantile* monitor = &filter->monitor;
+  struct ranked_window* ranked = &monitor->ranked;
+  unsigned window = monitor->window;
+  for (unsigned k = 0; k < window; k += 1) {
+    unsigned slot = block->head + k;
+    ranked->entries[k] = block->entries[(slot < window)? slot : (slot - window)][lane];
+    ranked->sorted[k] = block->sorted[block->flip][k][lane];
+  }
+  ranked->head = 0;
+  ranked->n_entries = block->n_entries[lane];
+  ranked->tick += (unsigned)length;
+  monitor->count += (unsigned)length;
+  COUNT_OPERATIONS(monitor->counters, updates, length);
+  filter->clock = block->clocks[lane];
+}
+
+/*
+  The same exchange as the sorted array's, one row at a time. Ties go the same way too: the
+  stale entry leaves from the first position that does not compare below it, and the new
+  one goes in front of any it equals. Both positions are counted off of the current array
+  in one pass, and the next array is drawn from it in another, so that every row comes down
+  to a few comparisons and blends. Positions are kept in doubles so that all of it stays in
+  the same kind of vector register. Compilers won't if-convert a choice between doubles
+  that may trap, so the blends are spelled out on SSE2, two lanes to a register, and left
+  to plain selects one lane at a time elsewhere.
+ */
+#ifdef __SSE2__
+static void step_lanes(double (*sorted)[LANE_BLOCK], double (*fresh)[LANE_BLOCK], unsigned window,
+    unsigned lane, const double* stale_entries, const double* next_entries) {
+  __m128d one = _mm_set1_pd(1.0), end = _mm_set1_pd((double)window);
+  __m128d stale = _mm_loadu_pd(stale_entries + lane), next = _mm_loadu_pd(next_entries + lane);
+  __m128d from = _mm_setzero_pd(), to = _mm_setzero_pd();
+  for (unsigned k = 0; k < window; k += 1) { // NaNs count for nothing either way
+    __m128d entry = _mm_loadu_pd(sorted[k] + lane);
+    from = _mm_add_pd(from, _mm_and_pd(_mm_cmplt_pd(entry, stale), one));
+    to = _mm_add_pd(to, _mm_and_pd(_mm_cmplt_pd(entry, next), one));
+  }
+  __m128d stale_present = _mm_cmpord_pd(stale, stale), next_present = _mm_cmpord_pd(next, next);
+  from = _mm_or_pd(_mm_and_pd(stale_present, from), _mm_andnot_pd(stale_present, end)); // where the stale entry leaves from, and where the new one lands once it has
+  to = _mm_sub_pd(to, _mm_and_pd(_mm_cmplt_pd(stale, next), one));
+  to = _mm_or_pd(_mm_and_pd(next_present, to), _mm_andnot_pd(next_present, end));
+  __m128d previous = _mm_setzero_pd(), current = _mm_loadu_pd(sorted[0] + lane);
+  for (unsigned k = 0; k < window; k += 1) { // the row past the last stays NaN for good
+    __m128d rank = _mm_set1_pd((double)k), following = _mm_loadu_pd(sorted[k+1] + lane);
+    __m128d before = _mm_cmplt_pd(rank, from), after = _mm_cmplt_pd(_mm_sub_pd(rank, one), from);
+    __m128d kept = _mm_or_pd(_mm_and_pd(before, current), _mm_andnot_pd(before, following));
+    __m128d shifted = _mm_or_pd(_mm_and_pd(after, previous), _mm_andnot_pd(after, current));
+    __m128d landing = _mm_cmpeq_pd(rank, to), below = _mm_cmplt_pd(rank, to);
+    shifted = _mm_or_pd(_mm_and_pd(landing, next), _mm_andnot_pd(landing, shifted));
+    _mm_storeu_pd(fresh[k] + lane, _mm_or_pd(_mm_and_pd(below, kept), _mm_andnot_pd(below, shifted)));
+    previous = current;
+    current = following;
+  }
+}
+#define LANES_PER_STEP 2
+#else
+static void step_lanes(double (*sorted)[LANE_BLOCK], double (*fresh)[LANE_BLOCK], unsigned window,
+    unsigned lane, const double* stale_entries, const double* next_entries) {
+  double stale = stale_entries[lane], next = next_entries[lane];
+  unsigned from = 0, to = 0;
+  for (unsigned k = 0; k < window; k += 1) {
+    from += (sorted[k][lane] < stale);
+    to += (sorted[k][lane] < next);
+  }
+  from = isnan(stale)? window : from;
+  to = isnan(next)? window : (to - (stale < next));
+  for (unsigned k = 0; k < window; k += 1) {
+    double kept = (k < from)? sorted[k][lane] : sorted[k+1][lane];
+    double shifted = ((k > 0) && (k - 1 < from))? sorted[k-1][lane] : sorted[k][lane];
+    fresh[k][lane] = (k < to)? kept : ((k == to)? next : shifted);
+  }
+}
+#define LANES_PER_STEP 1
+#endif
+
+static void step_lane_block(struct lane_block* block, unsigned window, const double* next) {
+  double stale[LANE_BLOCK];
+  for (unsigned j = 0; j < LANE_BLOCK; j += 1) {
+    stale[j] = block->entries[block->head][j];
+    block->entries[block->head][j] = next[j];
+    block->n_entries[j] += (unsigned)!isnan(next[j]) - (unsigned)!isnan(stale[j]);
+  }
+  block->head = (block->head + 1 == window)? 0 : (block->head + 1);
+  for (unsigned j = 0; j < LANE_BLOCK; j += LANES_PER_STEP)
+    step_lanes(block->sorted[block->flip], block->sorted[!block->flip], window, j, stale, next);
+  block->flip = !block->flip;
+}
+
+static double select_from_lane(struct lane_block* block, unsigned lane, unsigned n_entries,
+    struct rolling_quantile* monitor, const unsigned* ranks) {
+  if (n_entries == 0)
+    return NAN;
+  unsigned rank = ranks[n_entries];
+  double (*sorted)[LANE_BLOCK] = block->sorted[block->flip];
+  double current = sorted[rank][lane];
+  if (isnan(monitor->interpolation.target_quantile))
+    return current;
+  double previous = (rank > 0)? sorted[rank-1][lane] : NAN;
+  double next = (rank + 1 < monitor->window)? sorted[rank+1][lane] : NAN; // NaN past the present entries, too
+  return interpolate_between_neighbors(previous, current, next, monitor->window, monitor->portion, monitor->interpolation);
+}
+
+void feed_channels_in_lanes(struct filter_pipeline** channels, unsigned n_channels,
+    const char* input, const ptrdiff_t input_strides[2], char* output, const ptrdiff_t output_strides[2], size_t length) {
+  struct rolling_quantile* monitor = &channels[0]->filters[0].monitor; // the channels share everything but their state
+  unsigned window = monitor->window;
+  unsigned subsample_rate = channels[0]->filters[0].subsample_rate;
+  unsigned ranks[LANE_MAX_WINDOW + 1]; // by how many entries are present
+  for (unsigned n = 1; n <= window; n += 1)
+    ranks[n] = rank_within_window(monitor->portion, window, n);
+  struct lane_block block;
+  for (unsigned first = 0; first < n_channels; first += LANE_BLOCK) {
+    unsigned n_lanes = (n_channels - first < LANE_BLOCK)? (n_channels - first) : LANE_BLOCK;
+    for (unsigned k = 0; k <= LANE_MAX_WINDOW; k += 1) { // idle lanes stay empty
+      for (unsigned j = 0; j < LANE_BLOCK; j += 1) {
+        block.sorted[0][k][j] = block.sorted[1][k][j] = NAN;
+        if (k < LANE_MAX_WINDOW)
+          block.entries[k][j] = NAN;
+      }
+    }
+    block.head = 0;
+    block.flip = 0;
+    memset(block.n_entries, 0, sizeof(block.n_entries));
+    for (unsigned j = 0; j < n_lanes; j += 1)
+      load_lane(&block, j, channels[first + j]->filters);
+    double next[LANE_BLOCK];
+    for (unsigned j = n_lanes; j < LANE_BLOCK; j += 1)
+      next[j] = NAN;
+    for (size_t t = 0; t < length; t += 1) {
+      for (unsigned j = 0; j < n_lanes; j += 1)
+        next[j] = *(const double*)(input + (first + j)*input_strides[0] + t*input_strides[1]);
+      step_lane_block(&block, window, next);
+      for (unsigned j = 0; j < n_lanes; j += 1) {
+        double* destination = (double*)(output + (first + j)*output_strides[0] + t*output_strides[1]);
+        if ((++block.clocks[j]) < subsample_rate) {
+          *destination = NAN;
+          continue;
+        }
+        block.clocks[j] = 0;
+        *destination = select_from_lane(&block, j, block.n_entries[j], monitor, ranks);
+      }
+    }
+    for (unsigned j = 0; j < n_lanes; j += 1)
+      store_lane(&block, j, channels[first + j]->filters, length);
+  }
+}
@@ -0,0 +1,45 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef LANES_H
+#define LANES_H
+
+#include "filter.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+  Banks of many channels over tiny windows spend most of their time on bookkeeping when
+  each channel goes through its own pipeline: a call per entry, a scan, a `memmove` of a
+  handful of doubles, and a branch or two that mispredict. Instead, `LANE_BLOCK` channels
+  at a time are laid out abreast, one row per rank of their sorted windows, and advance in
+  lockstep. Evicting the stale entry and inserting the new one are then just comparisons
+  and blends down the rows, with no branches, done on SSE2 registers across the lanes
+  where there are any. Missing values sit at the end of each lane as NaNs.
+
+  Each block is loaded from the channels' own sorted-array engines before a batch and
+  stored back right after, so the channels hold the state between batches as usual, and
+  the outputs match theirs bit for bit.
+ */
+#define LANE_BLOCK 8 // channels abreast. a multiple of any vector width that matters
+#define LANE_MAX_WINDOW 16 // beyond which the rows no longer fit in registers and L1, and the sorted array catches up
+
+bool can_feed_in_lanes(struct filter_pipeline* pipeline); // a lone low-pass stage on the sorted array engine, over a short enough window
+void feed_channels_in_lanes(struct filter_pipeline** channels, unsigned n_channels,
+  const char* input, const ptrdiff_t input_strides[2], char* output, const ptrdiff_t output_strides[2], size_t length); // strides in bytes, by channel and then by time
+
+#endif
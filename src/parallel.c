@@ -0,0 +1,152 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "parallel.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE thread_handle;
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+typedef pthread_t thread_handle;
+#endif
+
+struct parallel_share {
+  parallel_task task;
+  void* context;
+  unsigned first;
+  unsigned last;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI run_parallel_share(LPVOID argument) {
+#else
+static void* run_parallel_share(void* argument) {
+#endif
+  struct parallel_share* share = argument;
+  share->task(share->context, share->first, share->last);
+  return 0;
+}
+
+static bool spawn_thread(thread_handle* handle, struct parallel_share* share) {
+#ifdef _WIN32
+  *handle = CreateThread(NULL, 0, run_parallel_share, share, 0, NULL);
+  return *handle != NULL;
+#else
+  return pthread_create(handle, NULL, run_parallel_share, share) == 0;
+#endif
+}
+
+static void join_thread(thread_handle handle) {
+#ifdef _WIN32
+  WaitForSingleObject(handle, INFINITE);
+  CloseHandle(handle);
+#else
+  pthread_join(handle, NULL);
+#endif
+}
+
+unsigned count_available_cores(void) {
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (unsigned)info.dwNumberOfProcessors;
+#else
+  long n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n_cores > 0)? (unsigned)n_cores : 1;
+#endif
+}
+
+void run_in_parallel(unsigned n_items, unsigned n_threads, parallel_task task, void* context) {
+  if (n_threads > n_items)
+    n_threads = n_items;
+  if (n_threads <= 1) {
+    if (n_items > 0)
+      task(context, 0, n_items);
+    return;
+  }
+  struct parallel_share* shares = malloc(n_threads * sizeof(struct parallel_share));
+  thread_handle* handles = malloc(n_threads * sizeof(thread_handle));
+  bool* spawned = calloc(n_threads, sizeof(bool));
+  for (unsigned t = 0; t < n_threads; t += 1) {
+    shares[t] = (struct parallel_share) {
+      .task = task,
+      .context = context,
+      .first = (unsigned)(((unsigned long long)n_items * t) / n_threads),
+      .last = (unsigned)(((unsigned long long)n_items * (t+1)) / n_threads) };
+  }
+  for (unsigned t = 1; t < n_threads; t += 1) {
+    spawned[t] = spawn_thread(handles + t, shares + t);
+  }
+  run_parallel_share(shares);
+  for (unsigned t = 1; t < n_threads; t += 1) {
+    if (spawned[t])
+      join_thread(handles[t]);
+    else
+      run_parallel_share(shares + t); // fall back on doing it ourselves
+  }
+  free(spawned);
+  free(handles);
+  free(shares);
+}
+
+struct native_thread {
+  thread_handle handle;
+  struct parallel_share share;
+};
+
+struct native_thread* start_native_thread(parallel_task task, void* context) {
+  struct native_thread* thread = malloc(sizeof(struct native_thread));
+  if (thread == NULL)
+    return NULL;
+  thread->share = (struct parallel_share) { .task = task, .context = context, .first = 0, .last = 1 };
+  if (!spawn_thread(&thread->handle, &thread->share)) {
+    free(thread);
+    return NULL;
+  }
+  return thread;
+}
+
+void join_native_thread(struct native_thread* thread) {
+  join_thread(thread->handle);
+  free(thread);
+}
+
+#define MAX_IDLE_NAP 200 // microseconds. the most latency an idle poller adds when work turns up again
+
+void idle_thread(unsigned n_idle_rounds) {
+  if (n_idle_rounds < 64) { // give the core up, but come right back if nobody else wants it
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+    return;
+  }
+  unsigned nap = (n_idle_rounds - 64 < MAX_IDLE_NAP)? (n_idle_rounds - 64 + 1) : MAX_IDLE_NAP; // in microseconds
+#ifdef _WIN32
+  Sleep((nap + 999) / 1000); // millisecond granularity, at best
+#else
+  struct timespec duration = { .tv_sec = 0, .tv_nsec = 1000L * nap };
+  nanosleep(&duration, NULL);
+#endif
+}
@@ -0,0 +1,40 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/*
+  Bare-bones fork-join parallelism over native threads (POSIX or Win32.)
+  The items are split into contiguous shares, one per thread, and the calling
+  thread takes the first share itself. Nothing in here touches Python.
+ */
+
+typedef void (*parallel_task)(void* context, unsigned first, unsigned last); // processes items in [first, last)
+
+unsigned count_available_cores(void);
+void run_in_parallel(unsigned n_items, unsigned n_threads, parallel_task task, void* context);
+
+/*
+  A lone long-lived thread, for background work that outlasts any one call.
+  It runs the task once over the single item [0, 1).
+ */
+struct native_thread;
+struct native_thread* start_native_thread(parallel_task task, void* context); // NULL if it could not be spawned
+void join_native_thread(struct native_thread* thread); // and free it
+void idle_thread(unsigned n_idle_rounds); // for polling loops: yields at first, then naps for a little longer the longer it has been idle
+
+#endif
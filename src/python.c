@@ -22,8 +22,18 @@
 #include "numpy/ufuncobject.h"
 
 #include "filter.h"
+#include "lanes.h"
+#include "parallel.h"
+#include "stream.h"
 
 #include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#ifndef _WIN32
+#include <fcntl.h> // for readahead hints
+#include <sys/stat.h>
+#endif
 
 // Bypass the need for highly scalable storage of overwhelming data streams!
 // Highly verbose, "bare metal" Python bindings.
@@ -37,6 +47,19 @@ struct description {
   double quantile;
   double alpha;
   double beta;
+  PyObject* quantiles; // a tuple of floats, or NULL when a single quantile is desired
+  unsigned engine; // an `enum quantile_engine`
+  unsigned arity;
+  double duration; // zero unless the window spans time
+  double error; // zero unless approximate
+  double lowest, highest; // the declared `value_range` for the counting engine
+  bool tap; // whether a branched pipeline reports this stage
+  double threshold; // the `k` of a Hampel filter
+  bool scores; // whether a Hampel filter reports robust z-scores rather than the cleaned signal
+};
+
+static const char* engine_names[] = { // in the order of `enum quantile_engine`
+  "auto", "heap", "tree", "sorted", "counting", NULL
 };
 
 static PyMemberDef description_members[] = { // base class of HighPass and LowPass
@@ -58,48 +81,204 @@ static PyMemberDef description_members[] = { // base class of HighPass and LowPa
   }, {
     "beta", T_DOUBLE, offsetof(struct description, beta), 0,
     "interpolation parameter, 0 <= beta <= 1"
+  }, {
+    "arity", T_UINT, offsetof(struct description, arity), 0,
+    "children per heap node, 2, 4, or 8; wider nodes can pay off for long windows over trending signals"
+  }, {
+    "duration", T_DOUBLE, offsetof(struct description, duration), 0,
+    "span of time that the window covers in place of `window` samples, in the units of the timestamps; zero otherwise"
+  }, {
+    "error", T_DOUBLE, offsetof(struct description, error), 0,
+    "bound on the rank error of an approximate filter, as a fraction of the window; zero for exact ones"
+  }, {
+    "quantiles", T_OBJECT, offsetof(struct description, quantiles), READONLY,
+    "several target quantiles over one shared window, reported side by side; only for stages that feed no other"
+  }, {
+    "tap", T_BOOL, offsetof(struct description, tap), 0,
+    "whether the pipeline reports this stage's output, alongside those of any other taps; "
+    "when no stage is a tap, the ones that feed no other are"
+  }, {NULL}
+};
+
+static PyObject* description_get_engine(struct description* self, void* closure) {
+  return PyUnicode_FromString(engine_names[self->engine]);
+}
+
+static PyObject* description_get_value_range(struct description* self, void* closure) {
+  if (self->engine != COUNTING_ENGINE)
+    Py_RETURN_NONE;
+  return Py_BuildValue("(LL)", (long long)self->lowest, (long long)self->highest);
+}
+
+static PyGetSetDef description_getset[] = {
+  {
+    "engine", (getter)description_get_engine, NULL,
+    "structure that orders the window: 'heap', 'sorted' for short ones, 'tree' for long windows over trending signals, "
+    "'counting' for integers within a `value_range`, or 'auto' to decide by window size",
+    NULL
+  }, {
+    "value_range", (getter)description_get_value_range, NULL,
+    "inclusive (lowest, highest) integers that the counting engine tallies, or None",
+    NULL
   }, {NULL}
 };
 
+static PyTypeObject approx_high_pass_type; // defined further below
+static PyTypeObject approx_low_pass_type;
+static PyTypeObject hampel_type;
+
+#define DEFAULT_APPROXIMATION_ERROR 0.001
+
+// returns a new reference to a tuple of floats
+static PyObject* collect_quantiles(PyObject* sequence) {
+  PyObject* items = PySequence_Tuple(sequence);
+  if (items == NULL)
+    return NULL;
+  Py_ssize_t n_items = PyTuple_GET_SIZE(items);
+  PyObject* quantiles = PyTuple_New(n_items);
+  if (quantiles == NULL) {
+    Py_DECREF(items);
+    return NULL;
+  }
+  for (Py_ssize_t i = 0; i < n_items; i += 1) {
+    double quantile = PyFloat_AsDouble(PyTuple_GET_ITEM(items, i));
+    if ((quantile == -1.0) && PyErr_Occurred()) {
+      Py_DECREF(items);
+      Py_DECREF(quantiles);
+      return NULL;
+    }
+    PyTuple_SET_ITEM(quantiles, i, PyFloat_FromDouble(quantile)); // steals the reference
+  }
+  Py_DECREF(items);
+  return quantiles;
+}
+
 static int description_init(struct description* self, PyObject* args, PyObject* kwds) {
   static char* keyword_list[] = {
-    "window", "portion", "subsample_rate", "quantile", "alpha", "beta", NULL};
+    "window", "portion", "subsample_rate", "quantile", "alpha", "beta", "quantiles", "engine", "arity", "duration", "error", "value_range", "tap", NULL};
   unsigned window = 0;
   unsigned portion = 0;
   unsigned subsample_rate = 1;
   double quantile = NAN;
   double alpha = 1.0;
   double beta = 1.0;
+  PyObject* quantiles = Py_None;
+  const char* engine_name = "auto";
+  unsigned arity = 2;
+  double duration = 0.0;
+  double error = NAN;
+  PyObject* value_range = Py_None;
+  int tap = 0;
   // specify optional '|' and then keyword-only '$' arguments
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|$IIIddd", keyword_list,
-      &window, &portion, &subsample_rate, &quantile, &alpha, &beta)) {
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|$IIIdddOsIddOp", keyword_list,
+      &window, &portion, &subsample_rate, &quantile, &alpha, &beta, &quantiles, &engine_name, &arity, &duration, &error, &value_range, &tap)) {
     PyErr_SetString(PyExc_TypeError,
       "invalid arguments passed to Description (either LowPass or HighPass) constructor");
     return -1;
   }
-  if (window == 0) {
+  if (!(duration >= 0.0) || isinf(duration)) {
+    PyErr_SetString(PyExc_ValueError, "please set a finite, positive duration");
+    return -1;
+  }
+  if ((duration > 0.0) && ((window != 0) || isnan(quantile) || (quantiles != Py_None))) {
+    PyErr_SetString(PyExc_ValueError, "a `duration` takes the place of `window`, and needs a single target `quantile`");
+    return -1;
+  }
+  bool approximate = PyObject_TypeCheck((PyObject*)self, &approx_low_pass_type)
+    || PyObject_TypeCheck((PyObject*)self, &approx_high_pass_type);
+  if (!approximate && !isnan(error)) {
+    PyErr_SetString(PyExc_ValueError, "only ApproxLowPass and ApproxHighPass take an `error`");
+    return -1;
+  }
+  if (approximate) {
+    if (isnan(error))
+      error = DEFAULT_APPROXIMATION_ERROR;
+    if (!((error > 0.0) && (error < 1.0))) {
+      PyErr_SetString(PyExc_ValueError, "the `error` must lie strictly between zero and one");
+      return -1;
+    }
+    if (isnan(quantile) || (quantiles != Py_None) || (duration > 0.0)) {
+      PyErr_SetString(PyExc_ValueError, "approximate filters need a `window` and a single target `quantile`");
+      return -1;
+    }
+  } else {
+    error = 0.0;
+  }
+  if ((window == 0) && (duration == 0.0)) {
     PyErr_SetString(PyExc_ValueError, "please set a positive window size");
     return -1;
   }
+  unsigned engine = 0;
+  while ((engine_names[engine] != NULL) && (strcmp(engine_names[engine], engine_name) != 0))
+    engine += 1;
+  if (engine_names[engine] == NULL) {
+    PyErr_SetString(PyExc_ValueError, "`engine` must be one of 'auto', 'heap', 'tree', 'sorted', or 'counting'");
+    return -1;
+  }
+  double lowest = 0.0, highest = 0.0;
+  if (value_range != Py_None) {
+    if (!PyArg_ParseTuple(value_range, "dd", &lowest, &highest)) {
+      PyErr_SetString(PyExc_TypeError, "`value_range` must be a pair of integers, (lowest, highest)");
+      return -1;
+    }
+    if (!validate_histogram_domain(lowest, highest)) {
+      PyErr_SetString(PyExc_ValueError, "`value_range` must hold two integers, lowest first, no more than 2**24 apart");
+      return -1;
+    }
+    if ((engine != AUTOMATIC_ENGINE) && (engine != COUNTING_ENGINE)) {
+      PyErr_SetString(PyExc_ValueError, "a `value_range` calls for the counting engine");
+      return -1;
+    }
+    engine = COUNTING_ENGINE;
+  } else if (engine == COUNTING_ENGINE) {
+    PyErr_SetString(PyExc_ValueError, "the counting engine needs a `value_range`");
+    return -1;
+  }
+  Py_CLEAR(self->quantiles);
+  if (quantiles != Py_None) {
+    self->quantiles = collect_quantiles(quantiles);
+    if (self->quantiles == NULL) {
+      PyErr_SetString(PyExc_TypeError, "`quantiles` must be a sequence of numbers");
+      return -1;
+    }
+    if (PyTuple_GET_SIZE(self->quantiles) == 0) {
+      PyErr_SetString(PyExc_ValueError, "please pass at least one of the `quantiles`");
+      return -1;
+    }
+  }
   self->window = window;
   self->portion = portion;
   self->subsample_rate = subsample_rate;
   self->quantile = quantile;
   self->alpha = alpha;
+  self->engine = engine;
+  self->arity = arity;
+  self->duration = duration;
+  self->error = error;
+  self->lowest = lowest;
+  self->highest = highest;
+  self->tap = (tap != 0);
   self->beta = beta; // my current setup is a little redundant; for instance, I could pass &self->beta directly
   return 0;
 }
 
+static void description_dealloc(struct description* self) {
+  Py_XDECREF(self->quantiles);
+  Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
 static PyTypeObject description_type = {
   PyVarObject_HEAD_INIT(NULL, 0) // funky macro
-  .tp_name = "triton.Description",
+  .tp_name = "rolling_quantiles.triton.Description",
   .tp_doc = "Base filter description. Do not use this directly; it enables subclasses that act like algebraic data types.",
   .tp_basicsize = sizeof(struct description),
   .tp_itemsize = 0, // for variably sized objects
   .tp_flags = Py_TPFLAGS_DEFAULT,
   .tp_new = PyType_GenericNew,
   .tp_members = description_members,
+  .tp_getset = description_getset,
   .tp_init = (initproc)description_init,
+  .tp_dealloc = (destructor)description_dealloc, // inherited by the subclasses
 };
 
 bool init_description(PyObject* self) {
@@ -121,7 +300,7 @@ struct high_pass {
 
 static PyTypeObject high_pass_type = {
   PyVarObject_HEAD_INIT(NULL, 0) // funky macro
-  .tp_name = "triton.HighPass",
+  .tp_name = "rolling_quantiles.triton.HighPass",
   .tp_doc = "High-pass filter description.",
   .tp_basicsize = sizeof(struct high_pass),
   .tp_itemsize = 0, // for variably sized objects
@@ -148,7 +327,7 @@ struct low_pass {
 
 static PyTypeObject low_pass_type = {
   PyVarObject_HEAD_INIT(NULL, 0) // funky macro
-  .tp_name = "triton.LowPass",
+  .tp_name = "rolling_quantiles.triton.LowPass",
   .tp_doc = "Low-pass filter description.",
   .tp_basicsize = sizeof(struct description),
   .tp_itemsize = 0, // for variably sized objects
@@ -169,28 +348,184 @@ bool init_low_pass(PyObject* self) {
   return true;
 }
 
+/*
+  Approximate filters in bounded memory subclass the exact ones, and merely switch on the
+  `error` that every description carries. See `struct sliding_sketch`.
+ */
+static PyTypeObject approx_high_pass_type = {
+  PyVarObject_HEAD_INIT(NULL, 0) // funky macro
+  .tp_name = "rolling_quantiles.triton.ApproxHighPass",
+  .tp_doc = "Approximate high-pass filter description, which subtracts from the latest entry rather than the middle of the window.",
+  .tp_basicsize = sizeof(struct high_pass),
+  .tp_itemsize = 0, // for variably sized objects
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_new = PyType_GenericNew,
+};
+
+bool init_approx_high_pass(PyObject* self) {
+  approx_high_pass_type.tp_base = &high_pass_type; // must be set at runtime, not statically
+  if (PyType_Ready(&approx_high_pass_type) < 0)
+    return false;
+  Py_INCREF(&approx_high_pass_type);
+  if (PyModule_AddObject(self, "ApproxHighPass", (PyObject*) &approx_high_pass_type) < 0) {
+    Py_DECREF(&approx_high_pass_type);
+    return false;
+  }
+  return true;
+}
+
+static PyTypeObject approx_low_pass_type = {
+  PyVarObject_HEAD_INIT(NULL, 0) // funky macro
+  .tp_name = "rolling_quantiles.triton.ApproxLowPass",
+  .tp_doc = "Approximate low-pass filter description.",
+  .tp_basicsize = sizeof(struct low_pass),
+  .tp_itemsize = 0, // for variably sized objects
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_new = PyType_GenericNew,
+};
+
+bool init_approx_low_pass(PyObject* self) {
+  approx_low_pass_type.tp_base = &low_pass_type; // must be set at runtime, not statically
+  if (PyType_Ready(&approx_low_pass_type) < 0)
+    return false;
+  Py_INCREF(&approx_low_pass_type);
+  if (PyModule_AddObject(self, "ApproxLowPass", (PyObject*) &approx_low_pass_type) < 0) {
+    Py_DECREF(&approx_low_pass_type);
+    return false;
+  }
+  return true;
+}
+
+/*
+  A Hampel filter despikes with a median and the median absolute deviation about it, both out
+  of one window. It is a description of its own, since it takes so few of the options.
+ */
+#define DEFAULT_HAMPEL_THRESHOLD 3.0
+
+static PyMemberDef hampel_members[] = {
+  {
+    "k", T_DOUBLE, offsetof(struct description, threshold), READONLY,
+    "how many scaled median absolute deviations off the median make an outlier"
+  }, {
+    "scores", T_BOOL, offsetof(struct description, scores), READONLY,
+    "whether the filter reports robust z-scores rather than the cleaned signal"
+  }, {NULL}
+};
+
+static int hampel_init(struct description* self, PyObject* args, PyObject* kwds) {
+  static char* keyword_list[] = {"window", "k", "scores", "subsample_rate", "engine", "tap", NULL};
+  unsigned window = 0;
+  double threshold = DEFAULT_HAMPEL_THRESHOLD;
+  int scores = 0;
+  unsigned subsample_rate = 1;
+  const char* engine_name = "auto";
+  int tap = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "I|d$pIsp", keyword_list,
+      &window, &threshold, &scores, &subsample_rate, &engine_name, &tap))
+    return -1;
+  if ((window % 2) == 0) {
+    PyErr_SetString(PyExc_ValueError, "please pass an odd window, so that it centers on an entry");
+    return -1;
+  }
+  if (!(threshold >= 0.0)) {
+    PyErr_SetString(PyExc_ValueError, "`k` must be a nonnegative number");
+    return -1;
+  }
+  unsigned engine = 0;
+  while ((engine_names[engine] != NULL) && (strcmp(engine_names[engine], engine_name) != 0))
+    engine += 1;
+  if ((engine != AUTOMATIC_ENGINE) && (engine != SORTED_ENGINE) && (engine != TREE_ENGINE)) {
+    PyErr_SetString(PyExc_ValueError, "a Hampel filter selects by rank, so its `engine` must be one of 'auto', 'sorted', or 'tree'");
+    return -1;
+  }
+  Py_CLEAR(self->quantiles);
+  self->window = window;
+  self->portion = window / 2;
+  self->subsample_rate = subsample_rate;
+  self->quantile = NAN;
+  self->alpha = self->beta = 1.0;
+  self->engine = engine;
+  self->arity = 2;
+  self->duration = self->error = 0.0;
+  self->lowest = self->highest = 0.0;
+  self->tap = (tap != 0);
+  self->threshold = threshold;
+  self->scores = (scores != 0);
+  return 0;
+}
+
+static PyTypeObject hampel_type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "rolling_quantiles.triton.Hampel",
+  .tp_doc = "Hampel filter description: the middle of each window, replaced by the median when it lies more than `k` "
+    "scaled median absolute deviations off, or else how many it lies off when `scores=True`.",
+  .tp_basicsize = sizeof(struct description),
+  .tp_itemsize = 0,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_new = PyType_GenericNew,
+  .tp_members = hampel_members,
+  .tp_init = (initproc)hampel_init,
+};
+
+bool init_hampel(PyObject* self) {
+  hampel_type.tp_base = &description_type; // must be set at runtime, not statically
+  if (PyType_Ready(&hampel_type) < 0)
+    return false;
+  Py_INCREF(&hampel_type);
+  if (PyModule_AddObject(self, "Hampel", (PyObject*) &hampel_type) < 0) {
+    Py_DECREF(&hampel_type);
+    return false;
+  }
+  return true;
+}
+
 /*
   I have decided against providing a `ufunc` method to the Pipeline object for feeding,
   not only because that would be a pain in the wrong place, but also because the semantics
   are mismatched. I do not want to vectorize over arbitrary dimensions. I shall take in either
-  a single value, a generator of values, or a unidimensional array of values. No more, no less.
+  a single value, an iterable of values, or a unidimensional array (or buffer) of values. No more, no less.
  */
 
 struct pipeline {
   PyObject_HEAD
-  struct filter_pipeline* filters;
+  struct filter_pipeline* filters; // the first (or only) channel
+  struct filter_pipeline** channels; // independent states, one per channel
+  unsigned n_channels; // zero unless constructed as a bank of channels
+  unsigned n_threads; // over which a bank's channels are spread
+  bool busy; // set while a thread is feeding it
+  bool fed; // whether anything has gone through it yet, after which its engines are settled
+  bool counting; // whether they were settled on counting the integers it was first fed, which every later feed must then keep to
+  double lowest, highest; // their domain
+  unsigned n_quantiles; // nonzero when the final stage reports several quantiles
+  unsigned n_columns; // nonzero when each entry yields several outputs, which then occupy a trailing axis: the quantiles above, or the taps of a branched pipeline
   unsigned stride;
   double lag; // in agnostic time units, increments of one half (since we bisect the window)
+  bool timed; // whether any stage spans time, so that feeding takes timestamps
 };
 
 static PyMemberDef pipeline_members[] = { // base class of HighPass and LowPass
   {
+    "channels", T_UINT, offsetof(struct pipeline, n_channels), READONLY,
+    "number of independent channels in a bank, or zero for a lone pipeline"
+  }, {
+    "threads", T_UINT, offsetof(struct pipeline, n_threads), READONLY,
+    "number of native threads over which a bank's channels are spread"
+  }, {
     "stride", T_UINT, offsetof(struct pipeline, stride), READONLY,
     "the total stride between subsamples: unit if no subsampling occurs"
+  }, {
+    "n_quantiles", T_UINT, offsetof(struct pipeline, n_quantiles), READONLY,
+    "how many quantiles are reported side by side, or zero for a lone quantile"
+  }, {
+    "n_columns", T_UINT, offsetof(struct pipeline, n_columns), READONLY,
+    "how many outputs each entry yields along a trailing axis, from several quantiles or several taps, or zero for a lone output"
   }, {
     "lag", T_DOUBLE, offsetof(struct pipeline, lag), READONLY,
-    "the effective lag time between the pipeline's output and its input, for a balanced filter"
+    "the effective lag time between the pipeline's (last stage's) output and its input, for a balanced filter"
     // the moment it's received. balanced -> zero-phase or something like that?
+  }, {
+    "timed", T_BOOL, offsetof(struct pipeline, timed), READONLY,
+    "whether any stage's window spans time, in which case `feed` takes timestamps alongside the values"
   }, {NULL}
 };
 
@@ -199,9 +534,155 @@ static PyObject* pipeline_new(PyTypeObject* type, PyObject* args, PyObject* kwds
   if (self == NULL)
     return NULL;
   self->filters = NULL;
+  self->channels = NULL;
+  self->n_channels = 0;
+  self->busy = false;
+  self->fed = false;
+  self->counting = false;
   return (PyObject*)self;
 }
 
+static void release_descriptions(struct cascade_description* descriptions, Py_ssize_t n_filters) {
+  for (Py_ssize_t i = 0; i < n_filters; i += 1)
+    free(descriptions[i].quantiles);
+  free(descriptions);
+}
+
+// parse the keyword-only options by borrowing the machinery for ordinary functions
+static bool parse_pipeline_options(PyObject* kwds, unsigned* n_channels, unsigned* n_threads) {
+  static char* keyword_list[] = {"channels", "threads", NULL};
+  PyObject* no_args = PyTuple_New(0);
+  if (no_args == NULL)
+    return false;
+  bool parsed = PyArg_ParseTupleAndKeywords(no_args, kwds, "|$II", keyword_list, n_channels, n_threads);
+  Py_DECREF(no_args);
+  return parsed;
+}
+
+static double measure_path_lag(struct filter_pipeline* filters, int stage, unsigned* stride) { // from the raw input down to `stage`
+  if (stage < 0) {
+    *stride = 1;
+    return 0.0;
+  }
+  struct cascade_description* description = filters->descriptions + stage;
+  double lag = measure_path_lag(filters, locate_stage_source(filters, (unsigned)stage), stride);
+  if (description->duration > 0.0)
+    lag = NAN; // irregular samples make for no lag in time units that we can count
+  else
+    lag += 0.5 * (double)(description->window * (*stride)); // buildup/cascade/waterfall of lags
+  *stride *= description->subsample_rate;
+  return lag;
+}
+
+// the attributes that follow from the descriptions alone, whether they came from the constructor or a snapshot
+static void summarize_pipeline(struct pipeline* self) {
+  struct filter_pipeline* filters = self->filters;
+  unsigned stride;
+  self->lag = measure_path_lag(filters, (int)filters->n_filters - 1, &stride); // of the last stage, in a branched pipeline
+  self->stride = stride;
+  self->n_quantiles = (filters->n_filters > 0)? filters->descriptions[filters->n_filters-1].n_quantiles : 0;
+  bool several = (filters->width > 1);
+  for (unsigned i = 0; i < filters->n_filters; i += 1)
+    several |= (filters->descriptions[i].n_quantiles > 0); // even just the one
+  self->n_columns = several? filters->width : 0;
+  self->timed = filters->timed;
+}
+
+static bool describe_stage(PyObject* item, struct cascade_description* description) {
+  if (item == NULL) {
+    PyErr_SetString(PyExc_TypeError, "encountered a null description");
+    return false;
+  }
+  struct description* desc_item = (struct description*)item;
+  if (PyObject_TypeCheck(item, &description_type)) { // can I just access it straight?
+    description->window = desc_item->window;
+    description->portion = desc_item->portion;
+    description->subsample_rate = desc_item->subsample_rate;
+    description->engine = (enum quantile_engine)desc_item->engine;
+    description->arity = desc_item->arity;
+    description->duration = desc_item->duration;
+    description->error = desc_item->error;
+    description->lowest = desc_item->lowest;
+    description->highest = desc_item->highest;
+    description->tap = desc_item->tap;
+    description->interpolation = (struct interpolation) {
+      .target_quantile = desc_item->quantile,
+      .alpha = desc_item->alpha,
+      .beta = desc_item->beta };
+    if (desc_item->quantiles != NULL) {
+      Py_ssize_t n_quantiles = PyTuple_GET_SIZE(desc_item->quantiles);
+      description->n_quantiles = (unsigned)n_quantiles;
+      description->quantiles = malloc(n_quantiles * sizeof(double));
+      for (Py_ssize_t j = 0; j < n_quantiles; j += 1)
+        description->quantiles[j] = PyFloat_AS_DOUBLE(PyTuple_GET_ITEM(desc_item->quantiles, j));
+    }
+  }
+  //switch (item->ob_type) {
+  //  case &high_pass_type: {
+  if (PyObject_TypeCheck(item, &hampel_type)) {
+    description->mode = desc_item->scores? HAMPEL_SCORE : HAMPEL;
+    description->threshold = desc_item->threshold;
+  } else if (PyObject_TypeCheck(item, &high_pass_type)) { // allows for subtypes as well, as opposed to item->ob_type equality checks
+    description->mode = HIGH_PASS;
+  } else if (PyObject_TypeCheck(item, &low_pass_type)) {
+    description->mode = LOW_PASS;
+  } else {
+    PyErr_SetString(PyExc_TypeError, "one of the descriptions is neither a HighPass, a LowPass, nor a Hampel");
+    return false;
+  }
+  return true;
+}
+
+/*
+  Branches are lists (or tuples) of stages among the descriptions, which feed off of whatever
+  stage comes right before them without holding up the ones that follow, and may nest.
+    Pipeline(LowPass(...), [HighPass(...), LowPass(...)], LowPass(...))
+  has both the branch's HighPass and the final LowPass feeding off of the first LowPass.
+  They are flattened in order, each with the `skip` that leads back to its source.
+ */
+static Py_ssize_t count_pipeline_stages(PyObject* stages) {
+  Py_ssize_t n_stages = 0;
+  for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(stages); i += 1) {
+    PyObject* item = PySequence_Fast_GET_ITEM(stages, i);
+    Py_ssize_t n_items = (PyList_Check(item) || PyTuple_Check(item))? count_pipeline_stages(item) : 1;
+    if (n_items < 0)
+      return -1;
+    n_stages += n_items;
+  }
+  return n_stages;
+}
+
+static bool describe_pipeline_stages(PyObject* stages, struct cascade_description* descriptions, Py_ssize_t* n_described, Py_ssize_t source) {
+  for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(stages); i += 1) {
+    PyObject* item = PySequence_Fast_GET_ITEM(stages, i);
+    if (PyList_Check(item) || PyTuple_Check(item)) {
+      if (!describe_pipeline_stages(item, descriptions, n_described, source)) // a branch off of where we stand
+        return false;
+      continue;
+    }
+    struct cascade_description* description = descriptions + *n_described;
+    if (!describe_stage(item, description))
+      return false;
+    description->skip = (unsigned)(*n_described - 1 - source);
+    source = *n_described;
+    *n_described += 1;
+  }
+  return true;
+}
+
+static void release_pipeline_state(struct pipeline* self) {
+  if (self->channels != NULL) {
+    unsigned n_states = (self->n_channels > 0)? self->n_channels : 1;
+    for (unsigned c = 0; c < n_states; c += 1)
+      destroy_filter_pipeline(self->channels[c]);
+    free(self->channels);
+  } else if (self->filters != NULL) {
+    destroy_filter_pipeline(self->filters);
+  }
+  self->channels = NULL;
+  self->filters = NULL;
+}
+
 /*
   Construct with keyword arguments.
   Do I need to call INCREF or DECREF on the arguments here? I'm following the philosophy that they should flow right through me.
@@ -209,53 +690,48 @@ static PyObject* pipeline_new(PyTypeObject* type, PyObject* args, PyObject* kwds
 static int pipeline_init(struct pipeline* self, PyObject* args, PyObject* kwds) {
   if (!PyTuple_Check(args))
     return -1;
-  Py_ssize_t n_filters = PyTuple_Size(args);
-  struct cascade_description* descriptions = malloc(n_filters * sizeof(struct cascade_description));
-  unsigned stride = 1;
-  double lag = 0.0;
+  unsigned n_channels = 0;
+  unsigned n_threads = 0;
+  if (!parse_pipeline_options(kwds, &n_channels, &n_threads))
+    return -1;
+  Py_ssize_t n_filters = count_pipeline_stages(args);
+  if (n_filters < 0)
+    return -1;
+  struct cascade_description* descriptions = calloc(n_filters, sizeof(struct cascade_description));
   // double cascading_rate = 1.0; do the whole real-units shebang with a higher-level description structure
-  for (Py_ssize_t i = 0; i < n_filters; i += 1) {
-    PyObject* item = PyTuple_GetItem(args, i);
-    if (item == NULL) {
-      PyErr_SetString(PyExc_TypeError, "encountered a null description");
-      return -1;
-    }
-    struct description* desc_item = (struct description*)item;
-    if (PyObject_TypeCheck(item, &description_type)) { // can I just access it straight?
-      descriptions[i].window = desc_item->window;
-      descriptions[i].portion = desc_item->portion;
-      descriptions[i].subsample_rate = desc_item->subsample_rate;
-      descriptions[i].interpolation = (struct interpolation) {
-        .target_quantile = desc_item->quantile,
-        .alpha = desc_item->alpha,
-        .beta = desc_item->beta };
-      lag += 0.5 * (double)(desc_item->window * stride); // buildup/cascade/waterfall of lags
-      stride *= desc_item->subsample_rate;
-    }
-    //switch (item->ob_type) {
-    //  case &high_pass_type: {
-    if (PyObject_TypeCheck(item, &high_pass_type)) { // allows for subtypes as well, as opposed to item->ob_type equality checks
-      descriptions[i].mode = HIGH_PASS;
-    } else if (PyObject_TypeCheck(item, &low_pass_type)) {
-      descriptions[i].mode = LOW_PASS;
-    } else {
-      PyErr_SetString(PyExc_TypeError, "one of the descriptions is neither a HighPass nor a LowPass");
-      return -1;
-    }
+  Py_ssize_t n_described = 0;
+  if (!describe_pipeline_stages(args, descriptions, &n_described, -1)) {
+    release_descriptions(descriptions, n_filters);
+    return -1;
   }
-  self->filters = create_filter_pipeline((unsigned)n_filters, descriptions);
-  if (self->filters == NULL) {
+  unsigned n_states = (n_channels > 0)? n_channels : 1;
+  self->channels = malloc(n_states * sizeof(struct filter_pipeline*));
+  if (!create_filter_pipelines(n_states, (unsigned)n_filters, descriptions, self->channels)) { // the whole bank in one pool
+    free(self->channels);
+    self->channels = NULL;
+    release_descriptions(descriptions, n_filters);
     PyErr_SetString(PyExc_ValueError, "invalid descriptions passed to pipeline constructor");
     return -1;
   }
-  self->stride = stride;
-  self->lag = lag;
+  self->filters = self->channels[0];
+  self->n_channels = n_channels;
+  if (self->filters->timed && (n_channels > 0)) {
+    release_pipeline_state(self);
+    release_descriptions(descriptions, n_filters);
+    PyErr_SetString(PyExc_ValueError, "banks of channels cannot span time yet");
+    return -1;
+  }
+  self->n_threads = (n_threads > 0)? n_threads : count_available_cores();
+  if (self->n_threads > n_states)
+    self->n_threads = n_states;
+  release_descriptions(descriptions, n_filters);
+  summarize_pipeline(self);
   return 0;
 }
 
 // there is also .tp_finalize that is better suited to deconstructors that perform complex interactions with Python objects
 static void pipeline_dealloc(struct pipeline* self) {
-  destroy_filter_pipeline(self->filters);
+  release_pipeline_state(self);
   Py_TYPE(self)->tp_free(self); // why is the TYPE macro needed? in case of multiple inheritance (composition)?
 }
 
@@ -264,107 +740,1578 @@ static PyObject* pipeline_repr(struct pipeline* self) {
   return PyUnicode_FromFormat(format, self->filters->n_filters);
 }
 
-// use the fastcall convention, because why the heck not (Python 3.7+). take in a constant array of PyObject pointers.
-/*
-  Currently I accept a scalar or an NumPy array. In the future, I would like to consume a boolean `inplace` parameter
-  for the latter instance to allow me to modify the array in place without creating a new one.
+struct feed_options {
+  int axis;
+  PyObject* out; // borrowed, and NULL unless passed
+  bool inplace;
+  unsigned n_threads; // zero unless passed
+  int output_type; // NPY_DOUBLE or NPY_FLOAT. whatever `dtype` says, or else resolved by `resolve_output_type`
+  bool compact; // whether to leave out the entries that yield nothing
+  bool return_indices; // and say which ones did
+  bool lazy; // whether an iterable comes back as an iterator rather than an array
+};
 
-  I should consider checking the Python version with macros, and falling back to a traditional-style (not fastcall)
-  method definition for versions prior to 3.7.
+/*
+  Outputs come out in single precision when the input is in single precision, or when a
+  float32 buffer is passed to take them. `dtype=` decides for itself. The filters work in
+  double precision throughout regardless, so this only saves on memory traffic.
  */
-static PyObject* pipeline_feed(struct pipeline* self, PyObject* const* args, Py_ssize_t n_args) {
-  if (n_args != 1) {
-    PyErr_SetString(PyExc_NotImplementedError, "pipeline.feed(*) only accepts a singular argument"); // ValueError?
+static void resolve_output_type(PyObject* arg, struct feed_options* options) {
+  if (options->output_type != NPY_NOTYPE)
+    return;
+  PyObject* target = options->inplace? arg : options->out;
+  if ((target == NULL) || !PyArray_Check(target))
+    target = arg;
+  bool single = PyArray_Check(target) && (PyArray_TYPE((PyArrayObject*)target) == NPY_FLOAT);
+  options->output_type = single? NPY_FLOAT : NPY_DOUBLE;
+}
+
+// vets a caller-supplied buffer that ought to take `n_entries` outputs of `type` back to back
+static PyArrayObject* accept_output_buffer(PyObject* out, npy_intp n_entries, int type) {
+  if (!PyArray_Check(out)) {
+    PyErr_SetString(PyExc_TypeError, "the output buffer must be an np.array");
     return NULL;
   }
-  if (PyFloat_Check(args[0]) || PyLong_Check(args[0])) {
-    double input = PyFloat_AsDouble(args[0]); // implicitly converts integers and other related types
-    double output = feed_filter_pipeline(self->filters, input);
-    return PyFloat_FromDouble(output);
+  PyArrayObject* array = (PyArrayObject*)out;
+  if ((PyArray_TYPE(array) != type) || !PyArray_ISBEHAVED(array) || !PyArray_IS_C_CONTIGUOUS(array)) {
+    PyErr_SetString(PyExc_ValueError, (type == NPY_FLOAT)?
+      "the output buffer must be a contiguous and writeable float32 array" :
+      "the output buffer must be a contiguous and writeable float64 array");
+    return NULL;
   }
-  if (PyArray_Check(args[0])) {
-    PyArrayObject* array = (PyArrayObject*)args[0];
-    if (PyArray_NDIM(array) > 1) {
-      PyErr_SetString(PyExc_ValueError, "array can't have multiple dimensions");
-      return NULL;
-    }
-    //PyArrayObject* output_array = PyArray_NewLikeArray(array, NPY_KEEPORDER, NULL, 1);
-    if (PyArray_Size((PyObject*)array) == 0) {
-      return (PyObject*)array; // nothing to do
-    }
-    PyArrayObject* array_operands[2];
-    array_operands[0] = array;
-    array_operands[1] = NULL; // second operand will be designated as the output, and allocated automatically by the iterator
-    npy_uint32 op_flags[2];
-    op_flags[0] = NPY_ITER_READONLY;
-    op_flags[1] = NPY_ITER_WRITEONLY | NPY_ITER_ALLOCATE;
-    PyArray_Descr* op_desc[2];
-    op_desc[0] = PyArray_DescrFromType(NPY_DOUBLE);
-    op_desc[1] = PyArray_DescrFromType(NPY_DOUBLE); // cast to double and output double
-    NpyIter* iterator = NpyIter_MultiNew(2, array_operands,
-      // no seperate external "inner loop", as we treat it all like a flat array.
-      // is there any impact on efficiency for our use-case, to keep advancing the iterator for each element?
-      NPY_ITER_REFS_OK|NPY_ITER_BUFFERED, // buffered to allow casting on the fly
-      // is KEEPORDER the right thing here (or significant), when I treat the array as a 1D ordered sequence?
-      NPY_KEEPORDER, NPY_SAME_KIND_CASTING, op_flags, op_desc);
-      // for NpyIter_New (not the above), the final `NULL` is for an error-message output argument
-    Py_DECREF(op_desc[0]);
-    Py_DECREF(op_desc[1]);
-    if (iterator == NULL) {
-      PyErr_SetString(PyExc_ValueError, "could not initialize an iterator on the array");
-      return NULL;
-    }
-    NpyIter_IterNextFunc* iter_next = NpyIter_GetIterNext(iterator, NULL);
-    if (iter_next == NULL) {
-      NpyIter_Deallocate(iterator);
-      PyErr_SetString(PyExc_ValueError, "could not initialize the iterator `next function` on the array");
-      return NULL;
-    }
-    double** data = (double**)NpyIter_GetDataPtrArray(iterator);
-    do {
-      double input = *data[0];
-      double* output = data[1];
-      // interspersed with NaNs to maintain harmony and consistency with the general API
-      *output = feed_filter_pipeline(self->filters, input);
-    } while (iter_next(iterator));
-    PyArrayObject* output_array = NpyIter_GetOperandArray(iterator)[1];
-    Py_INCREF(output_array);
-    // only call this after incrementing its output's reference count
-    if (NpyIter_Deallocate(iterator) != NPY_SUCCEED) {
-      Py_DECREF(output_array);
-      return NULL;
-    }
-    return (PyObject*)output_array;
+  if (PyArray_SIZE(array) != n_entries) {
+    PyErr_SetString(PyExc_ValueError, "the output buffer is not of the right size");
+    return NULL;
+  }
+  return array;
+}
+
+// for paths that produce doubles in any case, and only narrow them down at the end. buffers passed in are left be
+static PyObject* narrow_output(PyObject* output, struct feed_options* options) {
+  if ((output == NULL) || (options->output_type != NPY_FLOAT) || !PyArray_Check(output)
+      || (PyArray_TYPE((PyArrayObject*)output) == NPY_FLOAT) || options->inplace || (options->out != NULL))
+    return output;
+  PyObject* narrowed = PyArray_Cast((PyArrayObject*)output, NPY_FLOAT);
+  Py_DECREF(output);
+  return narrowed;
+}
+
+/*
+  Well-behaved arrays of the native types are read straight out of memory and written
+  straight into either precision, converting one entry at a time, rather than cast in bulk
+  by a buffered iterator. There is one kernel for every pair of types, stamped out below.
+  Each output may alias its input exactly, since every entry is read before it is overwritten.
+ */
+typedef void (*series_feeder)(struct filter_pipeline* filters, const void* input_data, void* output_data, npy_intp n_entries);
+
+#define NATIVE_INPUT_TYPES(X, output_type) \
+  X(NPY_DOUBLE, npy_double, output_type) X(NPY_FLOAT, npy_float, output_type) \
+  X(NPY_BYTE, npy_byte, output_type) X(NPY_UBYTE, npy_ubyte, output_type) \
+  X(NPY_SHORT, npy_short, output_type) X(NPY_USHORT, npy_ushort, output_type) \
+  X(NPY_INT, npy_int, output_type) X(NPY_UINT, npy_uint, output_type) \
+  X(NPY_LONG, npy_long, output_type) X(NPY_ULONG, npy_ulong, output_type) \
+  X(NPY_LONGLONG, npy_longlong, output_type) X(NPY_ULONGLONG, npy_ulonglong, output_type)
+
+#define DEFINE_SERIES_FEEDER(type_number, input_type, output_type) \
+  static void feed_##input_type##_as_##output_type(struct filter_pipeline* filters, const void* input_data, void* output_data, npy_intp n_entries) { \
+    const input_type* input = input_data; \
+    output_type* output = output_data; \
+    unsigned width = filters->width; \
+    if (width == 1) { \
+      for (npy_intp t = 0; t < n_entries; t += 1) \
+        output[t] = (output_type)feed_filter_pipeline(filters, (double)input[t]); \
+      return; \
+    } \
+    double* scratch = malloc(width * sizeof(double)); \
+    for (npy_intp t = 0; t < n_entries; t += 1) { \
+      feed_filter_pipeline_into(filters, (double)input[t], scratch); \
+      for (unsigned j = 0; j < width; j += 1) \
+        output[t*width + j] = (output_type)scratch[j]; \
+    } \
+    free(scratch); \
+  }
+
+NATIVE_INPUT_TYPES(DEFINE_SERIES_FEEDER, npy_double)
+NATIVE_INPUT_TYPES(DEFINE_SERIES_FEEDER, npy_float)
+
+#define MATCH_SERIES_FEEDER(type_number, input_type, output_type) \
+  case type_number: return feed_##input_type##_as_##output_type;
+
+static series_feeder find_series_feeder(int input_type, int output_type) { // NULL if there is none
+  if (output_type == NPY_FLOAT) {
+    switch (input_type) { NATIVE_INPUT_TYPES(MATCH_SERIES_FEEDER, npy_float) }
+  } else {
+    switch (input_type) { NATIVE_INPUT_TYPES(MATCH_SERIES_FEEDER, npy_double) }
   }
-  // numeric lists are not supported yet. at this point, just do generators and comprehensions.
-  // no extra performance benefits would be afforded.
-  PyErr_SetString(PyExc_TypeError, "please pass a number or unidimensional np.array to pipeline.feed(*)");
   return NULL;
 }
 
-static struct PyMethodDef pipeline_methods[] = {
-  {"feed", (PyCFunction)pipeline_feed, METH_FASTCALL, // not truly a PyCFunction, due to METH_FASTCALL ...?
-    "Feed a value, or a series thereof (array, list, generator,) into the filter pipeline."},
-  {NULL, NULL, 0, NULL} // sentinel
+#define MATCH_NATIVE_SIZE(type_number, input_type, unused) \
+  case type_number: return sizeof(input_type);
+
+static size_t measure_native_type(int input_type) { // zero if there is no kernel for it
+  switch (input_type) { NATIVE_INPUT_TYPES(MATCH_NATIVE_SIZE, unused) }
+  return 0;
+}
+
+static bool is_native_series(PyArrayObject* array) {
+  return PyArray_ISBEHAVED_RO(array) && PyArray_IS_C_CONTIGUOUS(array)
+    && (find_series_feeder(PyArray_TYPE(array), NPY_DOUBLE) != NULL);
+}
+
+static void feed_native_series(struct pipeline* self, PyArrayObject* array, void* output, int output_type) {
+  series_feeder feeder = find_series_feeder(PyArray_TYPE(array), output_type);
+  struct filter_pipeline* filters = self->filters;
+  const void* input = PyArray_DATA(array);
+  npy_intp n_entries = PyArray_SIZE(array);
+  Py_BEGIN_ALLOW_THREADS
+  feeder(filters, input, output, n_entries);
+  Py_END_ALLOW_THREADS
+}
+
+/*
+  Feed a unidimensional series into contiguous outputs of `output_type`, `width` per entry.
+  Native series go through the kernels above, and a buffered iterator only steps in to cast others.
+ */
+static bool feed_series_into(struct pipeline* self, PyArrayObject* array, void* output, int output_type) {
+  unsigned width = self->filters->width;
+  npy_intp n_entries = PyArray_SIZE(array);
+  if (n_entries == 0)
+    return true;
+  if (is_native_series(array)) {
+    feed_native_series(self, array, output, output_type);
+    return true;
+  }
+  NpyIter* iterator = NpyIter_New(array, NPY_ITER_READONLY|NPY_ITER_REFS_OK|NPY_ITER_BUFFERED,
+    NPY_KEEPORDER, NPY_SAME_KIND_CASTING, PyArray_DescrFromType(NPY_DOUBLE)); // steals the descriptor
+  if (iterator == NULL)
+    return false;
+  NpyIter_IterNextFunc* iter_next = NpyIter_GetIterNext(iterator, NULL);
+  if (iter_next == NULL) {
+    NpyIter_Deallocate(iterator);
+    return false;
+  }
+  series_feeder feeder = find_series_feeder(NPY_DOUBLE, output_type); // one entry at a time, out of the buffer
+  size_t output_size = (output_type == NPY_FLOAT)? sizeof(npy_float) : sizeof(npy_double);
+  char* destination = output;
+  double** data = (double**)NpyIter_GetDataPtrArray(iterator);
+  NPY_BEGIN_THREADS_DEF;
+  if (!NpyIter_IterationNeedsAPI(iterator))
+    NPY_BEGIN_THREADS;
+  do {
+    feeder(self->filters, data[0], destination, 1);
+    destination += width * output_size;
+  } while (iter_next(iterator));
+  NPY_END_THREADS;
+  return NpyIter_Deallocate(iterator) == NPY_SUCCEED;
+}
+
+/*
+  Pipelines that report several quantiles, or several taps, gain a trailing axis on their
+  outputs: a number yields a vector, and a series of length T yields a (T, n_columns) array.
+ */
+static PyObject* pipeline_feed_several(struct pipeline* self, PyObject* arg, struct feed_options* options) {
+  npy_intp width = (npy_intp)self->n_columns;
+  int output_type = options->output_type;
+  if (options->inplace) {
+    PyErr_SetString(PyExc_ValueError, "several outputs per entry cannot be written in place of their input");
+    return NULL;
+  }
+  if (PyFloat_Check(arg) || PyLong_Check(arg)) {
+    double input = PyFloat_AsDouble(arg);
+    PyArrayObject* output_array = (options->out != NULL)?
+      accept_output_buffer(options->out, width, output_type) : (PyArrayObject*)PyArray_SimpleNew(1, &width, output_type);
+    if (output_array == NULL)
+      return NULL;
+    if (options->out != NULL)
+      Py_INCREF(output_array);
+    find_series_feeder(NPY_DOUBLE, output_type)(self->filters, &input, PyArray_DATA(output_array), 1);
+    return (PyObject*)output_array;
+  }
+  if (!PyArray_Check(arg)) {
+    PyErr_SetString(PyExc_TypeError, "please pass a number or unidimensional np.array to pipeline.feed(*)");
+    return NULL;
+  }
+  PyArrayObject* array = (PyArrayObject*)arg;
+  if (PyArray_NDIM(array) > 1) {
+    PyErr_SetString(PyExc_ValueError, "array can't have multiple dimensions");
+    return NULL;
+  }
+  npy_intp dims[2] = {PyArray_SIZE(array), width};
+  PyArrayObject* output_array;
+  if (options->out != NULL) {
+    output_array = accept_output_buffer(options->out, dims[0] * width, output_type);
+    Py_XINCREF(output_array);
+  } else {
+    output_array = (PyArrayObject*)PyArray_SimpleNew(2, dims, output_type);
+  }
+  if (output_array == NULL)
+    return NULL;
+  if (!feed_series_into(self, array, PyArray_DATA(output_array), output_type)) {
+    Py_DECREF(output_array);
+    return NULL;
+  }
+  return (PyObject*)output_array;
+}
+
+/*
+  A bank feeds each channel's series through its own pipeline state. The time axis
+  may be either axis of a 2D array, and we walk the strides as they are rather than
+  transposing. A 1D array carries one step for every channel.
+ */
+struct channel_batch {
+  struct filter_pipeline** channels;
+  const char* input;
+  npy_intp input_strides[2]; // channel, then time, in bytes
+  char* output;
+  npy_intp output_strides[2];
+  npy_intp length;
+  bool several; // whether each step yields a contiguous row of outputs
+  unsigned n_channels;
+};
+
+static void feed_channel_batch(void* context, unsigned first, unsigned last) {
+  struct channel_batch* batch = context;
+  for (unsigned c = first; c < last; c += 1) {
+    struct filter_pipeline* filters = batch->channels[c];
+    const char* input = batch->input + c*batch->input_strides[0];
+    char* output = batch->output + c*batch->output_strides[0];
+    for (npy_intp t = 0; t < batch->length; t += 1) {
+      double entry = *(const double*)(input + t*batch->input_strides[1]);
+      double* destination = (double*)(output + t*batch->output_strides[1]);
+      if (batch->several)
+        feed_filter_pipeline_into(filters, entry, destination);
+      else
+        *destination = feed_filter_pipeline(filters, entry);
+    }
+  }
+}
+
+static void feed_lane_batch(void* context, unsigned first, unsigned last) { // over blocks of channels that go abreast. see lanes.h
+  struct channel_batch* batch = context;
+  unsigned first_channel = first * LANE_BLOCK;
+  unsigned last_channel = (last * LANE_BLOCK < batch->n_channels)? (last * LANE_BLOCK) : batch->n_channels;
+  ptrdiff_t input_strides[2] = { batch->input_strides[0], batch->input_strides[1] };
+  ptrdiff_t output_strides[2] = { batch->output_strides[0], batch->output_strides[1] };
+  feed_channels_in_lanes(batch->channels + first_channel, last_channel - first_channel,
+    batch->input + first_channel*input_strides[0], input_strides,
+    batch->output + first_channel*output_strides[0], output_strides, (size_t)batch->length);
+}
+
+#define MINIMUM_PARALLEL_BATCH 16384 // entries below which spawning threads isn't worth it
+
+static PyObject* pipeline_feed_bank(struct pipeline* self, PyObject* arg, struct feed_options* options) {
+  int axis = options->axis;
+  PyArrayObject* array = (PyArrayObject*)PyArray_FROM_OTF(arg, NPY_DOUBLE, NPY_ARRAY_ALIGNED); // no copy for aligned doubles, however strided
+  if (array == NULL)
+    return NULL;
+  int n_dims = PyArray_NDIM(array);
+  if ((n_dims < 1) || (n_dims > 2)) {
+    Py_DECREF(array);
+    PyErr_SetString(PyExc_ValueError, "a bank takes either one step per channel or a 2D array of series");
+    return NULL;
+  }
+  if (axis < 0)
+    axis += n_dims;
+  if ((axis < 0) || (axis >= n_dims)) {
+    Py_DECREF(array);
+    PyErr_SetString(PyExc_ValueError, "`axis` is out of bounds");
+    return NULL;
+  }
+  int channel_axis = (n_dims == 1)? 0 : (1 - axis);
+  if (PyArray_DIM(array, channel_axis) != (npy_intp)self->n_channels) {
+    Py_DECREF(array);
+    PyErr_SetString(PyExc_ValueError, "the number of channels does not match");
+    return NULL;
+  }
+  npy_intp dims[3];
+  int n_output_dims = n_dims;
+  for (int d = 0; d < n_dims; d += 1)
+    dims[d] = PyArray_DIM(array, d);
+  if (self->n_columns > 0)
+    dims[n_output_dims++] = (npy_intp)self->n_columns;
+  PyArrayObject* output_array;
+  if (options->inplace || (options->out != NULL)) { // any strides will do here
+    output_array = options->inplace? array : (PyArrayObject*)options->out;
+    bool fits = PyArray_Check(output_array) && (PyArray_TYPE(output_array) == NPY_DOUBLE) &&
+      PyArray_ISBEHAVED(output_array) && (PyArray_NDIM(output_array) == n_output_dims) &&
+      PyArray_CompareLists(PyArray_DIMS(output_array), dims, n_output_dims);
+    if (options->inplace && ((PyObject*)array != arg))
+      fits = false; // the input had to be converted, so there is no writing back into it
+    if (!fits) {
+      Py_DECREF(array);
+      PyErr_SetString(PyExc_ValueError, "the output buffer must be a writeable float64 array shaped like the output");
+      return NULL;
+    }
+    Py_INCREF(output_array);
+  } else {
+    output_array = (PyArrayObject*)PyArray_SimpleNew(n_output_dims, dims, NPY_DOUBLE);
+  }
+  if (output_array == NULL) {
+    Py_DECREF(array);
+    return NULL;
+  }
+  struct channel_batch batch = {
+    .channels = self->channels,
+    .input = PyArray_BYTES(array),
+    .output = PyArray_BYTES(output_array),
+    .length = (n_dims == 1)? 1 : PyArray_DIM(array, axis),
+    .several = (self->n_columns > 0),
+  };
+  batch.input_strides[0] = PyArray_STRIDE(array, channel_axis);
+  batch.output_strides[0] = PyArray_STRIDE(output_array, channel_axis);
+  batch.input_strides[1] = (n_dims == 1)? 0 : PyArray_STRIDE(array, axis);
+  batch.output_strides[1] = (n_dims == 1)? 0 : PyArray_STRIDE(output_array, axis);
+  unsigned n_threads = (options->n_threads > 0)? options->n_threads : self->n_threads;
+  if (batch.length * (npy_intp)self->n_channels < MINIMUM_PARALLEL_BATCH)
+    n_threads = 1;
+  bool abreast = (n_dims == 2) && can_feed_in_lanes(self->channels[0]);
+  unsigned n_blocks = (self->n_channels + LANE_BLOCK - 1) / LANE_BLOCK;
+  batch.n_channels = self->n_channels;
+  Py_BEGIN_ALLOW_THREADS
+  if (abreast)
+    run_in_parallel(n_blocks, n_threads, feed_lane_batch, &batch);
+  else
+    run_in_parallel(self->n_channels, n_threads, feed_channel_batch, &batch);
+  Py_END_ALLOW_THREADS
+  Py_DECREF(array);
+  return narrow_output((PyObject*)output_array, options);
+}
+
+/*
+  Subsampling pipelines may report only the entries that yield outputs, back to back, rather
+  than NaNs for all the others, which cuts the output down by the stride. Their positions in
+  this call's input come along as well on request. The clocks carry on across calls as usual,
+  so the next call picks up at `pipe.phase` entries past the last output.
+ */
+static bool shrink_array(PyArrayObject* array, npy_intp length) {
+  npy_intp dims[2] = {length, (PyArray_NDIM(array) > 1)? PyArray_DIM(array, 1) : 1};
+  PyArray_Dims shape = { .ptr = dims, .len = PyArray_NDIM(array) };
+  PyObject* result = PyArray_Resize(array, &shape, 0, NPY_CORDER); // hands memory back, since nobody else has seen it yet
+  Py_XDECREF(result); // None
+  return result != NULL;
+}
+
+static PyObject* pipeline_feed_compact(struct pipeline* self, PyObject* values, PyObject* timestamps, struct feed_options* options) {
+  if (options->inplace || (options->out != NULL) || (self->n_channels > 0)) {
+    PyErr_SetString(PyExc_ValueError, "compact outputs are only for lone pipelines, into arrays of their own");
+    return NULL;
+  }
+  PyArrayObject* array = (PyArrayObject*)PyArray_FROM_OTF(values, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+  PyArrayObject* times = NULL;
+  if (array == NULL)
+    return NULL;
+  npy_intp n_entries = PyArray_SIZE(array);
+  if (timestamps != NULL) {
+    times = (PyArrayObject*)PyArray_FROM_OTF(timestamps, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+    if ((times != NULL) && (PyArray_SIZE(times) != n_entries)) {
+      Py_CLEAR(times);
+      PyErr_SetString(PyExc_ValueError, "the timestamps and the values must be of the same length");
+    }
+    if (times == NULL) {
+      Py_DECREF(array);
+      return NULL;
+    }
+  }
+  npy_intp width = (npy_intp)self->filters->width;
+  npy_intp dims[2] = {(npy_intp)bound_pipeline_outputs(self->filters, (size_t)n_entries), width};
+  PyArrayObject* output_array = (PyArrayObject*)PyArray_SimpleNew((self->n_columns > 0)? 2 : 1, dims, NPY_DOUBLE);
+  PyArrayObject* index_array = options->return_indices? (PyArrayObject*)PyArray_SimpleNew(1, dims, NPY_INTP) : NULL;
+  if ((output_array == NULL) || (options->return_indices && (index_array == NULL))) {
+    Py_DECREF(array);
+    Py_XDECREF(times);
+    Py_XDECREF(output_array);
+    Py_XDECREF(index_array);
+    return NULL;
+  }
+  const double* input = PyArray_DATA(array);
+  const double* input_times = (times != NULL)? PyArray_DATA(times) : NULL;
+  double* output = PyArray_DATA(output_array);
+  size_t* indices = (index_array != NULL)? PyArray_DATA(index_array) : NULL; // npy_intp is as wide, and the indices are never negative
+  size_t n_yielded;
+  Py_BEGIN_ALLOW_THREADS
+  n_yielded = feed_filter_pipeline_compactly(self->filters, input, input_times, (size_t)n_entries, output, indices);
+  Py_END_ALLOW_THREADS
+  Py_DECREF(array);
+  Py_XDECREF(times);
+  if (!shrink_array(output_array, (npy_intp)n_yielded) || ((index_array != NULL) && !shrink_array(index_array, (npy_intp)n_yielded))) {
+    Py_DECREF(output_array);
+    Py_XDECREF(index_array);
+    return NULL;
+  }
+  PyObject* result = narrow_output((PyObject*)output_array, options);
+  if ((index_array == NULL) || (result == NULL)) {
+    Py_XDECREF(index_array);
+    return result;
+  }
+  return Py_BuildValue("(NN)", result, (PyObject*)index_array); // steals both
+}
+
+// collects the keyword arguments of the fastcall convention, which trail the positional ones
+static bool parse_feed_keywords(PyObject* const* args, Py_ssize_t n_args, PyObject* kwnames, struct feed_options* options) {
+  if (kwnames == NULL)
+    return true;
+  for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(kwnames); i += 1) {
+    PyObject* name = PyTuple_GET_ITEM(kwnames, i);
+    PyObject* value = args[n_args + i];
+    if (PyUnicode_CompareWithASCIIString(name, "axis") == 0) {
+      options->axis = (int)PyLong_AsLong(value);
+      if ((options->axis == -1) && PyErr_Occurred())
+        return false;
+    } else if (PyUnicode_CompareWithASCIIString(name, "out") == 0) {
+      options->out = (value != Py_None)? value : NULL;
+    } else if (PyUnicode_CompareWithASCIIString(name, "threads") == 0) {
+      long n_threads = PyLong_AsLong(value);
+      if ((n_threads == -1) && PyErr_Occurred())
+        return false;
+      if (n_threads < 1) {
+        PyErr_SetString(PyExc_ValueError, "please pass a positive number of `threads`");
+        return false;
+      }
+      options->n_threads = (unsigned)n_threads;
+    } else if (PyUnicode_CompareWithASCIIString(name, "dtype") == 0) {
+      PyArray_Descr* descriptor = NULL;
+      if (!PyArray_DescrConverter(value, &descriptor))
+        return false;
+      options->output_type = descriptor->type_num;
+      Py_DECREF(descriptor);
+      if ((options->output_type != NPY_FLOAT) && (options->output_type != NPY_DOUBLE)) {
+        PyErr_SetString(PyExc_ValueError, "the output `dtype` must be either float32 or float64");
+        return false;
+      }
+    } else if (PyUnicode_CompareWithASCIIString(name, "inplace") == 0) {
+      int truth = PyObject_IsTrue(value);
+      if (truth < 0)
+        return false;
+      options->inplace = truth;
+    } else if (PyUnicode_CompareWithASCIIString(name, "compact") == 0) {
+      int truth = PyObject_IsTrue(value);
+      if (truth < 0)
+        return false;
+      options->compact = truth;
+    } else if (PyUnicode_CompareWithASCIIString(name, "return_indices") == 0) {
+      int truth = PyObject_IsTrue(value);
+      if (truth < 0)
+        return false;
+      options->return_indices = truth;
+    } else if (PyUnicode_CompareWithASCIIString(name, "lazy") == 0) {
+      int truth = PyObject_IsTrue(value);
+      if (truth < 0)
+        return false;
+      options->lazy = truth;
+    } else {
+      PyErr_Format(PyExc_TypeError, "pipeline.feed(*) got an unexpected keyword argument '%U'", name);
+      return false;
+    }
+  }
+  return true;
+}
+
+// use the fastcall convention, because why the heck not (Python 3.7+). take in a constant array of PyObject pointers.
+/*
+  Currently I accept a scalar or an NumPy array here. For the latter, `out=` names a contiguous float64 buffer to fill
+  instead of allocating a new one, and `inplace=True` overwrites the input array itself.
+
+  I should consider checking the Python version with macros, and falling back to a traditional-style (not fastcall)
+  method definition for versions prior to 3.7.
+ */
+static PyObject* pipeline_feed_lone(struct pipeline* self, PyObject* arg, struct feed_options* options) {
+  bool writes_back = options->inplace || (options->out != NULL);
+  if (writes_back && !PyArray_Check(arg)) {
+    PyErr_SetString(PyExc_TypeError, "`out` and `inplace` only apply to arrays");
+    return NULL;
+  }
+  if (PyFloat_Check(arg) || PyLong_Check(arg)) {
+    double input = PyFloat_AsDouble(arg); // implicitly converts integers and other related types
+    double output = feed_filter_pipeline(self->filters, input);
+    return PyFloat_FromDouble(output);
+  }
+  if (PyArray_Check(arg)) {
+    PyArrayObject* array = (PyArrayObject*)arg;
+    if (PyArray_NDIM(array) > 1) {
+      PyErr_SetString(PyExc_ValueError, "array can't have multiple dimensions");
+      return NULL;
+    }
+    //PyArrayObject* output_array = PyArray_NewLikeArray(array, NPY_KEEPORDER, NULL, 1);
+    if (writes_back) { // no allocation and no buffering on the way out
+      PyObject* out = options->inplace? arg : options->out;
+      PyArrayObject* output_array = accept_output_buffer(out, PyArray_SIZE(array), options->output_type);
+      if (output_array == NULL)
+        return NULL;
+      if (!feed_series_into(self, array, PyArray_DATA(output_array), options->output_type))
+        return NULL;
+      Py_INCREF(output_array);
+      return (PyObject*)output_array;
+    }
+    if (PyArray_Size((PyObject*)array) == 0) {
+      Py_INCREF(array);
+      return (PyObject*)array; // nothing to do
+    }
+    if (is_native_series(array)) {
+      PyArrayObject* output_array = (PyArrayObject*)PyArray_SimpleNew(PyArray_NDIM(array), PyArray_DIMS(array), options->output_type);
+      if (output_array != NULL)
+        feed_native_series(self, array, PyArray_DATA(output_array), options->output_type);
+      return (PyObject*)output_array;
+    }
+    PyArrayObject* array_operands[2];
+    array_operands[0] = array;
+    array_operands[1] = NULL; // second operand will be designated as the output, and allocated automatically by the iterator
+    npy_uint32 op_flags[2];
+    op_flags[0] = NPY_ITER_READONLY;
+    op_flags[1] = NPY_ITER_WRITEONLY | NPY_ITER_ALLOCATE;
+    PyArray_Descr* op_desc[2];
+    op_desc[0] = PyArray_DescrFromType(NPY_DOUBLE);
+    op_desc[1] = PyArray_DescrFromType(NPY_DOUBLE); // cast to double and output double
+    NpyIter* iterator = NpyIter_MultiNew(2, array_operands,
+      // no seperate external "inner loop", as we treat it all like a flat array.
+      // is there any impact on efficiency for our use-case, to keep advancing the iterator for each element?
+      NPY_ITER_REFS_OK|NPY_ITER_BUFFERED, // buffered to allow casting on the fly
+      // is KEEPORDER the right thing here (or significant), when I treat the array as a 1D ordered sequence?
+      NPY_KEEPORDER, NPY_SAME_KIND_CASTING, op_flags, op_desc);
+      // for NpyIter_New (not the above), the final `NULL` is for an error-message output argument
+    Py_DECREF(op_desc[0]);
+    Py_DECREF(op_desc[1]);
+    if (iterator == NULL) {
+      PyErr_SetString(PyExc_ValueError, "could not initialize an iterator on the array");
+      return NULL;
+    }
+    NpyIter_IterNextFunc* iter_next = NpyIter_GetIterNext(iterator, NULL);
+    if (iter_next == NULL) {
+      NpyIter_Deallocate(iterator);
+      PyErr_SetString(PyExc_ValueError, "could not initialize the iterator `next function` on the array");
+      return NULL;
+    }
+    double** data = (double**)NpyIter_GetDataPtrArray(iterator);
+    NPY_BEGIN_THREADS_DEF;
+    if (!NpyIter_IterationNeedsAPI(iterator)) // casting from Python objects would need the GIL
+      NPY_BEGIN_THREADS;
+    do {
+      double input = *data[0];
+      double* output = data[1];
+      // interspersed with NaNs to maintain harmony and consistency with the general API
+      *output = feed_filter_pipeline(self->filters, input);
+    } while (iter_next(iterator));
+    NPY_END_THREADS;
+    PyArrayObject* output_array = NpyIter_GetOperandArray(iterator)[1];
+    Py_INCREF(output_array);
+    // only call this after incrementing its output's reference count
+    if (NpyIter_Deallocate(iterator) != NPY_SUCCEED) {
+      Py_DECREF(output_array);
+      return NULL;
+    }
+    return narrow_output((PyObject*)output_array, options);
+  }
+  // iterables go by way of `pipeline_feed_iterable`, so this is anything else
+  PyErr_SetString(PyExc_TypeError, "please pass a number or unidimensional np.array to pipeline.feed(*)");
+  return NULL;
+}
+
+/*
+  Any other iterable, be it a list, a tuple, or a generator, is pulled `FEED_CHUNK` items at a time
+  into a small buffer of doubles on the stack, which is then fed through natively without the GIL.
+  So a long list never gets copied whole into an intermediate array first. The output array starts
+  out as long as the iterable hints it will be, and grows geometrically in place when it falls short.
+ */
+#define FEED_CHUNK 1024
+
+// how many items it took, or -1 on an error. fewer than asked for means the iterator ran dry
+static npy_intp pull_chunk(PyObject* iterator, double* chunk, npy_intp n_wanted) {
+  npy_intp n_pulled = 0;
+  while (n_pulled < n_wanted) {
+    PyObject* item = PyIter_Next(iterator);
+    if (item == NULL)
+      return PyErr_Occurred()? -1 : n_pulled;
+    double value = PyFloat_AsDouble(item); // numbers of any sort, NumPy scalars included
+    Py_DECREF(item);
+    if ((value == -1.0) && PyErr_Occurred())
+      return -1;
+    chunk[n_pulled] = value;
+    n_pulled += 1;
+  }
+  return n_pulled;
+}
+
+static bool resize_output(PyArrayObject* array, npy_intp length) {
+  npy_intp dims[2] = {length, PyArray_NDIM(array) > 1? PyArray_DIM(array, 1) : 1};
+  PyArray_Dims shape = {dims, PyArray_NDIM(array)};
+  PyObject* none = PyArray_Resize(array, &shape, 0, NPY_CORDER); // nobody else holds a reference yet
+  Py_XDECREF(none);
+  return none != NULL;
+}
+
+static PyObject* pipeline_feed_iterable(struct pipeline* self, PyObject* arg, struct feed_options* options) {
+  if (options->inplace || (options->out != NULL)) {
+    PyErr_SetString(PyExc_TypeError, "`out` and `inplace` only apply to arrays");
+    return NULL;
+  }
+  PyObject* iterator = PyObject_GetIter(arg);
+  if (iterator == NULL) {
+    PyErr_SetString(PyExc_TypeError, "please pass a number, an iterable of numbers, or a unidimensional np.array to pipeline.feed(*)");
+    return NULL;
+  }
+  Py_ssize_t capacity = PyObject_LengthHint(arg, FEED_CHUNK);
+  npy_intp dims[2] = {(npy_intp)capacity, (npy_intp)self->filters->width};
+  PyArrayObject* output_array = (capacity < 0)? NULL :
+    (PyArrayObject*)PyArray_SimpleNew((self->n_columns > 0)? 2 : 1, dims, options->output_type);
+  if (output_array == NULL) {
+    Py_DECREF(iterator);
+    return NULL;
+  }
+  series_feeder feeder = find_series_feeder(NPY_DOUBLE, options->output_type);
+  npy_intp entry_size = dims[1] * PyArray_ITEMSIZE(output_array);
+  npy_intp n_entries = 0;
+  double chunk[FEED_CHUNK];
+  for (;;) {
+    npy_intp n_pulled = pull_chunk(iterator, chunk, FEED_CHUNK);
+    if (n_pulled < 0)
+      goto fail;
+    if ((n_entries + n_pulled > capacity) && !resize_output(output_array, capacity = (2*capacity > n_entries + n_pulled)? 2*capacity : n_entries + n_pulled))
+      goto fail;
+    char* output = PyArray_BYTES(output_array) + n_entries*entry_size;
+    Py_BEGIN_ALLOW_THREADS
+    feeder(self->filters, chunk, output, n_pulled);
+    Py_END_ALLOW_THREADS
+    n_entries += n_pulled;
+    if (n_pulled < FEED_CHUNK)
+      break;
+  }
+  Py_DECREF(iterator);
+  if ((n_entries < capacity) && !resize_output(output_array, n_entries)) {
+    Py_DECREF(output_array);
+    return NULL;
+  }
+  return (PyObject*)output_array;
+fail:
+  Py_DECREF(iterator);
+  Py_DECREF(output_array);
+  return NULL;
+}
+
+/*
+  With `lazy=True`, the iterable comes back as an iterator over the outputs instead, which pulls
+  its source one chunk at a time only as it is drained. Nothing is ever held beyond a chunk, so
+  endless generators work too. The pipeline stays its own, and may be fed or reset in between.
+  Entries yield floats, or small arrays when each yields several outputs.
+ */
+struct pipeline_stream {
+  PyObject_HEAD
+  struct pipeline* owner;
+  PyObject* source; // an iterator, or NULL once it has run dry
+  int output_type;
+  npy_intp n_ready; // outputs of the current chunk
+  npy_intp cursor; // and how far along them we are
+  char* outputs; // FEED_CHUNK entries' worth
+  double inputs[FEED_CHUNK];
+};
+
+static void pipeline_stream_dealloc(struct pipeline_stream* self) {
+  Py_XDECREF(self->owner);
+  Py_XDECREF(self->source);
+  PyMem_Free(self->outputs);
+  Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static bool refill_pipeline_stream(struct pipeline_stream* self) {
+  npy_intp n_pulled = pull_chunk(self->source, self->inputs, FEED_CHUNK);
+  if (n_pulled < 0)
+    return false;
+  if (n_pulled < FEED_CHUNK)
+    Py_CLEAR(self->source);
+  struct pipeline* owner = self->owner;
+  if (owner->busy) { // the source may well have been feeding it
+    PyErr_SetString(PyExc_RuntimeError, "this pipeline is already being fed from another thread");
+    return false;
+  }
+  owner->busy = true;
+  series_feeder feeder = find_series_feeder(NPY_DOUBLE, self->output_type);
+  Py_BEGIN_ALLOW_THREADS
+  feeder(owner->filters, self->inputs, self->outputs, n_pulled);
+  Py_END_ALLOW_THREADS
+  owner->busy = false;
+  self->n_ready = n_pulled;
+  self->cursor = 0;
+  return true;
+}
+
+static PyObject* pipeline_stream_next(struct pipeline_stream* self) {
+  if (self->cursor == self->n_ready) {
+    if ((self->source == NULL) || !refill_pipeline_stream(self) || (self->n_ready == 0))
+      return NULL; // StopIteration when no exception is set
+  }
+  npy_intp width = (npy_intp)self->owner->filters->width;
+  npy_intp entry = self->cursor;
+  self->cursor += 1;
+  if (self->owner->n_columns == 0)
+    return PyFloat_FromDouble((self->output_type == NPY_FLOAT)? ((float*)self->outputs)[entry] : ((double*)self->outputs)[entry]);
+  PyArrayObject* row = (PyArrayObject*)PyArray_SimpleNew(1, &width, self->output_type);
+  if (row != NULL)
+    memcpy(PyArray_DATA(row), self->outputs + entry*PyArray_NBYTES(row), PyArray_NBYTES(row));
+  return (PyObject*)row;
+}
+
+static PyTypeObject pipeline_stream_type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "rolling_quantiles.triton.PipelineStream",
+  .tp_doc = "The outputs of a pipeline over an iterable, produced as they are asked for.",
+  .tp_basicsize = sizeof(struct pipeline_stream),
+  .tp_itemsize = 0,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_iter = PyObject_SelfIter,
+  .tp_iternext = (iternextfunc)pipeline_stream_next,
+  .tp_dealloc = (destructor)pipeline_stream_dealloc,
+};
+
+static PyObject* pipeline_feed_lazily(struct pipeline* self, PyObject* arg, struct feed_options* options) {
+  PyObject* source = PyObject_GetIter(arg);
+  if (source == NULL)
+    return NULL;
+  struct pipeline_stream* stream = PyObject_New(struct pipeline_stream, &pipeline_stream_type);
+  if (stream == NULL) {
+    Py_DECREF(source);
+    return NULL;
+  }
+  size_t item_size = (options->output_type == NPY_FLOAT)? sizeof(float) : sizeof(double);
+  Py_INCREF(self);
+  stream->owner = self;
+  stream->source = source;
+  stream->output_type = options->output_type;
+  stream->n_ready = stream->cursor = 0;
+  stream->outputs = PyMem_Malloc(FEED_CHUNK * self->filters->width * item_size);
+  if (stream->outputs == NULL) {
+    Py_DECREF(stream);
+    return PyErr_NoMemory();
+  }
+  return (PyObject*)stream;
+}
+
+/*
+  A lone pipeline may split a long array into chunks spread over `threads`, and report exactly
+  what it would have serially. The pipeline's state ends up in whichever twin took the last chunk.
+ */
+static PyObject* pipeline_feed_chunked(struct pipeline* self, PyObject* arg, struct feed_options* options) {
+  npy_intp width = (npy_intp)self->filters->width;
+  bool several = (self->n_columns > 0);
+  if (options->inplace && several) {
+    PyErr_SetString(PyExc_ValueError, "several outputs per entry cannot be written in place of their input");
+    return NULL;
+  }
+  PyArrayObject* array = (PyArrayObject*)PyArray_FROM_OTF(arg, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+  if (array == NULL)
+    return NULL;
+  npy_intp n_entries = PyArray_SIZE(array);
+  PyArrayObject* output_array;
+  if (options->inplace && ((PyObject*)array != arg)) {
+    Py_DECREF(array);
+    PyErr_SetString(PyExc_ValueError, "the input had to be converted, so there is no writing back into it");
+    return NULL;
+  } else if (options->inplace || (options->out != NULL)) {
+    output_array = accept_output_buffer(options->inplace? arg : options->out, n_entries * width, NPY_DOUBLE);
+    Py_XINCREF(output_array);
+  } else {
+    npy_intp dims[2] = {n_entries, width};
+    output_array = (PyArrayObject*)PyArray_SimpleNew(several? 2 : 1, dims, NPY_DOUBLE);
+  }
+  if (output_array == NULL) {
+    Py_DECREF(array);
+    return NULL;
+  }
+  const double* input = (const double*)PyArray_DATA(array);
+  double* output = (double*)PyArray_DATA(output_array);
+  struct filter_pipeline* filters = self->filters;
+  Py_BEGIN_ALLOW_THREADS
+  filters = feed_filter_pipeline_in_chunks(filters, input, output, (size_t)n_entries, options->n_threads);
+  Py_END_ALLOW_THREADS
+  self->filters = filters;
+  self->channels[0] = filters;
+  Py_DECREF(array);
+  return narrow_output((PyObject*)output_array, options);
+}
+
+/*
+  Timed pipelines take their timestamps in lockstep with the values, either as a pair of numbers
+  or as a pair of equally long unidimensional arrays. Each is converted to contiguous doubles only
+  when it isn't already. Timestamps must not decrease, and a NaN timestamp marks a missing value.
+ */
+static PyObject* pipeline_feed_timed(struct pipeline* self, PyObject* values, PyObject* timestamps, struct feed_options* options) {
+  npy_intp width = (npy_intp)self->filters->width;
+  bool several = (self->n_columns > 0);
+  if (PyFloat_Check(values) || PyLong_Check(values)) {
+    if (options->inplace || (options->out != NULL)) {
+      PyErr_SetString(PyExc_TypeError, "`out` and `inplace` only apply to arrays");
+      return NULL;
+    }
+    double input = PyFloat_AsDouble(values);
+    double timestamp = PyFloat_AsDouble(timestamps);
+    if ((timestamp == -1.0) && PyErr_Occurred())
+      return NULL;
+    if (!several)
+      return PyFloat_FromDouble(feed_filter_pipeline_at(self->filters, input, timestamp));
+    PyArrayObject* output_array = (PyArrayObject*)PyArray_SimpleNew(1, &width, NPY_DOUBLE);
+    if (output_array != NULL)
+      feed_filter_pipeline_at_into(self->filters, input, timestamp, (double*)PyArray_DATA(output_array));
+    return (PyObject*)output_array;
+  }
+  if (options->inplace && (several || !PyArray_Check(values))) {
+    PyErr_SetString(PyExc_ValueError, "only a lone quantile can be written in place of its input array");
+    return NULL;
+  }
+  PyArrayObject* array = (PyArrayObject*)PyArray_FROM_OTF(values, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+  if (array == NULL)
+    return NULL;
+  PyArrayObject* times = (PyArrayObject*)PyArray_FROM_OTF(timestamps, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+  if (times == NULL) {
+    Py_DECREF(array);
+    return NULL;
+  }
+  npy_intp n_entries = PyArray_SIZE(array);
+  PyArrayObject* output_array = NULL;
+  if ((PyArray_NDIM(array) > 1) || (PyArray_NDIM(times) > 1)) {
+    PyErr_SetString(PyExc_ValueError, "array can't have multiple dimensions");
+  } else if (PyArray_SIZE(times) != n_entries) {
+    PyErr_SetString(PyExc_ValueError, "there must be exactly one timestamp per value");
+  } else if (options->inplace && ((PyObject*)array != values)) {
+    PyErr_SetString(PyExc_ValueError, "the input had to be converted, so there is no writing back into it");
+  } else if (options->inplace || (options->out != NULL)) {
+    output_array = accept_output_buffer(options->inplace? values : options->out, n_entries * width, NPY_DOUBLE);
+    Py_XINCREF(output_array);
+  } else {
+    npy_intp dims[2] = {n_entries, width};
+    output_array = (PyArrayObject*)PyArray_SimpleNew(several? 2 : 1, dims, NPY_DOUBLE);
+  }
+  if (output_array != NULL) {
+    const double* input = (const double*)PyArray_DATA(array);
+    const double* input_times = (const double*)PyArray_DATA(times);
+    double* output = (double*)PyArray_DATA(output_array);
+    Py_BEGIN_ALLOW_THREADS
+    if (several) {
+      for (npy_intp t = 0; t < n_entries; t += 1)
+        feed_filter_pipeline_at_into(self->filters, input[t], input_times[t], output + t*width);
+    } else {
+      for (npy_intp t = 0; t < n_entries; t += 1)
+        output[t] = feed_filter_pipeline_at(self->filters, input[t], input_times[t]);
+    }
+    Py_END_ALLOW_THREADS
+  }
+  Py_DECREF(array);
+  Py_DECREF(times);
+  return narrow_output((PyObject*)output_array, options);
+}
+
+// bytes, array.array, memoryviews and the like become arrays over the very same memory, so they take any path an array would
+static PyObject* adopt_buffer(PyObject* arg) {
+  if (PyArray_Check(arg) || PyFloat_Check(arg) || PyLong_Check(arg) || !PyObject_CheckBuffer(arg)) {
+    Py_INCREF(arg);
+    return arg;
+  }
+  PyObject* view = PyMemoryView_FromObject(arg); // bytes come out as unsigned bytes through a view, rather than as one long string
+  if (view == NULL)
+    return NULL;
+  PyObject* array = PyArray_FromAny(view, NULL, 0, 0, 0, NULL);
+  Py_DECREF(view);
+  return array;
+}
+
+static bool find_integer_domain(int input_type, double* lowest, double* highest) { // of the types narrow enough to count
+  switch (input_type) {
+    case NPY_BYTE: *lowest = NPY_MIN_BYTE; *highest = NPY_MAX_BYTE; return true;
+    case NPY_UBYTE: *lowest = 0; *highest = NPY_MAX_UBYTE; return true;
+    case NPY_SHORT: *lowest = NPY_MIN_SHORT; *highest = NPY_MAX_SHORT; return true;
+    case NPY_USHORT: *lowest = 0; *highest = NPY_MAX_USHORT; return true;
+    default: return false;
+  }
+}
+
+// from the first stage's description, which snapshots and clones carry along
+static void recall_counted_domain(struct pipeline* self) {
+  self->counting = (self->filters->n_filters > 0) && self->filters->descriptions[0].settled;
+  if (self->counting) {
+    self->lowest = self->filters->descriptions[0].lowest;
+    self->highest = self->filters->descriptions[0].highest;
+  }
+}
+
+/*
+  A pipeline that has yet to see anything, and is first fed integers of no more than 16 bits,
+  switches its first stage over to counting them. See `count_filter_pipeline_over_domain`.
+  From then on it only takes integers within that domain, since the histogram would silently
+  clamp anything else. See `keeps_to_counted_domain`.
+ */
+static void settle_engines(struct pipeline* self, int input_type) {
+  double lowest, highest;
+  if (!find_integer_domain(input_type, &lowest, &highest))
+    return;
+  unsigned n_states = (self->n_channels > 0)? self->n_channels : 1;
+  for (unsigned c = 0; c < n_states; c += 1) {
+    struct filter_pipeline* twin = count_filter_pipeline_over_domain(self->channels[c], lowest, highest);
+    if (twin == NULL)
+      return; // the channels share descriptions, so that holds for every one of them
+    destroy_filter_pipeline(self->channels[c]);
+    self->channels[c] = twin;
+  }
+  self->filters = self->channels[0];
+  recall_counted_domain(self);
+}
+
+static bool counts_within_domain(struct pipeline* self, int input_type) {
+  double lowest, highest;
+  return find_integer_domain(input_type, &lowest, &highest) && (lowest >= self->lowest) && (highest <= self->highest);
+}
+
+static bool refuse_outside_counted_domain(struct pipeline* self) {
+  PyErr_Format(PyExc_ValueError, "this pipeline counts the integers from %lld to %lld that it was first fed, "
+    "so it only takes arrays of an integer type within those, or integers one at a time",
+    (long long)self->lowest, (long long)self->highest);
+  return false;
+}
+
+// by the dtype for arrays, and by the value for scalars. sets a ValueError if not
+static bool keeps_to_counted_domain(struct pipeline* self, PyObject* values) {
+  if (!self->counting)
+    return true;
+  if (PyFloat_Check(values) || PyLong_Check(values)) {
+    double value = PyFloat_AsDouble(values);
+    if (PyErr_Occurred())
+      return false;
+    if ((value == floor(value)) && (value >= self->lowest) && (value <= self->highest))
+      return true;
+  } else if (PyArray_Check(values) && counts_within_domain(self, PyArray_TYPE((PyArrayObject*)values)))
+    return true;
+  return refuse_outside_counted_domain(self);
+}
+
+/*
+  The native loops run without the GIL, so that separate pipelines may be fed concurrently
+  from Python threads. A pipeline's own state must never be touched by two threads at once,
+  and `busy` turns that mistake into an exception. It is only ever read and written while
+  holding the GIL, which makes the check-and-set atomic.
+ */
+static PyObject* pipeline_feed(struct pipeline* self, PyObject* const* args, Py_ssize_t n_args, PyObject* kwnames) {
+  if ((n_args < 1) || (n_args > 2)) {
+    PyErr_SetString(PyExc_NotImplementedError, "pipeline.feed(*) accepts values, and timestamps if the pipeline spans time"); // ValueError?
+    return NULL;
+  }
+  if ((n_args == 2) != self->timed) {
+    PyErr_SetString(PyExc_TypeError, self->timed?
+      "this pipeline spans time, so please pass timestamps alongside the values" :
+      "timestamps only apply to pipelines with a `duration`");
+    return NULL;
+  }
+  struct feed_options options = { .axis = -1, .out = NULL, .inplace = false, .n_threads = 0, .output_type = NPY_NOTYPE };
+  if (!parse_feed_keywords(args, n_args, kwnames, &options))
+    return NULL;
+  if (options.lazy && (self->timed || (self->n_channels > 0) || options.compact || options.inplace || (options.out != NULL))) {
+    PyErr_SetString(PyExc_ValueError, "`lazy` only applies to lone pipelines that span no time, into no buffer of their own");
+    return NULL;
+  }
+  PyObject* values = adopt_buffer(args[0]);
+  if (values == NULL)
+    return NULL;
+  resolve_output_type(values, &options);
+  if (self->busy) {
+    PyErr_SetString(PyExc_RuntimeError, "this pipeline is already being fed from another thread");
+    Py_DECREF(values);
+    return NULL;
+  }
+  self->busy = true;
+  if (!self->fed)
+    settle_engines(self, PyArray_Check(values)? PyArray_TYPE((PyArrayObject*)values) : NPY_NOTYPE);
+  self->fed = true;
+  if (!keeps_to_counted_domain(self, values)) {
+    self->busy = false;
+    Py_DECREF(values);
+    return NULL;
+  }
+  bool scalar = PyFloat_Check(values) || PyLong_Check(values);
+  PyObject* result;
+  if (options.compact)
+    result = pipeline_feed_compact(self, values, self->timed? args[1] : NULL, &options);
+  else if (options.return_indices) {
+    PyErr_SetString(PyExc_ValueError, "`return_indices` goes along with `compact=True`");
+    result = NULL;
+  } else if (self->timed)
+    result = pipeline_feed_timed(self, values, args[1], &options);
+  else if (self->n_channels > 0)
+    result = pipeline_feed_bank(self, values, &options);
+  else if (options.lazy)
+    result = pipeline_feed_lazily(self, values, &options);
+  else if (!scalar && !PyArray_Check(values))
+    result = pipeline_feed_iterable(self, values, &options);
+  else if ((options.n_threads > 1) && PyArray_Check(values) && (PyArray_NDIM((PyArrayObject*)values) == 1)
+      && ((options.output_type == NPY_DOUBLE) || (!options.inplace && (options.out == NULL)))) // the chunks only write doubles
+    result = pipeline_feed_chunked(self, values, &options);
+  else if (self->n_columns > 0)
+    result = pipeline_feed_several(self, values, &options);
+  else
+    result = pipeline_feed_lone(self, values, &options);
+  self->busy = false;
+  Py_DECREF(values);
+  return result;
+}
+
+/*
+  Out-of-core filtering of a flat binary file of any native type, like the ones `np.ndarray.tofile`
+  writes or `np.memmap` maps, into another. Both go by in chunks of large sequential reads and
+  writes, so resident memory stays bounded by the chunk however long the file, and the state
+  carries across chunks just as it would across repeated calls to `feed`. Outputs are float32
+  for float32 inputs, and float64 otherwise. The destination is overwritten, so it may not be
+  the source, which is refused wherever the file system lets us tell. Trailing bytes that fall short of a whole entry are ignored.
+ */
+#define DEFAULT_FILE_CHUNK (1 << 20) // entries per read, so 8MB of doubles
+
+static bool seek_in_file(FILE* file, long long offset) {
+#ifdef _WIN32
+  return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+  return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// by device and inode, which Windows leaves at zero, so that it tells nothing there
+static bool is_same_file(FILE* source, const char* destination_path) {
+  struct stat read_from, written_to;
+  if ((fstat(fileno(source), &read_from) != 0) || (stat(destination_path, &written_to) != 0))
+    return false; // a destination that doesn't exist yet, for one
+  return (read_from.st_ino != 0) && (read_from.st_dev == written_to.st_dev) && (read_from.st_ino == written_to.st_ino);
+}
+
+static PyObject* pipeline_feed_file(struct pipeline* self, PyObject* args, PyObject* kwds) {
+  static char* keyword_list[] = {"source", "destination", "dtype", "offset", "chunk", NULL};
+  PyObject* source_path = NULL;
+  PyObject* destination_path = NULL;
+  PyArray_Descr* descriptor = NULL;
+  long long offset = 0;
+  Py_ssize_t chunk = DEFAULT_FILE_CHUNK;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&|$O&Ln", keyword_list,
+      PyUnicode_FSConverter, &source_path, PyUnicode_FSConverter, &destination_path,
+      PyArray_DescrConverter2, &descriptor, &offset, &chunk)) {
+    Py_XDECREF(source_path);
+    Py_XDECREF(destination_path);
+    return NULL;
+  }
+  int input_type = (descriptor != NULL)? descriptor->type_num : NPY_DOUBLE;
+  bool native_order = (descriptor == NULL) || PyArray_ISNBO(descriptor->byteorder);
+  Py_XDECREF(descriptor);
+  int output_type = (input_type == NPY_FLOAT)? NPY_FLOAT : NPY_DOUBLE;
+  series_feeder feeder = find_series_feeder(input_type, output_type);
+  PyObject* result = NULL;
+  FILE* source = NULL;
+  FILE* destination = NULL;
+  if ((self->n_channels > 0) || self->timed) {
+    PyErr_SetString(PyExc_TypeError, "only lone pipelines over counts of samples may be fed from files");
+    goto cleanup;
+  }
+  if ((feeder == NULL) || !native_order) {
+    PyErr_SetString(PyExc_ValueError, "files must hold a native integer or floating type in native byte order");
+    goto cleanup;
+  }
+  if ((chunk <= 0) || (offset < 0)) {
+    PyErr_SetString(PyExc_ValueError, "the `chunk` must be positive and the `offset` must not be negative");
+    goto cleanup;
+  }
+  if (self->busy) {
+    PyErr_SetString(PyExc_RuntimeError, "this pipeline is already being fed from another thread");
+    goto cleanup;
+  }
+  if (self->counting && !counts_within_domain(self, input_type)) {
+    refuse_outside_counted_domain(self);
+    goto cleanup;
+  }
+  source = fopen(PyBytes_AS_STRING(source_path), "rb");
+  if (source == NULL) {
+    PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, source_path);
+    goto cleanup;
+  }
+  if (!seek_in_file(source, offset)) {
+    PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, source_path);
+    goto cleanup;
+  }
+  if (is_same_file(source, PyBytes_AS_STRING(destination_path))) {
+    PyErr_SetString(PyExc_ValueError, "the destination would overwrite the source before it is read");
+    goto cleanup;
+  }
+  destination = fopen(PyBytes_AS_STRING(destination_path), "wb");
+  if (destination == NULL) {
+    PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, destination_path);
+    goto cleanup;
+  }
+  setvbuf(source, NULL, _IONBF, 0); // our chunks are large enough already, and this skips a copy
+  setvbuf(destination, NULL, _IONBF, 0);
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fileno(source), (off_t)offset, 0, POSIX_FADV_SEQUENTIAL); // a hint, so whatever it says goes
+#endif
+  if (!self->fed)
+    settle_engines(self, input_type);
+  self->fed = true;
+  self->busy = true;
+  size_t input_size = measure_native_type(input_type);
+  size_t output_size = (size_t)self->filters->width * ((output_type == NPY_FLOAT)? sizeof(npy_float) : sizeof(npy_double));
+  long long n_fed = 0;
+  bool read_failed = false, write_failed = false;
+  void* input = NULL;
+  void* output = NULL;
+  Py_BEGIN_ALLOW_THREADS
+  input = malloc((size_t)chunk * input_size);
+  output = malloc((size_t)chunk * output_size);
+  if ((input != NULL) && (output != NULL)) {
+    for (;;) {
+      size_t n_entries = fread(input, input_size, (size_t)chunk, source);
+      if (n_entries == 0)
+        break;
+      feeder(self->filters, input, output, (npy_intp)n_entries);
+      n_fed += (long long)n_entries;
+      if (fwrite(output, output_size, n_entries, destination) != n_entries) {
+        write_failed = true;
+        break;
+      }
+    }
+    read_failed = (ferror(source) != 0);
+  }
+  free(input);
+  free(output);
+  Py_END_ALLOW_THREADS
+  self->busy = false;
+  if ((input == NULL) || (output == NULL))
+    PyErr_NoMemory();
+  else if (read_failed)
+    PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, source_path);
+  else if (write_failed || (fflush(destination) != 0))
+    PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, destination_path);
+  else
+    result = PyLong_FromLongLong(n_fed);
+cleanup:
+  if (source != NULL)
+    fclose(source);
+  if ((destination != NULL) && (fclose(destination) != 0) && (result != NULL)) {
+    Py_CLEAR(result);
+    PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, destination_path);
+  }
+  Py_DECREF(source_path);
+  Py_DECREF(destination_path);
+  return result;
+}
+
+/*
+  Snapshots hold the descriptions and the complete state of every stage, heaps and all, so that
+  a restored pipeline carries on exactly where the original left off without replaying anything.
+  See `save_filter_pipelines`. Like pickles, they should only be restored from trusted sources.
+ */
+static PyObject* pipeline_to_bytes(struct pipeline* self, PyObject* unused) {
+  if (self->filters == NULL) {
+    PyErr_SetString(PyExc_RuntimeError, "this pipeline was never initialized");
+    return NULL;
+  }
+  if (self->busy) {
+    PyErr_SetString(PyExc_RuntimeError, "this pipeline is being fed from another thread");
+    return NULL;
+  }
+  size_t length = save_filter_pipelines(self->channels, self->n_channels, NULL);
+  PyObject* snapshot = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)length);
+  if (snapshot == NULL)
+    return NULL;
+  unsigned char* buffer = (unsigned char*)PyBytes_AS_STRING(snapshot);
+  self->busy = true;
+  Py_BEGIN_ALLOW_THREADS
+  save_filter_pipelines(self->channels, self->n_channels, buffer);
+  Py_END_ALLOW_THREADS
+  self->busy = false;
+  return snapshot;
+}
+
+static PyObject* pipeline_set_state(struct pipeline* self, PyObject* state) {
+  if (self->busy) {
+    PyErr_SetString(PyExc_RuntimeError, "this pipeline is being fed from another thread");
+    return NULL;
+  }
+  Py_buffer view;
+  if (PyObject_GetBuffer(state, &view, PyBUF_SIMPLE) < 0)
+    return NULL;
+  unsigned n_channels;
+  struct filter_pipeline** channels;
+  Py_BEGIN_ALLOW_THREADS
+  channels = restore_filter_pipelines((const unsigned char*)view.buf, (size_t)view.len, &n_channels);
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release(&view);
+  if (channels == NULL) {
+    PyErr_SetString(PyExc_ValueError, "not a snapshot of a pipeline, or one from another version of this library");
+    return NULL;
+  }
+  release_pipeline_state(self);
+  self->channels = channels;
+  self->filters = channels[0];
+  self->n_channels = n_channels;
+  unsigned n_states = (n_channels > 0)? n_channels : 1;
+  self->n_threads = count_available_cores(); // of whichever machine it landed on
+  if (self->n_threads > n_states)
+    self->n_threads = n_states;
+  self->fed = true; // its engines were settled one way or another already
+  summarize_pipeline(self);
+  recall_counted_domain(self);
+  Py_RETURN_NONE;
+}
+
+static PyObject* pipeline_from_bytes(PyTypeObject* type, PyObject* state) {
+  PyObject* self = type->tp_new(type, NULL, NULL);
+  if (self == NULL)
+    return NULL;
+  PyObject* result = pipeline_set_state((struct pipeline*)self, state);
+  if (result == NULL) {
+    Py_DECREF(self);
+    return NULL;
+  }
+  Py_DECREF(result);
+  return self;
+}
+
+/*
+  A worker streams entries through a pipeline on a native thread of its own, between two
+  lock-free rings (see stream.h), so that a real-time producer pays no more than a copy per
+  `push` and never waits on the filter. The pipeline counts as busy for as long as the worker is
+  open, and is handed back on `close`, having taken in every entry that was pushed.
+ */
+struct worker {
+  PyObject_HEAD
+  struct pipeline* owner;
+  struct filter_stream* stream; // NULL once closed
+};
+
+static void close_worker_stream(struct worker* self) {
+  if (self->stream == NULL)
+    return;
+  struct filter_stream* stream = self->stream;
+  self->stream = NULL;
+  Py_BEGIN_ALLOW_THREADS
+  close_filter_stream(stream); // waits for the backlog to go through
+  Py_END_ALLOW_THREADS
+  self->owner->busy = false;
+}
+
+static void worker_dealloc(struct worker* self) {
+  close_worker_stream(self);
+  Py_XDECREF(self->owner);
+  Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static bool check_worker_open(struct worker* self) {
+  if (self->stream == NULL)
+    PyErr_SetString(PyExc_ValueError, "this worker has been closed");
+  return self->stream != NULL;
+}
+
+static PyObject* worker_push(struct worker* self, PyObject* const* args, Py_ssize_t n_args) { // fastcall, like `feed`
+  if ((n_args < 1) || (n_args > 2)) {
+    PyErr_SetString(PyExc_TypeError, "worker.push(*) accepts values, and timestamps if the pipeline spans time");
+    return NULL;
+  }
+  if (!check_worker_open(self))
+    return NULL;
+  PyObject* values = args[0];
+  if (!keeps_to_counted_domain(self->owner, values))
+    return NULL;
+  PyObject* timestamps = (n_args == 2)? args[1] : NULL;
+  if ((timestamps != NULL) != self->owner->timed) {
+    PyErr_SetString(PyExc_TypeError, self->owner->timed?
+      "this pipeline spans time, so please pass timestamps alongside the values" :
+      "timestamps only apply to pipelines with a `duration`");
+    return NULL;
+  }
+  if (PyFloat_Check(values) || PyLong_Check(values)) { // one sample at a time is the common case, and arrays would cost more than the push
+    double value = PyFloat_AsDouble(values);
+    double timestamp = (timestamps != NULL)? PyFloat_AsDouble(timestamps) : 0.0;
+    if (PyErr_Occurred())
+      return NULL;
+    return PyLong_FromSize_t(push_filter_stream(self->stream, &value, &timestamp, 1));
+  }
+  PyArrayObject* array = (PyArrayObject*)PyArray_FROM_OTF(values, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+  if (array == NULL)
+    return NULL;
+  PyArrayObject* times = NULL;
+  if (timestamps != NULL) {
+    times = (PyArrayObject*)PyArray_FROM_OTF(timestamps, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+    if ((times != NULL) && (PyArray_SIZE(times) != PyArray_SIZE(array))) {
+      Py_CLEAR(times);
+      PyErr_SetString(PyExc_ValueError, "the timestamps and the values must be of the same length");
+    }
+    if (times == NULL) {
+      Py_DECREF(array);
+      return NULL;
+    }
+  }
+  size_t n_taken = push_filter_stream(self->stream, PyArray_DATA(array),
+    (times != NULL)? PyArray_DATA(times) : NULL, (size_t)PyArray_SIZE(array));
+  Py_DECREF(array);
+  Py_XDECREF(times);
+  return PyLong_FromSize_t(n_taken);
+}
+
+static PyObject* worker_poll(struct worker* self, PyObject* args, PyObject* kwds) {
+  static char* keyword_list[] = {"max_entries", "wait", NULL};
+  Py_ssize_t max_entries = -1;
+  int wait = false;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n$p", keyword_list, &max_entries, &wait) || !check_worker_open(self))
+    return NULL;
+  struct filter_stream* stream = self->stream;
+  npy_intp dims[2] = {(max_entries >= 0)? (npy_intp)max_entries : (npy_intp)(stream->outputs.mask + 1), stream->outputs.width};
+  if (wait && (max_entries < 0)) { // everything outstanding, however much that is beyond the ring
+    unsigned long long n_outstanding = atomic_load(&stream->n_pushed) - atomic_load(&stream->n_polled);
+    dims[0] = (n_outstanding > (unsigned long long)dims[0])? (npy_intp)n_outstanding : dims[0];
+  }
+  PyArrayObject* output_array = (PyArrayObject*)PyArray_SimpleNew((self->owner->n_columns > 0)? 2 : 1, dims, NPY_DOUBLE);
+  if (output_array == NULL)
+    return NULL;
+  size_t n_polled;
+  double* outputs = PyArray_DATA(output_array);
+  Py_BEGIN_ALLOW_THREADS // a waiting poll leaves the producer free to keep pushing from another thread
+  n_polled = poll_filter_stream(stream, outputs, (size_t)dims[0], wait);
+  Py_END_ALLOW_THREADS
+  if (((npy_intp)n_polled < dims[0]) && !resize_output(output_array, (npy_intp)n_polled)) {
+    Py_DECREF(output_array);
+    return NULL;
+  }
+  return (PyObject*)output_array;
+}
+
+static PyObject* worker_close(struct worker* self, PyObject* unused) {
+  close_worker_stream(self);
+  Py_RETURN_NONE;
+}
+
+static PyObject* worker_enter(struct worker* self, PyObject* unused) {
+  Py_INCREF(self);
+  return (PyObject*)self;
+}
+
+static PyObject* worker_exit(struct worker* self, PyObject* args) {
+  close_worker_stream(self);
+  Py_RETURN_FALSE;
+}
+
+static PyObject* worker_get_stats(struct worker* self, void* closure) {
+  if (!check_worker_open(self))
+    return NULL;
+  struct stream_statistics statistics;
+  describe_filter_stream(self->stream, &statistics);
+  return Py_BuildValue("{sKsKsKsKsKsn}", "pushed", statistics.n_pushed, "turned_away", statistics.n_turned_away,
+    "filtered", statistics.n_filtered, "polled", statistics.n_polled, "stalls", statistics.n_stalls,
+    "peak_backlog", (Py_ssize_t)statistics.peak_backlog);
+}
+
+static struct PyMethodDef worker_methods[] = {
+  {"push", (PyCFunction)(void(*)(void))worker_push, METH_FASTCALL,
+    "Push a value or a series of them, with timestamps as the second argument if the pipeline spans time, onto the input ring. "
+    "Never waits. Returns how many were taken, which falls short when the ring is full."},
+  {"poll", (PyCFunction)(void(*)(void))worker_poll, METH_VARARGS|METH_KEYWORDS,
+    "Take whatever outputs are ready, up to `max_entries` (a ringful by default,) one per entry pushed as with `feed`. "
+    "With `wait=True`, first waits for everything pushed so far to go through, which `max_entries` then need not bound."},
+  {"close", (PyCFunction)worker_close, METH_NOARGS,
+    "Stop the worker once it has taken in everything pushed, and hand the pipeline back. Unpolled outputs are dropped."},
+  {"__enter__", (PyCFunction)worker_enter, METH_NOARGS, NULL},
+  {"__exit__", (PyCFunction)worker_exit, METH_VARARGS, NULL},
+  {NULL, NULL, 0, NULL} // sentinel
+};
+
+static PyGetSetDef worker_getset[] = {
+  {
+    "stats", (getter)worker_get_stats, NULL,
+    "how many entries were pushed, turned away from a full input ring, filtered, and polled, how many times the "
+    "worker stalled on a full output ring, and the deepest the input ring has been. for sizing `capacity`",
+    NULL
+  }, {NULL}
+};
+
+static PyTypeObject worker_type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "rolling_quantiles.triton.Worker",
+  .tp_doc = "A pipeline streaming on a native thread of its own, between lock-free rings.",
+  .tp_basicsize = sizeof(struct worker),
+  .tp_itemsize = 0,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_methods = worker_methods,
+  .tp_getset = worker_getset,
+  .tp_dealloc = (destructor)worker_dealloc,
+};
+
+#define DEFAULT_WORKER_CAPACITY 4096 // entries on either ring
+
+static PyObject* pipeline_start_worker(struct pipeline* self, PyObject* args, PyObject* kwds) {
+  static char* keyword_list[] = {"capacity", NULL};
+  Py_ssize_t capacity = DEFAULT_WORKER_CAPACITY;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|$n", keyword_list, &capacity))
+    return NULL;
+  if (capacity < 1) {
+    PyErr_SetString(PyExc_ValueError, "please pass a positive `capacity`");
+    return NULL;
+  }
+  if (self->n_channels > 0) {
+    PyErr_SetString(PyExc_ValueError, "workers are only for lone pipelines");
+    return NULL;
+  }
+  if (self->busy) {
+    PyErr_SetString(PyExc_RuntimeError, "this pipeline is already being fed from another thread");
+    return NULL;
+  }
+  struct worker* worker = PyObject_New(struct worker, &worker_type);
+  if (worker == NULL)
+    return NULL;
+  worker->stream = open_filter_stream(self->filters, (size_t)capacity);
+  Py_INCREF(self);
+  worker->owner = self;
+  if (worker->stream == NULL) {
+    Py_DECREF(worker);
+    return PyErr_NoMemory();
+  }
+  self->busy = true;
+  self->fed = true;
+  return (PyObject*)worker;
+}
+
+static PyObject* pipeline_reset(struct pipeline* self, PyObject* unused) {
+  if (self->busy) {
+    PyErr_SetString(PyExc_RuntimeError, "this pipeline is being fed from another thread");
+    return NULL;
+  }
+  unsigned n_states = (self->n_channels > 0)? self->n_channels : 1;
+  for (unsigned c = 0; c < n_states; c += 1)
+    reset_filter_pipeline(self->channels[c]);
+  Py_RETURN_NONE;
+}
+
+static PyObject* pipeline_clone(struct pipeline* self, PyObject* unused) {
+  if (self->busy) {
+    PyErr_SetString(PyExc_RuntimeError, "this pipeline is being fed from another thread");
+    return NULL;
+  }
+  struct pipeline* clone = (struct pipeline*)Py_TYPE(self)->tp_new(Py_TYPE(self), NULL, NULL);
+  if (clone == NULL)
+    return NULL;
+  unsigned n_states = (self->n_channels > 0)? self->n_channels : 1;
+  clone->channels = malloc(n_states * sizeof(struct filter_pipeline*));
+  bool cloned;
+  self->busy = true;
+  Py_BEGIN_ALLOW_THREADS
+  cloned = clone_filter_pipelines(self->channels, n_states, clone->channels);
+  Py_END_ALLOW_THREADS
+  self->busy = false;
+  if (!cloned) {
+    free(clone->channels);
+    clone->channels = NULL;
+    Py_DECREF(clone);
+    return PyErr_NoMemory();
+  }
+  clone->filters = clone->channels[0];
+  clone->n_channels = self->n_channels;
+  clone->n_threads = self->n_threads;
+  clone->fed = self->fed;
+  summarize_pipeline(clone);
+  recall_counted_domain(clone);
+  return (PyObject*)clone;
+}
+
+static struct PyMethodDef pipeline_methods[] = {
+  {"feed", (PyCFunction)(void(*)(void))pipeline_feed, METH_FASTCALL|METH_KEYWORDS, // not truly a PyCFunction, due to METH_FASTCALL ...?
+    "Feed a value, or a series thereof (array, buffer, list, generator,) into the filter pipeline. "
+    "Iterables are pulled in chunks, and come back as an array, or as an iterator that goes along lazily if `lazy=True`. "
+    "A bank of channels takes a 2D array whose time runs along `axis` (the last by default.) "
+    "Arrays may be filtered into a preallocated float64 or float32 buffer `out`, or `inplace`. "
+    "Pipelines that span time take a matching series of `timestamps` as the second argument. "
+    "A lone pipeline splits a long array into chunks over `threads`, with identical outputs. "
+    "Outputs are float32 for float32 inputs, or as `dtype` says. "
+    "With `compact=True`, only the entries that yield outputs through the subsampling are reported, back to back, "
+    "along with their positions in the input if `return_indices=True`."},
+  {"feed_file", (PyCFunction)(void(*)(void))pipeline_feed_file, METH_VARARGS|METH_KEYWORDS,
+    "Filter a flat binary file of `dtype` (float64 by default,) starting `offset` bytes in, into a `destination` file "
+    "`chunk` entries at a time, with the state carrying across as in repeated calls to `feed`. Returns how many entries went through."},
+  {"start_worker", (PyCFunction)(void(*)(void))pipeline_start_worker, METH_VARARGS|METH_KEYWORDS,
+    "Hand the pipeline over to a worker thread that filters whatever is pushed onto a ring of `capacity` entries, "
+    "and returns a `Worker` to push and poll. The pipeline is busy until the worker is closed."},
+  {"reset", (PyCFunction)pipeline_reset, METH_NOARGS,
+    "Empty every window, buffer, and subsampling clock in place, as if freshly constructed, without reallocating anything."},
+  {"clone", (PyCFunction)pipeline_clone, METH_NOARGS,
+    "An independent copy of the pipeline along with its current state, which carries on just as the original would."},
+  {"to_bytes", (PyCFunction)pipeline_to_bytes, METH_NOARGS,
+    "A versioned binary snapshot of the pipeline's descriptions and complete state, channels and all."},
+  {"from_bytes", (PyCFunction)pipeline_from_bytes, METH_O | METH_CLASS,
+    "Restore a pipeline from a snapshot made by `to_bytes`, which carries on right where the original left off."},
+  {"__getstate__", (PyCFunction)pipeline_to_bytes, METH_NOARGS, "For pickling. Same as `to_bytes`."},
+  {"__setstate__", (PyCFunction)pipeline_set_state, METH_O, "For unpickling. Takes over the state of a snapshot."},
+  {NULL, NULL, 0, NULL} // sentinel
+};
+
+static PyObject* describe_operation_counters(struct operation_counters* counters) {
+  PyObject* dict = PyDict_New();
+  if (dict == NULL)
+    return NULL;
+#define ADD_COUNTER_TO_DICT(name) \
+  { \
+    PyObject* count = PyLong_FromUnsignedLongLong(counters->name); \
+    if ((count == NULL) || (PyDict_SetItemString(dict, #name, count) < 0)) { \
+      Py_XDECREF(count); \
+      Py_DECREF(dict); \
+      return NULL; \
+    } \
+    Py_DECREF(count); \
+  }
+  OPERATION_COUNTERS(ADD_COUNTER_TO_DICT)
+#undef ADD_COUNTER_TO_DICT
+  return dict;
+}
+
+static PyObject* pipeline_get_stats(struct pipeline* self, void* closure) {
+  if (!COUNTERS_ENABLED)
+    Py_RETURN_NONE; // compiled without ROLLING_QUANTILES_COUNTERS
+  unsigned n_filters = self->channels[0]->n_filters;
+  unsigned n_states = (self->n_channels > 0)? self->n_channels : 1;
+  PyObject* stages = PyList_New(n_filters);
+  if (stages == NULL)
+    return NULL;
+  for (unsigned i = 0; i < n_filters; i += 1) {
+    struct operation_counters sums = {0};
+    for (unsigned c = 0; c < n_states; c += 1) // summed over a bank's channels
+      tally_stage_operations(self->channels[c]->filters + i, &sums);
+    PyObject* stage = describe_operation_counters(&sums);
+    if (stage == NULL) {
+      Py_DECREF(stages);
+      return NULL;
+    }
+    PyList_SET_ITEM(stages, i, stage);
+  }
+  return stages;
+}
+
+static PyObject* pipeline_get_phase(struct pipeline* self, void* closure) {
+  return PyLong_FromUnsignedLong(locate_pipeline_phase(self->filters));
+}
+
+static PyGetSetDef pipeline_getset[] = {
+  {
+    "phase", (getter)pipeline_get_phase, NULL,
+    "how many entries have gone in since the last stage last yielded an output, modulo the stride",
+    NULL
+  }, {
+    "stats", (getter)pipeline_get_stats, NULL,
+    "per stage, a dict of how many sifts, swaps, rebalances, expiries, and resets its updates have taken, "
+    "or None unless built with ROLLING_QUANTILES_COUNTERS. summed over a bank's channels, and over the warm-ups of a threaded `feed`",
+    NULL
+  }, {NULL}
 };
 
 static PyTypeObject pipeline_type = {
   PyVarObject_HEAD_INIT(NULL, 0)
-  .tp_name = "triton.Pipeline",
+  .tp_name = "rolling_quantiles.triton.Pipeline",
   .tp_doc = "A filter pipeline.",
   .tp_basicsize = sizeof(struct pipeline),
   .tp_itemsize = 0, // for variably sized objects
   .tp_flags = Py_TPFLAGS_DEFAULT,
   .tp_methods = pipeline_methods,
   .tp_members = pipeline_members,
+  .tp_getset = pipeline_getset,
   .tp_init = (initproc)pipeline_init,
   .tp_new = pipeline_new,
-  .tp_del = (destructor)pipeline_dealloc,
+  .tp_dealloc = (destructor)pipeline_dealloc,
   .tp_repr = (reprfunc)pipeline_repr,
 };
 
 bool init_pipeline(PyObject* self) {
-  if (PyType_Ready(&pipeline_type) < 0)
+  if ((PyType_Ready(&pipeline_type) < 0) || (PyType_Ready(&pipeline_stream_type) < 0) || (PyType_Ready(&worker_type) < 0))
     return false;
   Py_INCREF(&pipeline_type);
   if (PyModule_AddObject(self, "Pipeline", (PyObject*) &pipeline_type) < 0) {
@@ -393,7 +2340,7 @@ PyMODINIT_FUNC PyInit_triton(void) {
   PyObject* self =  PyModule_Create(&module);
   import_array();
   static bool (*type_initializers[])(PyObject*) = { // array of function pointers
-    init_description, init_high_pass, init_low_pass, init_pipeline, NULL
+    init_description, init_high_pass, init_low_pass, init_approx_high_pass, init_approx_low_pass, init_hampel, init_pipeline, NULL
   };
   bool (**init)(PyObject*) = &type_initializers[0];
   while (*init != NULL) {
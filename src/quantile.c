@@ -22,30 +22,140 @@
 #include <stdbool.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 const struct interpolation NO_INTERPOLATION = { .target_quantile = NAN };
 
 struct rolling_quantile create_rolling_quantile_monitor(unsigned window, unsigned portion, struct interpolation interp) {
+  return create_rolling_quantile_monitor_with_engine(window, portion, interp, HEAP_ENGINE, 2);
+}
+
+enum quantile_engine choose_quantile_engine(unsigned window) {
+  return (window <= SORTED_ENGINE_THRESHOLD)? SORTED_ENGINE : HEAP_ENGINE;
+}
+
+static struct ranked_window create_ranked_window(struct arena* arena, unsigned window, enum quantile_engine engine) {
+  struct ranked_window ranked = {
+    .entries = allocate_within(arena, window * sizeof(double)),
+    .head = 0,
+    .n_entries = 0,
+    .tick = 0,
+    .tree = (engine == TREE_ENGINE)? create_order_tree(window) : NULL, // which grows as it goes
+    .sorted = (engine == SORTED_ENGINE)? allocate_within(arena, window * sizeof(double)) : NULL,
+    .histogram = NULL,
+  };
+  for (unsigned i = 0; i < window; i += 1)
+    ranked.entries[i] = NAN;
+  return ranked;
+}
+
+size_t measure_rolling_quantile_monitor(unsigned window, unsigned portion, enum quantile_engine engine) { // the heaps take the same room whatever their arity
+  if ((engine == AUTOMATIC_ENGINE) || (engine == COUNTING_ENGINE))
+    engine = choose_quantile_engine(window);
+  size_t entries_size = align_to_cache_line(window * sizeof(double));
+  if (engine == TREE_ENGINE)
+    return entries_size;
+  if (engine == SORTED_ENGINE)
+    return 2 * entries_size;
+  return measure_queue(window) + measure_heap(portion + 1) + measure_heap(window - portion);
+}
+
+size_t measure_rolling_quantile_monitor_over_domain(unsigned window, double lowest, double highest) {
+  return align_to_cache_line(window * sizeof(double)) + measure_counting_histogram(lowest, highest);
+}
+
+struct rolling_quantile create_rolling_quantile_monitor_with_engine(unsigned window, unsigned portion, struct interpolation interp, enum quantile_engine engine, unsigned arity) {
+  return create_rolling_quantile_monitor_within(NULL, window, portion, interp, engine, arity);
+}
+
+struct rolling_quantile create_rolling_quantile_monitor_within(struct arena* arena, unsigned window, unsigned portion, struct interpolation interp, enum quantile_engine engine, unsigned arity) {
   //if (window % 2 == 0) this only makes sense for the median special case.
   //  return NULL;
-  struct ring_buffer* queue = create_queue(window);
+  if ((engine == AUTOMATIC_ENGINE) || (engine == COUNTING_ENGINE)) // the latter needs a domain, which `..._over_domain` takes
+    engine = choose_quantile_engine(window);
+  struct rolling_quantile monitor = {
+    .current_value = (struct heap_element) {.member = NAN, .slot = NO_SLOT}, // to keep track of queue position
+    .window = window,
+    .portion = portion,
+    .count = 0,
+    .interpolation = interp,
+    .engine = engine,
+  };
+  if ((engine == TREE_ENGINE) || (engine == SORTED_ENGINE)) {
+    monitor.ranked = create_ranked_window(arena, window, engine);
+    return monitor;
+  }
+  struct ring_buffer* queue = create_queue_within(arena, window);
+  monitor.queue = queue;
+  if (!is_valid_heap_arity(arity))
+    arity = 2;
+  monitor.left_heap = create_d_ary_heap_within(arena, MAX_HEAP, arity, portion + 1, queue);
+  monitor.right_heap = create_d_ary_heap_within(arena, MIN_HEAP, arity, window - portion, queue); // - 1 and then + 1
+  return monitor;
+}
+
+struct rolling_quantile create_rolling_quantile_monitor_over_domain(unsigned window, unsigned portion, struct interpolation interp, double lowest, double highest) {
+  return create_rolling_quantile_monitor_over_domain_within(NULL, window, portion, interp, lowest, highest);
+}
+
+struct rolling_quantile create_rolling_quantile_monitor_over_domain_within(struct arena* arena, unsigned window, unsigned portion, struct interpolation interp, double lowest, double highest) {
   struct rolling_quantile monitor = {
-    .queue = queue,
-    .left_heap = create_heap(MAX_HEAP, portion + 1, queue),
-    .right_heap = create_heap(MIN_HEAP, window - portion, queue), // - 1 and then + 1
-    .current_value = (struct heap_element) {.member = NAN, .loc_in_buffer = NULL}, // to keep track of queue position
+    .current_value = (struct heap_element) {.member = NAN, .slot = NO_SLOT},
     .window = window,
     .portion = portion,
     .count = 0,
     .interpolation = interp,
+    .engine = COUNTING_ENGINE,
+    .ranked = create_ranked_window(arena, window, COUNTING_ENGINE),
   };
+  monitor.ranked.histogram = create_counting_histogram_within(arena, lowest, highest);
   return monitor;
 }
 
+void reset_rolling_quantile(struct rolling_quantile* monitor) {
+  monitor->current_value = (struct heap_element) {.member = NAN, .slot = NO_SLOT};
+  monitor->count = 0;
+  monitor->counters = (struct operation_counters) {0};
+  if (monitor->engine == HEAP_ENGINE) {
+    clear_queue(monitor->queue);
+    clear_heap(monitor->left_heap);
+    clear_heap(monitor->right_heap);
+    return;
+  }
+  struct ranked_window* ranked = &monitor->ranked;
+  for (unsigned i = 0; i < monitor->window; i += 1)
+    ranked->entries[i] = NAN;
+  ranked->head = 0;
+  ranked->n_entries = 0;
+  ranked->tick = 0;
+  if (ranked->tree != NULL)
+    clear_order_tree(ranked->tree);
+  if (ranked->histogram != NULL)
+    clear_counting_histogram(ranked->histogram);
+}
+
 void destroy_rolling_quantile_monitor(struct rolling_quantile* monitor) {
-  destroy_heap(monitor->left_heap);
-  destroy_heap(monitor->right_heap);
-  destroy_queue(monitor->queue);
+  destroy_rolling_quantile_monitor_within(NULL, monitor);
+}
+
+void destroy_rolling_quantile_monitor_within(struct arena* arena, struct rolling_quantile* monitor) {
+  if (monitor->engine != HEAP_ENGINE) {
+    if (monitor->ranked.tree != NULL)
+      destroy_order_tree(monitor->ranked.tree);
+    if (monitor->ranked.histogram != NULL)
+      destroy_counting_histogram_within(arena, monitor->ranked.histogram);
+    if (monitor->ranked.sorted != NULL)
+      release_within(arena, monitor->ranked.sorted);
+    release_within(arena, monitor->ranked.entries);
+    return;
+  }
+  release_within(arena, monitor->left_heap);
+  release_within(arena, monitor->right_heap);
+  release_within(arena, monitor->queue);
 }
 
 static bool is_between_zero_and_one(double val) { // null and unit
@@ -66,25 +176,341 @@ double compute_interpolation_target(unsigned window, struct interpolation interp
   return real_portion + correction;
 }
 
-static double interpolate_current_rolling_quantile(struct rolling_quantile* monitor) {
-  struct interpolation interp = monitor->interpolation; // is copy worth the locality?
-  double target = compute_interpolation_target(monitor->window, interp);
+double interpolate_between_neighbors(double previous, double current, double next,
+    unsigned window, unsigned portion, struct interpolation interp) { // absent neighbors come in as NaN
+  double target = compute_interpolation_target(window, interp);
   double gamma = target - floor(target); // must be between 0 and 1, but avoid checking for the sake of performance
   int index = (int)floor(target) - 1; // subtract one because `portion` refers to the number of items in the left heap (but `target_portion` does *not*)
-  int portion = (int)monitor->portion;
-  double current = monitor->current_value.member;
-  if (index == portion) {
-    if (monitor->right_heap->n_entries == 0)
+  if (index == (int)portion) {
+    if (isnan(next))
       return current;
-    double next = view_front_of_heap(monitor->right_heap);
     return (1.0-gamma)*current + gamma*next;
-  } else if (index == (portion-1)) {
-    if (monitor->left_heap->n_entries == 0)
+  } else if (index == ((int)portion-1)) {
+    if (isnan(previous))
       return current;
-    double previous = view_front_of_heap(monitor->left_heap);
     return (1.0-gamma)*previous + gamma*current;
   }
-  return NAN; // monitor.portion is uncalibrated/corrupted
+  return NAN; // portion is uncalibrated/corrupted
+}
+
+static double interpolate_current_rolling_quantile(struct rolling_quantile* monitor) {
+  double previous = view_front_of_heap(monitor->left_heap); // NaN when empty, as heaps never hold NaNs
+  double next = view_front_of_heap(monitor->right_heap);
+  return interpolate_between_neighbors(previous, monitor->current_value.member, next,
+    monitor->window, monitor->portion, monitor->interpolation);
+}
+
+unsigned rank_within_window(unsigned portion, unsigned window, unsigned n_entries) { // requires a nonempty window
+  unsigned long long rank = ((unsigned long long)portion * n_entries) / window; // the same gradual buildup as the heaps'
+  return (rank < n_entries)? (unsigned)rank : (n_entries - 1);
+}
+
+/*
+  Positions in the sorted array come from branchless tallies rather than binary searches,
+  which would mispredict half their steps on noisy signals. Both the stale entry and the
+  newcomer are tallied in one sweep, two lanes at a time where SSE2 is around.
+ */
+static void count_entries_below(const double* sorted, unsigned n_entries,
+    double first_value, double second_value, unsigned* first_count, unsigned* second_count) {
+  unsigned i = 0;
+  unsigned long long first = 0, second = 0;
+#ifdef __SSE2__
+  __m128d first_threshold = _mm_set1_pd(first_value);
+  __m128d second_threshold = _mm_set1_pd(second_value);
+  __m128i first_tallies = _mm_setzero_si128(), second_tallies = _mm_setzero_si128();
+  for (; (i + 2) <= n_entries; i += 2) {
+    __m128d entries = _mm_loadu_pd(sorted + i);
+    // a true comparison comes out as all ones, which is minus one in each 64-bit lane
+    first_tallies = _mm_sub_epi64(first_tallies, _mm_castpd_si128(_mm_cmplt_pd(entries, first_threshold)));
+    second_tallies = _mm_sub_epi64(second_tallies, _mm_castpd_si128(_mm_cmplt_pd(entries, second_threshold)));
+  }
+  unsigned long long lanes[2];
+  _mm_storeu_si128((__m128i*)lanes, first_tallies);
+  first = lanes[0] + lanes[1];
+  _mm_storeu_si128((__m128i*)lanes, second_tallies);
+  second = lanes[0] + lanes[1];
+#endif
+  for (; i < n_entries; i += 1) {
+    first += (sorted[i] < first_value);
+    second += (sorted[i] < second_value);
+  }
+  *first_count = (unsigned)first;
+  *second_count = (unsigned)second;
+}
+
+// either entry may be NaN. the stale one is present whenever it is not
+static void exchange_in_sorted_window(struct ranked_window* ranked, double stale_entry, double next_entry) {
+  double* sorted = ranked->sorted;
+  unsigned n_entries = ranked->n_entries;
+  bool stale = !isnan(stale_entry), next = !isnan(next_entry);
+  if (stale && next) { // slide everything in between over by one, and drop the newcomer into the gap
+    unsigned from, to;
+    count_entries_below(sorted, n_entries, stale_entry, next_entry, &from, &to);
+    if (to <= from) {
+      memmove(sorted + to + 1, sorted + to, (from - to) * sizeof(double));
+    } else {
+      to -= 1; // the stale entry was counted below the newcomer
+      memmove(sorted + from, sorted + from + 1, (to - from) * sizeof(double));
+    }
+    sorted[to] = next_entry;
+  } else if (stale) {
+    unsigned from, unused;
+    count_entries_below(sorted, n_entries, stale_entry, stale_entry, &from, &unused);
+    memmove(sorted + from, sorted + from + 1, (n_entries - from - 1) * sizeof(double));
+    ranked->n_entries -= 1;
+  } else if (next) {
+    unsigned to, unused;
+    count_entries_below(sorted, n_entries, next_entry, next_entry, &to, &unused);
+    memmove(sorted + to + 1, sorted + to, (n_entries - to) * sizeof(double));
+    sorted[to] = next_entry;
+    ranked->n_entries += 1;
+  }
+}
+
+static void exchange_in_order_tree(struct ranked_window* ranked, unsigned window, double stale_entry, double next_entry) {
+  if (!isnan(stale_entry)) {
+    remove_from_order_tree(ranked->tree, stale_entry, ranked->tick - window); // arrived exactly one window ago
+    ranked->n_entries -= 1;
+  }
+  if (!isnan(next_entry)) {
+    insert_into_order_tree(ranked->tree, next_entry, ranked->tick);
+    ranked->n_entries += 1;
+  }
+}
+
+static void exchange_in_histogram(struct ranked_window* ranked, double stale_entry, double next_entry) {
+  if (!isnan(stale_entry)) {
+    remove_from_histogram(ranked->histogram, locate_histogram_bin(ranked->histogram, stale_entry));
+    ranked->n_entries -= 1;
+  }
+  if (!isnan(next_entry)) {
+    add_to_histogram(ranked->histogram, locate_histogram_bin(ranked->histogram, next_entry));
+    ranked->n_entries += 1;
+  }
+}
+
+static double select_from_ranked_window(struct rolling_quantile* monitor, unsigned rank) { // NaN past the end
+  struct ranked_window* ranked = &monitor->ranked;
+  if (monitor->engine == SORTED_ENGINE)
+    return (rank < ranked->n_entries)? ranked->sorted[rank] : NAN;
+  if (monitor->engine == COUNTING_ENGINE)
+    return select_from_histogram(ranked->histogram, rank);
+  return select_from_order_tree(ranked->tree, rank);
+}
+
+/*
+  Same semantics as the heaps below, but by direct selection: whatever `rebalance_rolling_quantile`
+  would settle on is simply the entry of that rank among those present.
+ */
+static double update_ranked_rolling_quantile(struct rolling_quantile* monitor, double next_entry) {
+  struct ranked_window* ranked = &monitor->ranked;
+  double stale_entry = ranked->entries[ranked->head];
+  if (monitor->engine == SORTED_ENGINE)
+    exchange_in_sorted_window(ranked, stale_entry, next_entry);
+  else if (monitor->engine == COUNTING_ENGINE)
+    exchange_in_histogram(ranked, stale_entry, next_entry);
+  else
+    exchange_in_order_tree(ranked, monitor->window, stale_entry, next_entry);
+  ranked->entries[ranked->head] = next_entry;
+  ranked->tick += 1;
+  ranked->head = (ranked->head + 1 == monitor->window)? 0 : (ranked->head + 1);
+  monitor->count += 1;
+  unsigned n_entries = ranked->n_entries;
+  if (n_entries == 0)
+    return NAN;
+  unsigned rank = rank_within_window(monitor->portion, monitor->window, n_entries);
+  double current = select_from_ranked_window(monitor, rank);
+  if (isnan(monitor->interpolation.target_quantile))
+    return current;
+  double previous = (rank > 0)? select_from_ranked_window(monitor, rank - 1) : NAN;
+  double next = select_from_ranked_window(monitor, rank + 1);
+  return interpolate_between_neighbors(previous, current, next,
+    monitor->window, monitor->portion, monitor->interpolation);
+}
+
+/*
+  The median absolute deviation about `center`, out of the very same ordered window, for Hampel
+  filters. The deviations of the entries below the center, read downward, and those of the ones
+  above it, read upward, make two ascending runs. So their order statistic of the same rank that
+  the window reports comes from a bisection over how many to take from either run, in a logarithmic
+  number of selections rather than a second window of deviations. The heaps offer no selection by
+  rank, and so give NaN.
+ */
+double find_rolling_deviation(struct rolling_quantile* monitor, double center) {
+  unsigned n_entries = monitor->ranked.n_entries;
+  if ((monitor->engine == HEAP_ENGINE) || (n_entries == 0) || isnan(center))
+    return NAN;
+  unsigned n_below = 0, n_beyond = n_entries; // bisect for how many entries lie below the center
+  while (n_below < n_beyond) {
+    unsigned middle = n_below + (n_beyond - n_below) / 2;
+    if (select_from_ranked_window(monitor, middle) < center)
+      n_below = middle + 1;
+    else
+      n_beyond = middle;
+  }
+  unsigned n_above = n_entries - n_below;
+  unsigned n_wanted = rank_within_window(monitor->portion, monitor->window, n_entries) + 1; // the smallest deviations, up to and including the one we report
+  unsigned lower = (n_wanted > n_above)? (n_wanted - n_above) : 0; // bisect for how many of those come from below
+  unsigned upper = (n_wanted < n_below)? n_wanted : n_below;
+  while (lower < upper) {
+    unsigned taken = lower + (upper - lower) / 2; // from below, so that the rest come from above
+    double next_below = center - select_from_ranked_window(monitor, n_below - 1 - taken);
+    double last_above = select_from_ranked_window(monitor, n_below + (n_wanted - taken) - 1) - center;
+    if (next_below < last_above)
+      lower = taken + 1; // the next one below beats the last one taken above
+    else
+      upper = taken;
+  }
+  double last_below = (lower > 0)? (center - select_from_ranked_window(monitor, n_below - lower)) : 0.0;
+  double last_above = (lower < n_wanted)? (select_from_ranked_window(monitor, n_below + (n_wanted - lower) - 1) - center) : 0.0;
+  return fabs((last_below > last_above)? last_below : last_above); // signed zeros would otherwise come out as -0.0
+}
+
+struct timed_quantile* create_timed_quantile_monitor(double duration, struct interpolation interp) {
+  unsigned capacity = 16; // grows as needed
+  struct timed_quantile* monitor = malloc(sizeof(struct timed_quantile));
+  monitor->duration = duration;
+  monitor->interpolation = interp;
+  monitor->window = (struct timed_window) {
+    .capacity = capacity,
+    .first = 0,
+    .n_entries = 0,
+    .values = malloc(capacity * sizeof(double)),
+    .timestamps = malloc(capacity * sizeof(double)),
+  };
+  monitor->tick = 0;
+  monitor->tree = create_order_tree(capacity);
+  return monitor;
+}
+
+void reset_timed_quantile(struct timed_quantile* monitor) {
+  monitor->window.first = 0;
+  monitor->window.n_entries = 0; // whatever room the ring grew to stays
+  monitor->tick = 0;
+  clear_order_tree(monitor->tree);
+}
+
+void destroy_timed_quantile_monitor(struct timed_quantile* monitor) {
+  destroy_order_tree(monitor->tree);
+  free(monitor->window.values);
+  free(monitor->window.timestamps);
+  free(monitor);
+}
+
+static void grow_timed_window(struct timed_window* window) { // unrolls the ring into a buffer twice the size
+  unsigned capacity = 2 * window->capacity;
+  double* values = malloc(capacity * sizeof(double));
+  double* timestamps = malloc(capacity * sizeof(double));
+  unsigned n_wrapped = window->first + window->n_entries - window->capacity; // the ring is full
+  unsigned n_unwrapped = window->n_entries - n_wrapped;
+  memcpy(values, window->values + window->first, n_unwrapped * sizeof(double));
+  memcpy(values + n_unwrapped, window->values, n_wrapped * sizeof(double));
+  memcpy(timestamps, window->timestamps + window->first, n_unwrapped * sizeof(double));
+  memcpy(timestamps + n_unwrapped, window->timestamps, n_wrapped * sizeof(double));
+  free(window->values);
+  free(window->timestamps);
+  window->values = values;
+  window->timestamps = timestamps;
+  window->capacity = capacity;
+  window->first = 0;
+}
+
+static unsigned locate_in_timed_window(struct timed_window* window, unsigned offset) { // counting from the oldest
+  unsigned index = window->first + offset;
+  return (index >= window->capacity)? (index - window->capacity) : index;
+}
+
+double interpolate_from_order_tree(struct order_tree* tree, struct interpolation interp) { // NaN when empty
+  unsigned n_entries = tree->n_entries;
+  if (n_entries == 0)
+    return NAN;
+  double target = compute_interpolation_target(n_entries, interp);
+  double position = floor(target); // one-based, like `interpolate_between_neighbors`
+  if (position < 1.0)
+    return select_from_order_tree(tree, 0);
+  if (position >= (double)n_entries)
+    return select_from_order_tree(tree, n_entries - 1);
+  double gamma = target - position;
+  unsigned rank = (unsigned)position - 1;
+  double current = select_from_order_tree(tree, rank);
+  double next = select_from_order_tree(tree, rank + 1);
+  return (1.0-gamma)*current + gamma*next;
+}
+
+double update_timed_quantile(struct timed_quantile* monitor, double entry, double timestamp) {
+  struct timed_window* window = &monitor->window;
+  if (isnan(timestamp))
+    entry = NAN; // and nothing expires, since we cannot tell how much time has passed
+  double horizon = timestamp - monitor->duration;
+  while ((window->n_entries > 0) && (window->timestamps[window->first] <= horizon)) {
+    unsigned oldest_tick = monitor->tick - window->n_entries; // present entries arrived back to back
+    remove_from_order_tree(monitor->tree, window->values[window->first], oldest_tick);
+    window->first = locate_in_timed_window(window, 1);
+    window->n_entries -= 1;
+  }
+  if (!isnan(entry)) {
+    if (window->n_entries == window->capacity)
+      grow_timed_window(window);
+    unsigned index = locate_in_timed_window(window, window->n_entries);
+    window->values[index] = entry;
+    window->timestamps[index] = timestamp;
+    window->n_entries += 1;
+    insert_into_order_tree(monitor->tree, entry, monitor->tick);
+    monitor->tick += 1;
+  }
+  return interpolate_from_order_tree(monitor->tree, monitor->interpolation);
+}
+
+double find_timed_window_middle(struct timed_quantile* monitor) { // rounds toward the newer half, like the high-pass buffer
+  struct timed_window* window = &monitor->window;
+  if (window->n_entries == 0)
+    return NAN;
+  return window->values[locate_in_timed_window(window, window->n_entries / 2)];
+}
+
+bool verify_timed_monitor(struct timed_quantile* monitor) {
+  struct timed_window* window = &monitor->window;
+  if (monitor->tree->n_entries != window->n_entries)
+    return false;
+  for (unsigned i = 1; i < window->n_entries; i += 1) {
+    if (window->timestamps[locate_in_timed_window(window, i-1)] > window->timestamps[locate_in_timed_window(window, i)])
+      return false;
+  }
+  return verify_order_tree(monitor->tree);
+}
+
+void save_timed_quantile(struct timed_quantile* monitor, struct state_stream* stream) {
+  struct timed_window* window = &monitor->window;
+  WRITE_STATE(stream, window->n_entries);
+  WRITE_STATE(stream, monitor->tick);
+  unsigned n_unwrapped = (window->first + window->n_entries > window->capacity)? (window->capacity - window->first) : window->n_entries;
+  unsigned n_wrapped = window->n_entries - n_unwrapped; // written unrolled, from the oldest onward
+  write_state(stream, window->values + window->first, n_unwrapped * sizeof(double));
+  write_state(stream, window->values, n_wrapped * sizeof(double));
+  write_state(stream, window->timestamps + window->first, n_unwrapped * sizeof(double));
+  write_state(stream, window->timestamps, n_wrapped * sizeof(double));
+  save_order_tree(monitor->tree, stream);
+}
+
+void restore_timed_quantile(struct timed_quantile* monitor, struct state_stream* stream) {
+  struct timed_window* window = &monitor->window;
+  unsigned n_entries = 0;
+  READ_STATE(stream, n_entries);
+  READ_STATE(stream, monitor->tick);
+  if (!has_room_for(stream, n_entries, 2 * sizeof(double))) {
+    stream->failed = true;
+    return;
+  }
+  while (window->capacity < n_entries) {
+    window->capacity *= 2;
+    window->values = realloc(window->values, window->capacity * sizeof(double));
+    window->timestamps = realloc(window->timestamps, window->capacity * sizeof(double));
+  }
+  window->first = 0;
+  window->n_entries = n_entries;
+  read_state(stream, window->values, n_entries * sizeof(double));
+  read_state(stream, window->timestamps, n_entries * sizeof(double));
+  restore_order_tree(monitor->tree, stream);
 }
 
 /*
@@ -94,7 +520,7 @@ static double interpolate_current_rolling_quantile(struct rolling_quantile* moni
     *Do not* contaminate the heaps with NaNs. That may cause their rebalancing to spiral out of control.
     Flushing. If the whole window empties, effectively reset the filter and revert `current_value` to its initial state.
 */
-double update_rolling_quantile(struct rolling_quantile* monitor, double next_entry) {
+static double update_heaped_rolling_quantile(struct rolling_quantile* monitor, double next_entry) {
   //unsigned left_entries = monitor->left_heap->n_entries;
   unsigned right_entries = monitor->right_heap->n_entries;
   //unsigned total_entries = left_entries + right_entries + 1;
@@ -105,39 +531,51 @@ double update_rolling_quantile(struct rolling_quantile* monitor, double next_ent
     if (isnan(next_entry))
       return NAN;
     monitor->current_value.member = next_entry;
-    register_in_queue(monitor->queue, &monitor->current_value);
+    enqueue_loose_element(monitor->queue, &monitor->current_value);
     monitor->count += 1;
     return next_entry;
   }
   int expired_in_heap = expire_stale_entry_in_queue(monitor->queue, 2, monitor->left_heap, monitor->right_heap);
+  COUNT_OPERATIONS(monitor->counters, current_expiries, expired_in_heap == 0);
+  COUNT_OPERATIONS(monitor->counters, left_expiries, expired_in_heap == 1);
+  COUNT_OPERATIONS(monitor->counters, right_expiries, expired_in_heap == 2);
   if (expired_in_heap == 0) { // expired, but did not belong to a heap
     if (monitor->queue->n_entries == 0) { // there do not exist other entries
       // basically reset and go again
       monitor->current_value.member = NAN;
-      return update_rolling_quantile(monitor, next_entry); // a delicate corner case, looping us back to the top. tread carefully
+      COUNT_OPERATIONS(monitor->counters, resets, 1);
+      return update_heaped_rolling_quantile(monitor, next_entry); // a delicate corner case, looping us back to the top. tread carefully
     }
     struct heap* some_heap = (right_entries > 0)? monitor->right_heap : monitor->left_heap; // pick arbitrarily
     remove_front_element_from_heap(some_heap, &monitor->current_value);
   } // else if (expired_in_heap == -1) { ... } // there was nothing to expire
   if (!isnan(next_entry)) {
     struct heap* heap_for_next = (next_entry > monitor->current_value.member)? monitor->right_heap : monitor->left_heap;
-    struct heap_element* next_elem = add_value_to_heap(heap_for_next, next_entry);
-    if (next_elem == NULL) // BY DESIGN SHOULD NEVER HAPPEN
+    if (enqueue_value_into_heap(heap_for_next, next_entry) == NO_SLOT) // BY DESIGN SHOULD NEVER HAPPEN
       printf("TRIED TO ADD TO A FULL HEAP\n");
-    register_in_queue(monitor->queue, next_elem);
   }
   monitor->count += 1;
-  rebalance_rolling_quantile(monitor); // should run a provably deterministic number of times (once?)
+  int rounds = rebalance_rolling_quantile(monitor); // should run a provably deterministic number of times (once?)
+  COUNT_OPERATIONS(monitor->counters, rebalances, 1);
+  COUNT_OPERATIONS(monitor->counters, rebalance_rounds, rounds);
+  RECORD_DEEPEST(monitor->counters, deepest_rebalance, (unsigned long long)rounds);
   if (!isnan(monitor->interpolation.target_quantile))
     return interpolate_current_rolling_quantile(monitor);
   return monitor->current_value.member;
 }
 
+double update_rolling_quantile(struct rolling_quantile* monitor, double next_entry) {
+  COUNT_OPERATIONS(monitor->counters, updates, 1);
+  if (monitor->engine != HEAP_ENGINE)
+    return update_ranked_rolling_quantile(monitor, next_entry);
+  return update_heaped_rolling_quantile(monitor, next_entry);
+}
+
 int rebalance_rolling_quantile(struct rolling_quantile* monitor) {
   unsigned left_entries = monitor->left_heap->n_entries;
   unsigned right_entries = monitor->right_heap->n_entries;
   unsigned total_entries = left_entries + right_entries + 1;
-  unsigned left_target = (monitor->portion * total_entries) / monitor->window; // builds up gradually when the pipeline is not yet saturated
+  unsigned left_target = rank_within_window(monitor->portion, monitor->window, total_entries); // builds up gradually when the pipeline is not yet saturated
   if (left_entries == left_target)
     return 0; // if-clauses with lone return statements don't need brackets in my book
   struct heap* overdue_heap = (left_entries < left_target)? monitor->right_heap : monitor->left_heap;
@@ -146,7 +584,7 @@ int rebalance_rolling_quantile(struct rolling_quantile* monitor) {
   struct heap* other_heap = (overdue_heap == monitor->right_heap)? monitor->left_heap : monitor->right_heap; // is it worth avoiding two separate branches of slightly redundant code?
   if (!isnan(holdover.member)) {
     // this part does not rely on the actual address of `holdover`/`current_value`, thankfully
-    add_element_to_heap(other_heap, holdover); // the method knows that `*holdover.loc_in_buffer` is stale after copying
+    add_element_to_heap(other_heap, holdover); // which takes its queue slot back from being loose
   }
   return rebalance_rolling_quantile(monitor) + 1; // is non-tail-call recursion *always* dangerous? each round performs one set of "remove and add"
 }
@@ -155,6 +593,17 @@ int rebalance_rolling_quantile(struct rolling_quantile* monitor) {
   Consists of various sanity checks and tests on integrity.
 */
 bool verify_monitor(struct rolling_quantile* monitor) {
+  if (monitor->engine == TREE_ENGINE)
+    return verify_order_tree(monitor->ranked.tree) && (monitor->ranked.tree->n_entries == monitor->ranked.n_entries);
+  if (monitor->engine == COUNTING_ENGINE)
+    return verify_histogram(monitor->ranked.histogram) && (monitor->ranked.histogram->n_entries == monitor->ranked.n_entries);
+  if (monitor->engine == SORTED_ENGINE) {
+    for (unsigned i = 1; i < monitor->ranked.n_entries; i += 1) {
+      if (monitor->ranked.sorted[i-1] > monitor->ranked.sorted[i])
+        return false;
+    }
+    return true;
+  }
   double left = view_front_of_heap(monitor->left_heap);
   if (!isnan(left) && (left > monitor->current_value.member))
    return false;
@@ -163,3 +612,275 @@ bool verify_monitor(struct rolling_quantile* monitor) {
     return false;
   return verify_heap(monitor->left_heap) && verify_heap(monitor->right_heap);
 }
+
+void save_rolling_quantile(struct rolling_quantile* monitor, struct state_stream* stream) {
+  unsigned engine = (unsigned)monitor->engine;
+  WRITE_STATE(stream, engine);
+  WRITE_STATE(stream, monitor->window);
+  WRITE_STATE(stream, monitor->current_value.member);
+  WRITE_STATE(stream, monitor->current_value.slot);
+  WRITE_STATE(stream, monitor->count);
+  if (monitor->engine == HEAP_ENGINE) {
+    save_queue(monitor->queue, stream);
+    save_heap(monitor->left_heap, stream);
+    save_heap(monitor->right_heap, stream);
+    return;
+  }
+  struct ranked_window* ranked = &monitor->ranked;
+  WRITE_STATE(stream, ranked->head);
+  WRITE_STATE(stream, ranked->n_entries);
+  WRITE_STATE(stream, ranked->tick);
+  write_state(stream, ranked->entries, monitor->window * sizeof(double));
+  if (ranked->sorted != NULL)
+    write_state(stream, ranked->sorted, ranked->n_entries * sizeof(double));
+  if (ranked->tree != NULL)
+    save_order_tree(ranked->tree, stream);
+  if (ranked->histogram != NULL)
+    save_counting_histogram(ranked->histogram, stream);
+}
+
+void restore_rolling_quantile(struct rolling_quantile* monitor, struct state_stream* stream) {
+  expect_state(stream, (unsigned)monitor->engine);
+  expect_state(stream, monitor->window);
+  READ_STATE(stream, monitor->current_value.member);
+  READ_STATE(stream, monitor->current_value.slot);
+  READ_STATE(stream, monitor->count);
+  if (monitor->engine == HEAP_ENGINE) {
+    restore_queue(monitor->queue, stream);
+    restore_heap(monitor->left_heap, stream);
+    restore_heap(monitor->right_heap, stream);
+    return;
+  }
+  struct ranked_window* ranked = &monitor->ranked;
+  READ_STATE(stream, ranked->head);
+  READ_STATE(stream, ranked->n_entries);
+  READ_STATE(stream, ranked->tick);
+  if ((ranked->head >= monitor->window) || (ranked->n_entries > monitor->window))
+    stream->failed = true;
+  if (stream->failed)
+    return;
+  read_state(stream, ranked->entries, monitor->window * sizeof(double));
+  if (ranked->sorted != NULL)
+    read_state(stream, ranked->sorted, ranked->n_entries * sizeof(double));
+  if (ranked->tree != NULL)
+    restore_order_tree(ranked->tree, stream);
+  if (ranked->histogram != NULL)
+    restore_counting_histogram(ranked->histogram, stream);
+}
+
+static int compare_chain_cuts(const void* a, const void* b) {
+  const struct chain_cut* first = a;
+  const struct chain_cut* second = b;
+  return (first->portion > second->portion) - (first->portion < second->portion);
+}
+
+static int compare_portions(const void* a, const void* b) {
+  unsigned first = *(const unsigned*)a;
+  unsigned second = *(const unsigned*)b;
+  return (first > second) - (first < second);
+}
+
+size_t measure_rolling_quantile_chain(unsigned window, unsigned n_cuts, unsigned* portions) {
+  size_t footprint = align_to_cache_line(sizeof(struct rolling_quantile_chain) + (n_cuts+1)*sizeof(struct heap*))
+    + measure_queue(window) + align_to_cache_line(n_cuts * sizeof(struct chain_cut));
+  unsigned* sorted = malloc(n_cuts * sizeof(unsigned)); // in the order the heaps are made in
+  for (unsigned i = 0; i < n_cuts; i += 1)
+    sorted[i] = (portions[i] < window)? portions[i] : window;
+  qsort(sorted, n_cuts, sizeof(unsigned), compare_portions);
+  unsigned previous_portion = 0;
+  for (unsigned i = 0; i <= n_cuts; i += 1) { // the heaps between consecutive cuts, as below
+    unsigned portion = (i < n_cuts)? sorted[i] : window;
+    footprint += measure_heap(portion - previous_portion + 3);
+    previous_portion = portion;
+  }
+  free(sorted);
+  return footprint;
+}
+
+struct rolling_quantile_chain* create_rolling_quantile_chain(unsigned window, unsigned n_cuts, unsigned* portions, struct interpolation* interps) {
+  return create_rolling_quantile_chain_within(NULL, window, n_cuts, portions, interps);
+}
+
+struct rolling_quantile_chain* create_rolling_quantile_chain_within(struct arena* arena, unsigned window, unsigned n_cuts, unsigned* portions, struct interpolation* interps) {
+  struct rolling_quantile_chain* chain = allocate_within(arena,
+    sizeof(struct rolling_quantile_chain) + (n_cuts+1)*sizeof(struct heap*));
+  chain->window = window;
+  chain->n_cuts = n_cuts;
+  chain->counters = (struct operation_counters) {0};
+  chain->queue = create_queue_within(arena, window);
+  chain->cuts = allocate_within(arena, n_cuts * sizeof(struct chain_cut));
+  for (unsigned i = 0; i < n_cuts; i += 1) {
+    chain->cuts[i] = (struct chain_cut) {
+      .portion = (portions[i] < window)? portions[i] : window,
+      .slot = i,
+      .interpolation = interps[i] };
+  }
+  qsort(chain->cuts, n_cuts, sizeof(struct chain_cut), compare_chain_cuts);
+  unsigned previous_portion = 0;
+  for (unsigned i = 0; i <= n_cuts; i += 1) {
+    unsigned portion = (i < n_cuts)? chain->cuts[i].portion : window;
+    enum heap_mode mode = (i == 0)? MAX_HEAP : ((i == n_cuts)? MIN_HEAP : MIN_MAX_HEAP);
+    // a heap never holds more than one past the span between its cuts once balanced, and a couple more in passing
+    chain->heaps[i] = create_d_ary_heap_within(arena, mode, 2, portion - previous_portion + 3, chain->queue);
+    previous_portion = portion;
+  }
+  return chain;
+}
+
+void reset_rolling_quantile_chain(struct rolling_quantile_chain* chain) {
+  chain->counters = (struct operation_counters) {0};
+  clear_queue(chain->queue);
+  for (unsigned i = 0; i <= chain->n_cuts; i += 1)
+    clear_heap(chain->heaps[i]);
+}
+
+void destroy_rolling_quantile_chain(struct rolling_quantile_chain* chain) {
+  destroy_rolling_quantile_chain_within(NULL, chain);
+}
+
+void destroy_rolling_quantile_chain_within(struct arena* arena, struct rolling_quantile_chain* chain) {
+  for (unsigned i = 0; i <= chain->n_cuts; i += 1)
+    release_within(arena, chain->heaps[i]);
+  release_within(arena, chain->queue);
+  release_within(arena, chain->cuts);
+  release_within(arena, chain);
+}
+
+static unsigned rank_of_chain_cut(struct chain_cut* cut, unsigned window, unsigned n_entries) { // requires a nonempty window
+  return rank_within_window(cut->portion, window, n_entries);
+}
+
+static double view_maximum_of_chain_link(struct rolling_quantile_chain* chain, unsigned i) { // never asked of the rightmost min-heap
+  struct heap* heap = chain->heaps[i];
+  return (i == 0)? view_front_of_heap(heap) : view_back_of_heap(heap);
+}
+
+// cut `i` sits between heaps `i` and `i+1`
+static void shift_across_chain_cut(struct rolling_quantile_chain* chain, unsigned i, bool leftward) {
+  struct heap_element transit = { .member = NAN, .slot = NO_SLOT };
+  if (leftward) {
+    remove_front_element_from_heap(chain->heaps[i+1], &transit);
+    add_element_to_heap(chain->heaps[i], transit);
+  } else {
+    if (i == 0)
+      remove_front_element_from_heap(chain->heaps[0], &transit);
+    else
+      remove_back_element_from_heap(chain->heaps[i], &transit);
+    add_element_to_heap(chain->heaps[i+1], transit);
+  }
+}
+
+/*
+  Every cut wants exactly `rank` elements to its left. Elements flowing rightward are
+  settled from left to right and those flowing leftward from right to left, so that a
+  link always receives what it owes before it has to pay it forward.
+ */
+static unsigned rebalance_rolling_quantile_chain(struct rolling_quantile_chain* chain) { // returns the number of shifts
+  unsigned n_entries = chain->queue->n_entries;
+  unsigned n_shifts = 0;
+  if (n_entries == 0)
+    return 0;
+  unsigned prefix = 0;
+  for (unsigned i = 0; i < chain->n_cuts; i += 1) {
+    prefix += chain->heaps[i]->n_entries;
+    unsigned rank = rank_of_chain_cut(chain->cuts + i, chain->window, n_entries);
+    for (; prefix > rank; prefix -= 1, n_shifts += 1)
+      shift_across_chain_cut(chain, i, false);
+  }
+  unsigned suffix = 0;
+  for (unsigned i = chain->n_cuts; i-- > 0;) {
+    suffix += chain->heaps[i+1]->n_entries;
+    unsigned rank = rank_of_chain_cut(chain->cuts + i, chain->window, n_entries);
+    for (; (n_entries - suffix) < rank; suffix -= 1, n_shifts += 1)
+      shift_across_chain_cut(chain, i, true);
+  }
+  return n_shifts;
+}
+
+static struct heap* locate_chain_link_for_entry(struct rolling_quantile_chain* chain, double entry) {
+  for (unsigned i = 0; i < chain->n_cuts; i += 1) {
+    struct heap* heap = chain->heaps[i];
+    if ((heap->n_entries > 0) && (entry <= view_maximum_of_chain_link(chain, i)))
+      return heap;
+  }
+  return chain->heaps[chain->n_cuts];
+}
+
+static double view_around_chain_cut(struct rolling_quantile_chain* chain, unsigned i, double* previous, double* next) {
+  unsigned link = i + 1;
+  while (chain->heaps[link]->n_entries == 0) // the ranks never reach the end of the window
+    link += 1;
+  double current = view_front_of_heap(chain->heaps[link]);
+  *next = view_runner_up_of_heap(chain->heaps[link]);
+  for (unsigned after = link + 1; isnan(*next) && (after <= chain->n_cuts); after += 1)
+    *next = view_front_of_heap(chain->heaps[after]);
+  *previous = NAN;
+  for (unsigned before = i + 1; isnan(*previous) && (before-- > 0);)
+    *previous = view_maximum_of_chain_link(chain, before);
+  return current;
+}
+
+/*
+  Carries the single monitor's semantics over to each cut: one expiry and at most one
+  insertion per call, NaNs deplete the window, and the window restarts once empty.
+ */
+void update_rolling_quantile_chain(struct rolling_quantile_chain* chain, double entry, double* outputs) {
+  COUNT_OPERATIONS(chain->counters, updates, 1);
+  advance_ring_buffer(chain->queue);
+  int expired_in_heap = expire_stale_entry_in_queue_among(chain->queue, chain->n_cuts + 1, chain->heaps);
+  COUNT_OPERATIONS(chain->counters, left_expiries, expired_in_heap == 1);
+  COUNT_OPERATIONS(chain->counters, right_expiries, expired_in_heap == (int)chain->n_cuts + 1); // and those in between go uncounted
+  if (!isnan(entry)) {
+    if (enqueue_value_into_heap(locate_chain_link_for_entry(chain, entry), entry) == NO_SLOT) // BY DESIGN SHOULD NEVER HAPPEN
+      printf("TRIED TO ADD TO A FULL HEAP\n");
+  }
+  unsigned n_shifts = rebalance_rolling_quantile_chain(chain);
+  COUNT_OPERATIONS(chain->counters, rebalances, 1);
+  COUNT_OPERATIONS(chain->counters, rebalance_rounds, n_shifts);
+  RECORD_DEEPEST(chain->counters, deepest_rebalance, (unsigned long long)n_shifts);
+  unsigned n_entries = chain->queue->n_entries;
+  for (unsigned i = 0; i < chain->n_cuts; i += 1) {
+    struct chain_cut* cut = chain->cuts + i;
+    if (n_entries == 0) {
+      outputs[cut->slot] = NAN;
+      continue;
+    }
+    double previous, next;
+    double current = view_around_chain_cut(chain, i, &previous, &next);
+    if (isnan(cut->interpolation.target_quantile))
+      outputs[cut->slot] = current;
+    else
+      outputs[cut->slot] = interpolate_between_neighbors(
+        previous, current, next, chain->window, cut->portion, cut->interpolation);
+  }
+}
+
+bool verify_rolling_quantile_chain(struct rolling_quantile_chain* chain) {
+  double maximum_so_far = NAN;
+  for (unsigned i = 0; i <= chain->n_cuts; i += 1) {
+    struct heap* heap = chain->heaps[i];
+    if (!verify_heap(heap))
+      return false;
+    if (heap->n_entries == 0)
+      continue;
+    if (!isnan(maximum_so_far) && (view_front_of_heap(heap) < maximum_so_far))
+      return false;
+    if (i < chain->n_cuts)
+      maximum_so_far = view_maximum_of_chain_link(chain, i);
+  }
+  return true;
+}
+
+void save_rolling_quantile_chain(struct rolling_quantile_chain* chain, struct state_stream* stream) {
+  WRITE_STATE(stream, chain->n_cuts);
+  save_queue(chain->queue, stream);
+  for (unsigned i = 0; i <= chain->n_cuts; i += 1)
+    save_heap(chain->heaps[i], stream);
+}
+
+void restore_rolling_quantile_chain(struct rolling_quantile_chain* chain, struct state_stream* stream) {
+  expect_state(stream, chain->n_cuts);
+  restore_queue(chain->queue, stream);
+  for (unsigned i = 0; i <= chain->n_cuts; i += 1)
+    restore_heap(chain->heaps[i], stream);
+}
@@ -18,6 +18,9 @@
 #define QUANTILE_H
 
 #include "heap.h"
+#include "tree.h"
+#include "histogram.h"
+#include "state.h"
 
 #include <stdbool.h>
 
@@ -42,6 +45,30 @@ struct interpolation {
 
 extern const struct interpolation NO_INTERPOLATION;
 
+/*
+  Which structure orders the window. A flat sorted array wins for short windows, where
+  a shift of a few cache lines beats chasing heap back-pointers, and the heaps win from
+  there on. The order-statistic tree only pulls ahead on long windows over steadily
+  trending signals, where every heap sift runs the full height, so it is never chosen
+  automatically. All report identical values. Quantized signals over a small domain of
+  integers may instead be counted in a histogram, which is exact within that domain.
+ */
+enum quantile_engine {
+  AUTOMATIC_ENGINE, HEAP_ENGINE, TREE_ENGINE, SORTED_ENGINE, COUNTING_ENGINE
+};
+
+#define SORTED_ENGINE_THRESHOLD 96 // windows no longer than this go to the sorted array when chosen automatically
+
+struct ranked_window { // raw entries in arrival order, for engines that select by rank rather than track the quantile
+  double* entries; // NaN marks a missing value
+  unsigned head;
+  unsigned n_entries;
+  unsigned tick; // serial number of the next arrival
+  struct order_tree* tree; // for TREE_ENGINE
+  double* sorted; // for SORTED_ENGINE, the entries present in ascending order
+  struct counting_histogram* histogram; // for COUNTING_ENGINE
+};
+
 // Can't hide this structure's implementation in quantile.c because we want to be able to handle it by value. Comprise other structures of it without having many layers of indirection.
 struct rolling_quantile {
   struct heap_element current_value;
@@ -52,14 +79,95 @@ struct rolling_quantile {
   struct heap* right_heap;
   unsigned count;
   struct interpolation interpolation; // store this optional setting without indirection.
+  enum quantile_engine engine;
+  struct ranked_window ranked; // only for the tree, the sorted array, and the histogram, in which case the heaps and queue above are NULL
+  struct operation_counters counters; // rebalances and expiries, should they be compiled in. the heaps keep their own
+};
+
+/*
+  A rolling quantile over a span of time rather than a count of samples, for irregularly
+  sampled series. Present entries sit in a growable ring next to their timestamps, and
+  each update expires every one that has fallen out of (now - duration, now]. The
+  order-statistic tree ranks them, since there is no telling how many there will be.
+  The quantile is interpolated over whatever the span holds at the moment.
+ */
+struct timed_window {
+  unsigned capacity;
+  unsigned first; // the oldest entry
+  unsigned n_entries;
+  double* values;
+  double* timestamps;
+};
+
+struct timed_quantile {
+  double duration;
+  struct interpolation interpolation; // required, since there is no fixed window for a `portion` to refer to
+  struct timed_window window;
+  unsigned tick; // serial number of the next entry, which always arrives after everything else present
+  struct order_tree* tree;
+};
+
+/*
+  Several quantiles over one shared window. A chain of heaps, split at as many cut
+  points as there are quantiles: a max-heap on the far left, a min-heap on the far
+  right, and double-ended min-max heaps in between. Every sample enters and expires
+  exactly once regardless of how many quantiles are reported. The cuts are kept in
+  ascending order of `portion`, and `slot` remembers where each belongs in the output.
+ */
+struct chain_cut {
+  unsigned portion;
+  unsigned slot;
+  struct interpolation interpolation;
+};
+
+struct rolling_quantile_chain {
+  unsigned window;
+  unsigned n_cuts;
+  struct ring_buffer* queue;
+  struct chain_cut* cuts;
+  struct operation_counters counters;
+  struct heap* heaps[]; // n_cuts + 1 of them
 };
 
 struct rolling_quantile create_rolling_quantile_monitor(unsigned window, unsigned portion, struct interpolation interp); // window should be an odd number. portion is how much probability mass goes to the left side, so (portion+0.5)/window gives the quantile.
+struct rolling_quantile create_rolling_quantile_monitor_with_engine(unsigned window, unsigned portion, struct interpolation interp, enum quantile_engine engine, unsigned arity); // arity only matters to the heaps, and anything but 4 or 8 means binary
+struct rolling_quantile create_rolling_quantile_monitor_over_domain(unsigned window, unsigned portion, struct interpolation interp, double lowest, double highest); // counts integers within [lowest, highest]
+struct rolling_quantile create_rolling_quantile_monitor_within(struct arena* arena, unsigned window, unsigned portion, struct interpolation interp, enum quantile_engine engine, unsigned arity); // see arena.h
+struct rolling_quantile create_rolling_quantile_monitor_over_domain_within(struct arena* arena, unsigned window, unsigned portion, struct interpolation interp, double lowest, double highest);
+size_t measure_rolling_quantile_monitor(unsigned window, unsigned portion, enum quantile_engine engine); // footprints within an arena
+size_t measure_rolling_quantile_monitor_over_domain(unsigned window, double lowest, double highest);
+enum quantile_engine choose_quantile_engine(unsigned window);
 bool validate_interpolation(struct interpolation interp);
 double compute_interpolation_target(unsigned window, struct interpolation interp);
+double interpolate_between_neighbors(double previous, double current, double next, unsigned window, unsigned portion, struct interpolation interp); // absent neighbors come in as NaN
+unsigned rank_within_window(unsigned portion, unsigned window, unsigned n_entries); // of the reported entry among those present, which must be some
 double update_rolling_quantile(struct rolling_quantile* monitor, double entry);
+double find_rolling_deviation(struct rolling_quantile* monitor, double center); // the median (or rather the same quantile) absolute deviation about `center` of the entries present. NaN for heaps
+double interpolate_from_order_tree(struct order_tree* tree, struct interpolation interp); // over every entry in the tree
 int rebalance_rolling_quantile(struct rolling_quantile* monitor); // returns the number of sifts and shifts it had to perform
 bool verify_monitor(struct rolling_quantile* monitor);
+void save_rolling_quantile(struct rolling_quantile* monitor, struct state_stream* stream);
+void restore_rolling_quantile(struct rolling_quantile* monitor, struct state_stream* stream); // into a fresh monitor made alike. see state.h
+void reset_rolling_quantile(struct rolling_quantile* monitor); // to how it was made, in place
 void destroy_rolling_quantile_monitor(struct rolling_quantile* monitor);
+void destroy_rolling_quantile_monitor_within(struct arena* arena, struct rolling_quantile* monitor); // frees only what was not carved out of it
+struct timed_quantile* create_timed_quantile_monitor(double duration, struct interpolation interp);
+double update_timed_quantile(struct timed_quantile* monitor, double entry, double timestamp); // timestamps must not decrease. a NaN timestamp counts as a missing entry
+double find_timed_window_middle(struct timed_quantile* monitor); // the present entry halfway through the span, by count
+bool verify_timed_monitor(struct timed_quantile* monitor);
+void save_timed_quantile(struct timed_quantile* monitor, struct state_stream* stream);
+void restore_timed_quantile(struct timed_quantile* monitor, struct state_stream* stream);
+void reset_timed_quantile(struct timed_quantile* monitor);
+void destroy_timed_quantile_monitor(struct timed_quantile* monitor);
+struct rolling_quantile_chain* create_rolling_quantile_chain(unsigned window, unsigned n_cuts, unsigned* portions, struct interpolation* interps); // portions may come in any order
+struct rolling_quantile_chain* create_rolling_quantile_chain_within(struct arena* arena, unsigned window, unsigned n_cuts, unsigned* portions, struct interpolation* interps);
+size_t measure_rolling_quantile_chain(unsigned window, unsigned n_cuts, unsigned* portions);
+void update_rolling_quantile_chain(struct rolling_quantile_chain* chain, double entry, double* outputs); // writes `n_cuts` outputs in the order the portions were given
+bool verify_rolling_quantile_chain(struct rolling_quantile_chain* chain);
+void save_rolling_quantile_chain(struct rolling_quantile_chain* chain, struct state_stream* stream);
+void restore_rolling_quantile_chain(struct rolling_quantile_chain* chain, struct state_stream* stream);
+void reset_rolling_quantile_chain(struct rolling_quantile_chain* chain);
+void destroy_rolling_quantile_chain(struct rolling_quantile_chain* chain);
+void destroy_rolling_quantile_chain_within(struct arena* arena, struct rolling_quantile_chain* chain);
 
 #endif
@@ -0,0 +1,191 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "sketch.h"
+
+#include <stdlib.h>
+#include <tgmath.h>
+#include <stdbool.h>
+
+static void shape_sliding_sketch(struct sliding_sketch* sketch, unsigned window, double error) {
+  double block_length = floor(0.25 * error * (double)window);
+  double summary_length = ceil(1.0 / error);
+  sketch->window = window;
+  sketch->block_length = (block_length > 1.0)? (unsigned)block_length : 1;
+  sketch->n_blocks = (window + sketch->block_length - 1) / sketch->block_length;
+  sketch->summary_length = (summary_length < (double)sketch->block_length)?
+    (unsigned)summary_length : sketch->block_length; // no need to summarize blocks that are already small
+}
+
+size_t measure_sliding_sketch(unsigned window, double error) {
+  struct sliding_sketch shape;
+  shape_sliding_sketch(&shape, window, error);
+  return align_to_cache_line(sizeof(struct sliding_sketch)) + align_to_cache_line(shape.block_length * sizeof(double))
+    + align_to_cache_line((size_t)shape.n_blocks * shape.summary_length * sizeof(double))
+    + 2 * align_to_cache_line(shape.n_blocks * sizeof(unsigned));
+}
+
+struct sliding_sketch* create_sliding_sketch(unsigned window, double error, struct interpolation interp) {
+  return create_sliding_sketch_within(NULL, window, error, interp);
+}
+
+struct sliding_sketch* create_sliding_sketch_within(struct arena* arena, unsigned window, double error, struct interpolation interp) {
+  struct sliding_sketch* sketch = allocate_within(arena, sizeof(struct sliding_sketch));
+  shape_sliding_sketch(sketch, window, error);
+  sketch->interpolation = interp;
+  sketch->clock = 0;
+  sketch->n_block_entries = 0;
+  sketch->block = allocate_within(arena, sketch->block_length * sizeof(double));
+  sketch->oldest = 0;
+  sketch->n_summaries = 0;
+  sketch->summaries = allocate_within(arena, (size_t)sketch->n_blocks * sketch->summary_length * sizeof(double));
+  sketch->summary_counts = allocate_within(arena, sketch->n_blocks * sizeof(unsigned));
+  sketch->first_ticks = allocate_within(arena, sketch->n_blocks * sizeof(unsigned));
+  sketch->tick = 0;
+  sketch->tree = create_order_tree(sketch->n_blocks * sketch->summary_length); // which grows as it goes
+  sketch->estimate = NAN;
+  return sketch;
+}
+
+void reset_sliding_sketch(struct sliding_sketch* sketch) {
+  sketch->clock = 0;
+  sketch->n_block_entries = 0;
+  sketch->oldest = 0;
+  sketch->n_summaries = 0;
+  sketch->tick = 0;
+  clear_order_tree(sketch->tree);
+  sketch->estimate = NAN;
+}
+
+void destroy_sliding_sketch(struct sliding_sketch* sketch) {
+  destroy_sliding_sketch_within(NULL, sketch);
+}
+
+void destroy_sliding_sketch_within(struct arena* arena, struct sliding_sketch* sketch) {
+  destroy_order_tree(sketch->tree);
+  release_within(arena, sketch->block);
+  release_within(arena, sketch->summaries);
+  release_within(arena, sketch->summary_counts);
+  release_within(arena, sketch->first_ticks);
+  release_within(arena, sketch);
+}
+
+static int compare_doubles(const void* a, const void* b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+static void retire_summary(struct sliding_sketch* sketch, unsigned slot) {
+  double* points = sketch->summaries + (size_t)slot * sketch->summary_length;
+  for (unsigned i = 0; i < sketch->summary_counts[slot]; i += 1)
+    remove_from_order_tree(sketch->tree, points[i], sketch->first_ticks[slot] + i);
+}
+
+/*
+  Summaries of partially missing blocks get proportionally fewer points, so that every
+  point in the tree stands for about the same number of entries. Point j takes the entry
+  at the middle of the j-th of that many equal slices of the sorted block.
+ */
+static void summarize_block(struct sliding_sketch* sketch) {
+  unsigned slot;
+  if (sketch->n_summaries < sketch->n_blocks) {
+    slot = sketch->n_summaries++;
+  } else {
+    slot = sketch->oldest;
+    retire_summary(sketch, slot);
+    sketch->oldest = (slot + 1 == sketch->n_blocks)? 0 : (slot + 1);
+  }
+  unsigned n_entries = sketch->n_block_entries;
+  unsigned n_points = (unsigned)floor(0.5 + (double)sketch->summary_length * (double)n_entries / (double)sketch->block_length);
+  if ((n_points == 0) && (n_entries > 0))
+    n_points = 1;
+  qsort(sketch->block, n_entries, sizeof(double), compare_doubles);
+  double* points = sketch->summaries + (size_t)slot * sketch->summary_length;
+  for (unsigned j = 0; j < n_points; j += 1) {
+    unsigned long long index = ((2ull*j + 1) * n_entries) / (2ull * n_points);
+    points[j] = sketch->block[index];
+    insert_into_order_tree(sketch->tree, points[j], sketch->tick + j);
+  }
+  sketch->summary_counts[slot] = n_points;
+  sketch->first_ticks[slot] = sketch->tick;
+  sketch->tick += n_points;
+  sketch->clock = 0;
+  sketch->n_block_entries = 0;
+  sketch->estimate = interpolate_from_order_tree(sketch->tree, sketch->interpolation);
+}
+
+double update_sliding_sketch(struct sliding_sketch* sketch, double entry) {
+  if (!isnan(entry))
+    sketch->block[sketch->n_block_entries++] = entry;
+  if (++sketch->clock == sketch->block_length)
+    summarize_block(sketch);
+  return sketch->estimate;
+}
+
+bool verify_sliding_sketch(struct sliding_sketch* sketch) {
+  unsigned n_points = 0;
+  for (unsigned slot = 0; slot < sketch->n_summaries; slot += 1) {
+    double* points = sketch->summaries + (size_t)slot * sketch->summary_length;
+    if (sketch->summary_counts[slot] > sketch->summary_length)
+      return false;
+    for (unsigned i = 1; i < sketch->summary_counts[slot]; i += 1) {
+      if (points[i-1] > points[i])
+        return false;
+    }
+    n_points += sketch->summary_counts[slot];
+  }
+  return (n_points == sketch->tree->n_entries) && verify_order_tree(sketch->tree);
+}
+
+void save_sliding_sketch(struct sliding_sketch* sketch, struct state_stream* stream) {
+  WRITE_STATE(stream, sketch->block_length);
+  WRITE_STATE(stream, sketch->n_blocks);
+  WRITE_STATE(stream, sketch->summary_length);
+  WRITE_STATE(stream, sketch->clock);
+  WRITE_STATE(stream, sketch->n_block_entries);
+  WRITE_STATE(stream, sketch->oldest);
+  WRITE_STATE(stream, sketch->n_summaries);
+  WRITE_STATE(stream, sketch->tick);
+  WRITE_STATE(stream, sketch->estimate);
+  write_state(stream, sketch->block, sketch->n_block_entries * sizeof(double));
+  write_state(stream, sketch->summaries, (size_t)sketch->n_summaries * sketch->summary_length * sizeof(double));
+  write_state(stream, sketch->summary_counts, sketch->n_summaries * sizeof(unsigned));
+  write_state(stream, sketch->first_ticks, sketch->n_summaries * sizeof(unsigned));
+  save_order_tree(sketch->tree, stream);
+}
+
+void restore_sliding_sketch(struct sliding_sketch* sketch, struct state_stream* stream) {
+  expect_state(stream, sketch->block_length);
+  expect_state(stream, sketch->n_blocks);
+  expect_state(stream, sketch->summary_length);
+  READ_STATE(stream, sketch->clock);
+  READ_STATE(stream, sketch->n_block_entries);
+  READ_STATE(stream, sketch->oldest);
+  READ_STATE(stream, sketch->n_summaries);
+  READ_STATE(stream, sketch->tick);
+  READ_STATE(stream, sketch->estimate);
+  if ((sketch->n_block_entries > sketch->clock) || (sketch->clock >= sketch->block_length)
+      || (sketch->n_summaries > sketch->n_blocks) || (sketch->oldest >= sketch->n_blocks))
+    stream->failed = true;
+  if (stream->failed)
+    return;
+  read_state(stream, sketch->block, sketch->n_block_entries * sizeof(double));
+  read_state(stream, sketch->summaries, (size_t)sketch->n_summaries * sketch->summary_length * sizeof(double));
+  read_state(stream, sketch->summary_counts, sketch->n_summaries * sizeof(unsigned));
+  read_state(stream, sketch->first_ticks, sketch->n_summaries * sizeof(unsigned));
+  restore_order_tree(sketch->tree, stream);
+}
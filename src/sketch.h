@@ -0,0 +1,68 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include "quantile.h"
+
+#include <stdbool.h>
+
+/*
+  Approximate rolling quantiles in memory that does not grow with the window, for windows
+  far too long to hold. Arrivals are cut into blocks, and every block that fills up is boiled
+  down to a summary of evenly spaced order statistics. The summaries of the most recent
+  `n_blocks` blocks share an order-statistic tree, and the oldest one retires whole. The
+  estimate is interpolated over the summary points, and only refreshes once per block.
+
+  For a window W and a rank error bound e, blocks hold about eW/4 arrivals and summaries
+  hold 1/e points. A summary misplaces ranks within its block by at most half a point's
+  worth, which adds up to eW/2 over the window. Whole blocks put the window's edges off by
+  fewer than two blocks' worth of arrivals, which is the other eW/2. That makes for about
+  4/e^2 summary points, whatever the window. Each block costs a sort, so an update is
+  amortized O(log(eW)), and outputs are NaN until the first block fills.
+ */
+struct sliding_sketch {
+  unsigned window;
+  struct interpolation interpolation;
+  unsigned block_length; // arrivals per block
+  unsigned n_blocks; // that cover the window
+  unsigned summary_length; // points summarizing a block without missing values
+  unsigned clock; // arrivals into the current block
+  unsigned n_block_entries; // present entries in the current block
+  double* block;
+  unsigned oldest; // summary slot to retire next, once all of them are taken
+  unsigned n_summaries;
+  double* summaries; // `n_blocks` slots of `summary_length` points each, in ascending order
+  unsigned* summary_counts;
+  unsigned* first_ticks; // of each summary's points in the tree, which were inserted in order
+  unsigned tick;
+  struct order_tree* tree;
+  double estimate; // holds between blocks
+};
+
+struct sliding_sketch* create_sliding_sketch(unsigned window, double error, struct interpolation interp); // interpolation is required
+struct sliding_sketch* create_sliding_sketch_within(struct arena* arena, unsigned window, double error, struct interpolation interp); // see arena.h
+size_t measure_sliding_sketch(unsigned window, double error); // its footprint within an arena
+double update_sliding_sketch(struct sliding_sketch* sketch, double entry);
+bool verify_sliding_sketch(struct sliding_sketch* sketch);
+void save_sliding_sketch(struct sliding_sketch* sketch, struct state_stream* stream);
+void restore_sliding_sketch(struct sliding_sketch* sketch, struct state_stream* stream); // into one of the same window and error
+void reset_sliding_sketch(struct sliding_sketch* sketch); // to how it was made, in place
+void destroy_sliding_sketch(struct sliding_sketch* sketch);
+void destroy_sliding_sketch_within(struct arena* arena, struct sliding_sketch* sketch);
+
+#endif
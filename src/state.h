@@ -0,0 +1,70 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+
+#ifndef STATE_H
+#define STATE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+  Snapshots of filter state, for checkpoints and for handing pipelines between processes.
+  Each structure writes its counters and arrays back to back into one flat buffer, and reads
+  them back into a twin that was freshly made from the same description, which already has
+  the right shape. Heaps, queues and trees link by indices rather than pointers, so every
+  one of them comes back with a memcpy per array rather than by reinsertion. Values are in
+  native byte order, so a snapshot only travels between machines of the same kind.
+ */
+struct state_stream {
+  unsigned char* data; // NULL when only measuring how much there is to write
+  size_t length; // bytes written or read so far
+  size_t capacity; // bytes available to read
+  bool failed; // once it ran off the end, or found a shape other than what it expected
+};
+
+static inline void write_state(struct state_stream* stream, const void* source, size_t size) {
+  if ((stream->data != NULL) && (size > 0)) // empty arrays may well be NULL
+    memcpy(stream->data + stream->length, source, size);
+  stream->length += size;
+}
+
+static inline void read_state(struct state_stream* stream, void* destination, size_t size) {
+  if (stream->failed || (size > stream->capacity - stream->length)) {
+    stream->failed = true;
+    return; // leaves the destination as it was
+  }
+  if (size > 0)
+    memcpy(destination, stream->data + stream->length, size);
+  stream->length += size;
+}
+
+static inline bool has_room_for(struct state_stream* stream, size_t count, size_t size) { // before allocating anything on a snapshot's say-so
+  return !stream->failed && (count <= (stream->capacity - stream->length) / size);
+}
+
+static inline void expect_state(struct state_stream* stream, unsigned expected) { // for sizes that the description already fixed
+  unsigned found = ~expected;
+  read_state(stream, &found, sizeof(unsigned));
+  if (found != expected)
+    stream->failed = true;
+}
+
+#define WRITE_STATE(stream, field) write_state((stream), &(field), sizeof(field))
+#define READ_STATE(stream, field) read_state((stream), &(field), sizeof(field))
+
+#endif
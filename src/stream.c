@@ -0,0 +1,232 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "stream.h"
+#include "arena.h"
+#include "parallel.h"
+
+#include <string.h>
+
+#define STREAM_BATCH 256 // entries the worker takes off the input ring at once
+
+static size_t round_up_to_power_of_two(size_t n) {
+  size_t power = 1;
+  while (power < n)
+    power <<= 1;
+  return power;
+}
+
+static size_t measure_ring(size_t capacity, unsigned width) {
+  return align_to_cache_line(capacity * width * sizeof(double));
+}
+
+static bool place_ring(struct arena* arena, struct spsc_ring* ring, size_t capacity, unsigned width) {
+  ring->slots = allocate_within(arena, capacity * width * sizeof(double));
+  ring->mask = capacity - 1;
+  ring->width = width;
+  ring->tail_seen = ring->head_seen = 0;
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  return ring->slots != NULL;
+}
+
+// the producer's side. how many entries there is room for right now, looking again only if needs be
+static size_t find_room(struct spsc_ring* ring, size_t wanted) {
+  size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  size_t capacity = ring->mask + 1;
+  if (capacity - (head - ring->tail_seen) < wanted)
+    ring->tail_seen = atomic_load_explicit(&ring->tail, memory_order_acquire); // the consumer is done with those slots
+  return capacity - (head - ring->tail_seen);
+}
+
+// the consumer's side, likewise
+static size_t find_entries(struct spsc_ring* ring, size_t wanted) {
+  size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  if (ring->head_seen - tail < wanted)
+    ring->head_seen = atomic_load_explicit(&ring->head, memory_order_acquire); // and whatever was written before it
+  return ring->head_seen - tail;
+}
+
+// copies entries out of the ring from position `start` on, in at most two pieces since they may wrap around the end
+static void copy_out_of_ring(struct spsc_ring* ring, size_t start, size_t n_entries, double* destination) {
+  size_t offset = start & ring->mask;
+  size_t n_first = (offset + n_entries <= ring->mask + 1)? n_entries : (ring->mask + 1 - offset);
+  memcpy(destination, ring->slots + offset*ring->width, n_first * ring->width * sizeof(double));
+  memcpy(destination + n_first*ring->width, ring->slots, (n_entries - n_first) * ring->width * sizeof(double));
+}
+
+static double* locate_slot(struct spsc_ring* ring, size_t position) {
+  return ring->slots + (position & ring->mask)*ring->width;
+}
+
+static void publish(_Atomic size_t* index, size_t n_entries) { // only ever called by the one side that owns the index
+  atomic_store_explicit(index, atomic_load_explicit(index, memory_order_relaxed) + n_entries, memory_order_release);
+}
+
+static void tally(_Atomic unsigned long long* counter, unsigned long long amount) { // likewise
+  atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+static void filter_entry(struct filter_pipeline* pipeline, const double* input, double* outputs) {
+  if (pipeline->timed) {
+    if (pipeline->width == 1)
+      *outputs = feed_filter_pipeline_at(pipeline, input[0], input[1]);
+    else
+      feed_filter_pipeline_at_into(pipeline, input[0], input[1], outputs);
+  } else {
+    if (pipeline->width == 1)
+      *outputs = feed_filter_pipeline(pipeline, input[0]);
+    else
+      feed_filter_pipeline_into(pipeline, input[0], outputs);
+  }
+}
+
+/*
+  The worker looks at `closing` before it looks at the input ring, so that whatever was pushed
+  before the stream was closed is seen and filtered. Once closing, it no longer waits on the
+  consumer, and drops the outputs that have no room, so that the pipeline's state still ends up
+  having taken in every entry.
+ */
+static void run_filter_stream(void* context, unsigned first, unsigned last) {
+  (void)first; (void)last; // a lone task, with no range of items
+  struct filter_stream* stream = context;
+  struct filter_pipeline* pipeline = stream->pipeline;
+  struct spsc_ring* inputs = &stream->inputs;
+  struct spsc_ring* outputs = &stream->outputs;
+  double* discarded = stream->discarded;
+  unsigned n_idle_rounds = 0;
+  bool stalled = false;
+  for (;;) {
+    bool closing = atomic_load_explicit(&stream->closing, memory_order_acquire);
+    size_t n_waiting = find_entries(inputs, STREAM_BATCH);
+    if (n_waiting == 0) {
+      if (closing)
+        break;
+      idle_thread(n_idle_rounds++);
+      continue;
+    }
+    size_t n_batch = (n_waiting < STREAM_BATCH)? n_waiting : STREAM_BATCH;
+    size_t room = find_room(outputs, n_batch);
+    if ((room == 0) && !closing) {
+      if (!stalled)
+        tally(&stream->n_stalls, 1);
+      stalled = true;
+      idle_thread(n_idle_rounds++);
+      continue;
+    }
+    stalled = false;
+    n_idle_rounds = 0;
+    if (n_waiting > atomic_load_explicit(&stream->peak_backlog, memory_order_relaxed))
+      atomic_store_explicit(&stream->peak_backlog, n_waiting, memory_order_relaxed);
+    if ((room < n_batch) && !closing)
+      n_batch = room;
+    size_t tail = atomic_load_explicit(&inputs->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&outputs->head, memory_order_relaxed);
+    size_t n_kept = (room < n_batch)? room : n_batch;
+    for (size_t i = 0; i < n_batch; i += 1)
+      filter_entry(pipeline, locate_slot(inputs, tail + i), (i < n_kept)? locate_slot(outputs, head + i) : discarded);
+    publish(&inputs->tail, n_batch);
+    publish(&outputs->head, n_kept);
+    tally(&stream->n_filtered, n_batch);
+  }
+}
+
+struct filter_stream* open_filter_stream(struct filter_pipeline* pipeline, size_t capacity) {
+  capacity = round_up_to_power_of_two((capacity > 0)? capacity : 1);
+  unsigned input_width = pipeline->timed? 2 : 1;
+  struct arena* arena = open_arena(align_to_cache_line(sizeof(struct filter_stream))
+    + measure_ring(capacity, input_width) + measure_ring(capacity, pipeline->width) + measure_ring(1, pipeline->width), 1);
+  if (arena == NULL)
+    return NULL;
+  struct filter_stream* stream = allocate_within(arena, sizeof(struct filter_stream));
+  if ((stream == NULL) || !place_ring(arena, &stream->inputs, capacity, input_width)
+      || !place_ring(arena, &stream->outputs, capacity, pipeline->width)
+      || ((stream->discarded = allocate_within(arena, pipeline->width * sizeof(double))) == NULL)) {
+    leave_arena(arena);
+    return NULL;
+  }
+  stream->arena = arena;
+  stream->pipeline = pipeline;
+  atomic_init(&stream->closing, false);
+  atomic_init(&stream->n_pushed, 0);
+  atomic_init(&stream->n_turned_away, 0);
+  atomic_init(&stream->n_filtered, 0);
+  atomic_init(&stream->n_stalls, 0);
+  atomic_init(&stream->peak_backlog, 0);
+  atomic_init(&stream->n_polled, 0);
+  stream->worker = start_native_thread(run_filter_stream, stream);
+  if (stream->worker == NULL) {
+    leave_arena(arena);
+    return NULL;
+  }
+  return stream;
+}
+
+size_t push_filter_stream(struct filter_stream* stream, const double* values, const double* timestamps, size_t n_entries) {
+  struct spsc_ring* inputs = &stream->inputs;
+  size_t room = find_room(inputs, n_entries);
+  size_t n_taken = (n_entries < room)? n_entries : room;
+  size_t head = atomic_load_explicit(&inputs->head, memory_order_relaxed);
+  for (size_t i = 0; i < n_taken; i += 1) {
+    double* slot = locate_slot(inputs, head + i);
+    slot[0] = values[i];
+    if (inputs->width > 1)
+      slot[1] = (timestamps != NULL)? timestamps[i] : 0.0;
+  }
+  publish(&inputs->head, n_taken);
+  tally(&stream->n_pushed, n_taken);
+  tally(&stream->n_turned_away, n_entries - n_taken);
+  return n_taken;
+}
+
+size_t poll_filter_stream(struct filter_stream* stream, double* outputs, size_t n_entries, bool wait) {
+  struct spsc_ring* ring = &stream->outputs;
+  unsigned long long n_outstanding = atomic_load_explicit(&stream->n_pushed, memory_order_relaxed)
+    - atomic_load_explicit(&stream->n_polled, memory_order_relaxed);
+  size_t n_wanted = wait? ((n_outstanding < n_entries)? (size_t)n_outstanding : n_entries) : 0;
+  size_t n_polled = 0;
+  unsigned n_idle_rounds = 0;
+  for (;;) {
+    size_t n_ready = find_entries(ring, n_entries - n_polled);
+    size_t n_taken = (n_ready < n_entries - n_polled)? n_ready : (n_entries - n_polled);
+    copy_out_of_ring(ring, atomic_load_explicit(&ring->tail, memory_order_relaxed), n_taken, outputs + n_polled*ring->width);
+    publish(&ring->tail, n_taken);
+    n_polled += n_taken;
+    if (n_polled >= n_wanted)
+      break;
+    if (n_taken > 0)
+      n_idle_rounds = 0;
+    idle_thread(n_idle_rounds++);
+  }
+  tally(&stream->n_polled, n_polled);
+  return n_polled;
+}
+
+void describe_filter_stream(struct filter_stream* stream, struct stream_statistics* statistics) {
+  *statistics = (struct stream_statistics) {
+    .n_pushed = atomic_load_explicit(&stream->n_pushed, memory_order_relaxed),
+    .n_turned_away = atomic_load_explicit(&stream->n_turned_away, memory_order_relaxed),
+    .n_filtered = atomic_load_explicit(&stream->n_filtered, memory_order_relaxed),
+    .n_polled = atomic_load_explicit(&stream->n_polled, memory_order_relaxed),
+    .n_stalls = atomic_load_explicit(&stream->n_stalls, memory_order_relaxed),
+    .peak_backlog = atomic_load_explicit(&stream->peak_backlog, memory_order_relaxed) };
+}
+
+void close_filter_stream(struct filter_stream* stream) {
+  atomic_store_explicit(&stream->closing, true, memory_order_release);
+  join_native_thread(stream->worker);
+  leave_arena(stream->arena); // the stream itself included
+}
@@ -0,0 +1,83 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "filter.h"
+
+/*
+  Streaming through a pipeline on a worker thread of its own. One producer pushes entries onto
+  an input ring, the worker filters them as they arrive, and one consumer polls the outputs off
+  a second ring. Both rings are lock-free and single-producer/single-consumer: each index is only
+  ever advanced by one side, with release stores paired against acquire loads, and sits on a
+  cache line of its own so that the two sides don't keep stealing it from each other. Each side
+  also keeps a stale copy of the other's index, and only looks again when that copy says the
+  ring is full (or empty), which spares most of the cross-core traffic. The producer and the
+  consumer may well be the same thread.
+
+  Nothing blocks. When the input ring is full, a push takes what fits and says how many, and
+  the rest are counted as turned away. When the output ring is full, the worker stalls until the
+  consumer makes room. Both are tallied in the statistics, so that the capacity can be sized.
+  The worker spins while there is work, and backs off into short naps while there isn't.
+ */
+
+struct spsc_ring {
+  _Alignas(64) _Atomic size_t head; // advanced by the producer, past the last entry written
+  size_t tail_seen; // the producer's stale copy of `tail`
+  _Alignas(64) _Atomic size_t tail; // advanced by the consumer, past the last entry read
+  size_t head_seen; // the consumer's stale copy of `head`
+  _Alignas(64) double* slots; // `width` doubles per entry
+  size_t mask; // the capacity less one, which is a power of two
+  unsigned width;
+};
+
+struct stream_statistics {
+  unsigned long long n_pushed; // entries taken onto the input ring
+  unsigned long long n_turned_away; // entries pushed onto a full input ring, which the producer kept
+  unsigned long long n_filtered; // entries the worker has put through the pipeline
+  unsigned long long n_polled; // entries whose outputs the consumer has taken
+  unsigned long long n_stalls; // times the worker had to wait on a full output ring
+  size_t peak_backlog; // the most entries that have ever sat on the input ring at once
+};
+
+struct filter_stream {
+  struct spsc_ring inputs; // values, interleaved with their timestamps if the pipeline spans time
+  struct spsc_ring outputs;
+  struct filter_pipeline* pipeline; // which the worker has to itself while the stream is open
+  struct native_thread* worker;
+  double* discarded; // a row of outputs for the worker to drop, once closing
+  _Atomic bool closing;
+  _Alignas(64) _Atomic unsigned long long n_pushed; // these three are only ever written by one side each
+  _Atomic unsigned long long n_turned_away;
+  _Alignas(64) _Atomic unsigned long long n_filtered;
+  _Atomic unsigned long long n_stalls;
+  _Atomic size_t peak_backlog;
+  _Alignas(64) _Atomic unsigned long long n_polled;
+  struct arena* arena; // that the stream and both rings were carved out of
+};
+
+struct filter_stream* open_filter_stream(struct filter_pipeline* pipeline, size_t capacity); // rounded up to a power of two. NULL if the memory or the thread could not be had
+size_t push_filter_stream(struct filter_stream* stream, const double* values, const double* timestamps, size_t n_entries); // `timestamps` only for timed pipelines. returns how many were taken
+size_t poll_filter_stream(struct filter_stream* stream, double* outputs, size_t n_entries, bool wait); // up to `n_entries`, `width` outputs apiece. when waiting, until everything pushed so far is in
+void describe_filter_stream(struct filter_stream* stream, struct stream_statistics* statistics);
+void close_filter_stream(struct filter_stream* stream); // stops the worker once it has filtered everything pushed, and leaves the pipeline to the caller. unpolled outputs are dropped
+
+#endif
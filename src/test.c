@@ -17,6 +17,7 @@
 #include "heap.h"
 #include "quantile.h"
 #include "filter.h"
+#include "stream.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -26,11 +27,10 @@
 void test_single_heap(void) {
   struct ring_buffer* queue = create_queue(9);
   struct heap* heap = create_heap(MAX_HEAP, 10, queue);
-  struct heap_element* elem;
   for (double i = 1.0; i < 15.0; i += 1.0) {
-    elem = add_value_to_heap(heap, i);
+    advance_ring_buffer(queue);
     expire_stale_entry_in_queue(queue, 1, heap);
-    register_in_queue(queue, elem);
+    enqueue_value_into_heap(heap, i);
   }
   struct heap_element output;
   for (unsigned i = 0; i < 10; i += 1) {
@@ -46,9 +46,9 @@ void test_multiple_heaps(void) {
   struct heap* heap = heap1;
   for (double i = 1.0; i < 50.0; i += 1.0) {
     heap = heap==heap1? heap2 : heap1;
-    struct heap_element* elem = add_value_to_heap(heap, i);
+    advance_ring_buffer(queue);
     expire_stale_entry_in_queue(queue, 2, heap1, heap2);
-    register_in_queue(queue, elem);
+    enqueue_value_into_heap(heap, i);
   }
   struct heap_element output;
   for (unsigned i = 0; i < 10; i += 1) {
@@ -160,7 +160,74 @@ void test_interpolating_pipeline(void) {
   destroy_filter_pipeline(pipeline);
 }
 
+void test_arena_footprint(void) { // every piece should fit the measured arena exactly, leaving nothing over
+  double quantiles[] = {0.1, 0.5, 0.9};
+  struct interpolation median = {.target_quantile = 0.5, .alpha = 1.0, .beta = 1.0};
+  struct cascade_description descriptions[] = {
+    {.window = 31, .portion = 15, .subsample_rate = 1, .mode = LOW_PASS, .interpolation = NO_INTERPOLATION},
+    {.window = 301, .portion = 100, .subsample_rate = 2, .mode = HIGH_PASS, .interpolation = NO_INTERPOLATION, .arity = 4},
+    {.window = 41, .portion = 20, .subsample_rate = 1, .mode = HIGH_PASS, .interpolation = NO_INTERPOLATION, .engine = TREE_ENGINE},
+    {.window = 501, .portion = 250, .subsample_rate = 1, .mode = LOW_PASS, .interpolation = NO_INTERPOLATION,
+      .engine = COUNTING_ENGINE, .lowest = -100.0, .highest = 100.0},
+    {.window = 10000, .subsample_rate = 1, .mode = HIGH_PASS, .interpolation = median, .error = 0.01},
+    {.duration = 5.0, .subsample_rate = 1, .mode = LOW_PASS, .interpolation = median},
+    {.window = 21, .portion = 10, .subsample_rate = 1, .mode = HAMPEL, .interpolation = NO_INTERPOLATION, .threshold = 3.0},
+    {.window = 51, .subsample_rate = 1, .mode = LOW_PASS, .interpolation = NO_INTERPOLATION,
+      .n_quantiles = 3, .quantiles = quantiles, .tap = true},
+  };
+  unsigned n_filters = sizeof(descriptions) / sizeof(struct cascade_description);
+  struct filter_pipeline* pool[3];
+  for (unsigned n = 1; n <= n_filters; n += 1) {
+    if (!create_filter_pipelines(3, n, descriptions, pool)) {
+      printf("INVALID PIPELINE OF %u STAGES\n", n);
+      continue;
+    }
+    struct arena* arena = pool[0]->arena;
+    printf("%u stages: %zu of %zu bytes carved %s\n", n, arena->used, arena->capacity, (arena->used == arena->capacity)? "exactly" : "WRONG");
+    for (unsigned p = 0; p < 3; p += 1)
+      destroy_filter_pipeline(pool[p]);
+  }
+}
+
+void test_stream(void) { // through a small ring, so that both backpressure and stalls come up, against feeding directly
+  struct cascade_description descriptions[] = {
+    {.window = 31, .portion = 15, .subsample_rate = 2, .mode = LOW_PASS, .interpolation = NO_INTERPOLATION},
+    {.window = 101, .portion = 50, .subsample_rate = 1, .mode = HIGH_PASS, .interpolation = NO_INTERPOLATION},
+  };
+  size_t n_entries = 200000;
+  double* inputs = malloc(n_entries * sizeof(double));
+  double* outputs = malloc(n_entries * sizeof(double));
+  for (size_t i = 0; i < n_entries; i += 1)
+    inputs[i] = (double)rand() / RAND_MAX;
+  struct filter_pipeline* direct = create_filter_pipeline(2, descriptions);
+  struct filter_pipeline* streamed = create_filter_pipeline(2, descriptions);
+  struct filter_stream* stream = open_filter_stream(streamed, 1000);
+  size_t n_pushed = 0, n_polled = 0;
+  while (n_polled < n_entries) {
+    size_t n_offered = (n_entries - n_pushed < 64)? (n_entries - n_pushed) : 64;
+    size_t n_taken = push_filter_stream(stream, inputs + n_pushed, NULL, n_offered);
+    n_pushed += n_taken;
+    n_polled += poll_filter_stream(stream, outputs + n_polled, n_entries - n_polled, n_taken < n_offered); // catch up when pushed back
+  }
+  struct stream_statistics statistics;
+  describe_filter_stream(stream, &statistics);
+  close_filter_stream(stream);
+  size_t n_mismatched = 0;
+  for (size_t i = 0; i < n_entries; i += 1) {
+    double expected = feed_filter_pipeline(direct, inputs[i]);
+    n_mismatched += (expected != outputs[i]) && !(isnan(expected) && isnan(outputs[i]));
+  }
+  printf("streamed %s: %llu turned away, %llu stalls, a backlog of %zu at most\n", (n_mismatched == 0)? "identically" : "WRONG",
+    statistics.n_turned_away, statistics.n_stalls, statistics.peak_backlog);
+  destroy_filter_pipeline(direct);
+  destroy_filter_pipeline(streamed);
+  free(inputs);
+  free(outputs);
+}
+
 int main(void) {
+  test_arena_footprint();
+  test_stream();
   test_quantile();
   stress_test_quantile_for_correctness(3001, 10000);
   //test_interpolating_pipeline();
@@ -0,0 +1,505 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "tree.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <tgmath.h>
+#include <stdbool.h>
+
+#define MINIMUM_LEAF_FILL (ORDER_LEAF_CAPACITY / 2)
+#define MINIMUM_BRANCH_FILL (ORDER_BRANCH_CAPACITY / 2)
+
+static int compare_keys(double value, unsigned tick, double other_value, unsigned other_tick) {
+  if (value < other_value)
+    return -1;
+  if (value > other_value)
+    return 1;
+  int difference = (int)(tick - other_tick); // serial-number arithmetic, so that the ticks may wrap around
+  return (difference > 0) - (difference < 0);
+}
+
+static void create_order_pool(struct order_pool* pool, unsigned size) {
+  pool->size = size;
+  pool->n_used = 0;
+  pool->n_free = 0;
+  pool->free_list = malloc(size * sizeof(unsigned));
+}
+
+// returns the new size if the pool had to grow, or zero otherwise
+static unsigned reserve_in_order_pool(struct order_pool* pool, unsigned* index) {
+  if (pool->n_free > 0) {
+    *index = pool->free_list[--pool->n_free];
+    return 0;
+  }
+  *index = pool->n_used++;
+  if (pool->n_used <= pool->size)
+    return 0;
+  pool->size *= 2;
+  pool->free_list = realloc(pool->free_list, pool->size * sizeof(unsigned));
+  return pool->size;
+}
+
+static void release_to_order_pool(struct order_pool* pool, unsigned index) {
+  pool->free_list[pool->n_free++] = index;
+}
+
+static unsigned allocate_leaf(struct order_tree* tree) {
+  unsigned index;
+  unsigned new_size = reserve_in_order_pool(&tree->leaf_pool, &index);
+  if (new_size > 0)
+    tree->leaves = realloc(tree->leaves, new_size * sizeof(struct order_leaf));
+  tree->leaves[index].n_entries = 0;
+  return index;
+}
+
+static unsigned allocate_branch(struct order_tree* tree) {
+  unsigned index;
+  unsigned new_size = reserve_in_order_pool(&tree->branch_pool, &index);
+  if (new_size > 0)
+    tree->branches = realloc(tree->branches, new_size * sizeof(struct order_branch));
+  tree->branches[index].n_children = 0;
+  return index;
+}
+
+static void save_order_pool(struct order_pool* pool, struct state_stream* stream) {
+  WRITE_STATE(stream, pool->n_used);
+  WRITE_STATE(stream, pool->n_free);
+  write_state(stream, pool->free_list, pool->n_free * sizeof(unsigned));
+}
+
+// returns the new size if the pool had to grow to take the saved one, or zero otherwise
+static unsigned restore_order_pool(struct order_pool* pool, size_t node_size, struct state_stream* stream) {
+  unsigned n_used = 0, n_free = 0;
+  READ_STATE(stream, n_used);
+  READ_STATE(stream, n_free);
+  if ((n_free > n_used) || !has_room_for(stream, n_used, node_size)) // a tree that never outgrew its root leaf has no branches at all
+    stream->failed = true;
+  if (stream->failed)
+    return 0;
+  unsigned new_size = 0;
+  if (n_used > pool->size) {
+    pool->size = n_used;
+    pool->free_list = realloc(pool->free_list, n_used * sizeof(unsigned));
+    new_size = n_used;
+  }
+  pool->n_used = n_used;
+  pool->n_free = n_free;
+  read_state(stream, pool->free_list, n_free * sizeof(unsigned));
+  return new_size;
+}
+
+struct order_tree* create_order_tree(unsigned expected_entries) {
+  struct order_tree* tree = malloc(sizeof(struct order_tree));
+  // leaves stay at least half full, so this many suffice for a tree of `expected_entries`
+  unsigned n_leaves = expected_entries/MINIMUM_LEAF_FILL + 2;
+  unsigned n_branches = n_leaves/(MINIMUM_BRANCH_FILL - 1) + 2;
+  create_order_pool(&tree->leaf_pool, n_leaves);
+  create_order_pool(&tree->branch_pool, n_branches);
+  tree->leaves = malloc(n_leaves * sizeof(struct order_leaf));
+  tree->branches = malloc(n_branches * sizeof(struct order_branch));
+  tree->height = 0;
+  tree->n_entries = 0;
+  tree->root = allocate_leaf(tree);
+  return tree;
+}
+
+void clear_order_tree(struct order_tree* tree) {
+  tree->leaf_pool.n_used = tree->leaf_pool.n_free = 0;
+  tree->branch_pool.n_used = tree->branch_pool.n_free = 0;
+  tree->height = 0;
+  tree->n_entries = 0;
+  tree->root = allocate_leaf(tree);
+}
+
+void destroy_order_tree(struct order_tree* tree) {
+  free(tree->leaves);
+  free(tree->branches);
+  free(tree->leaf_pool.free_list);
+  free(tree->branch_pool.free_list);
+  free(tree);
+}
+
+void save_order_tree(struct order_tree* tree, struct state_stream* stream) {
+  WRITE_STATE(stream, tree->root);
+  WRITE_STATE(stream, tree->height);
+  WRITE_STATE(stream, tree->n_entries);
+  save_order_pool(&tree->leaf_pool, stream);
+  save_order_pool(&tree->branch_pool, stream);
+  write_state(stream, tree->leaves, tree->leaf_pool.n_used * sizeof(struct order_leaf)); // freed nodes and all, so that the indices hold
+  write_state(stream, tree->branches, tree->branch_pool.n_used * sizeof(struct order_branch));
+}
+
+void restore_order_tree(struct order_tree* tree, struct state_stream* stream) {
+  READ_STATE(stream, tree->root);
+  READ_STATE(stream, tree->height);
+  READ_STATE(stream, tree->n_entries);
+  unsigned new_size = restore_order_pool(&tree->leaf_pool, sizeof(struct order_leaf), stream);
+  if (new_size > 0)
+    tree->leaves = realloc(tree->leaves, new_size * sizeof(struct order_leaf));
+  new_size = restore_order_pool(&tree->branch_pool, sizeof(struct order_branch), stream);
+  if (new_size > 0)
+    tree->branches = realloc(tree->branches, new_size * sizeof(struct order_branch));
+  if (stream->failed)
+    return;
+  read_state(stream, tree->leaves, tree->leaf_pool.n_used * sizeof(struct order_leaf));
+  read_state(stream, tree->branches, tree->branch_pool.n_used * sizeof(struct order_branch));
+  if (tree->root >= ((tree->height == 0)? tree->leaf_pool.n_used : tree->branch_pool.n_used))
+    stream->failed = true;
+}
+
+// the first position whose key is no less than the given one
+static unsigned search_leaf(struct order_leaf* leaf, double value, unsigned tick) {
+  unsigned low = 0, high = leaf->n_entries;
+  while (low < high) {
+    unsigned middle = (low + high) / 2;
+    if (compare_keys(leaf->values[middle], leaf->ticks[middle], value, tick) < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+// the last child whose lower bound does not exceed the key. the first child's bound is implicit
+static unsigned route_through_branch(struct order_branch* branch, double value, unsigned tick) {
+  unsigned low = 1, high = branch->n_children; // find the first bound that exceeds the key
+  while (low < high) {
+    unsigned middle = (low + high) / 2;
+    if (compare_keys(branch->lower_values[middle], branch->lower_ticks[middle], value, tick) <= 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low - 1;
+}
+
+static unsigned count_beneath(struct order_tree* tree, unsigned node, unsigned height) {
+  if (height == 0)
+    return tree->leaves[node].n_entries;
+  struct order_branch* branch = tree->branches + node;
+  unsigned count = 0;
+  for (unsigned i = 0; i < branch->n_children; i += 1)
+    count += branch->counts[i];
+  return count;
+}
+
+static void insert_into_leaf(struct order_leaf* leaf, unsigned position, double value, unsigned tick) {
+  unsigned n_after = leaf->n_entries - position;
+  memmove(leaf->values + position + 1, leaf->values + position, n_after * sizeof(double));
+  memmove(leaf->ticks + position + 1, leaf->ticks + position, n_after * sizeof(unsigned));
+  leaf->values[position] = value;
+  leaf->ticks[position] = tick;
+  leaf->n_entries += 1;
+}
+
+static void insert_child_into_branch(struct order_branch* branch, unsigned position,
+    unsigned child, unsigned count, double lower_value, unsigned lower_tick) {
+  unsigned n_after = branch->n_children - position;
+  memmove(branch->children + position + 1, branch->children + position, n_after * sizeof(unsigned));
+  memmove(branch->counts + position + 1, branch->counts + position, n_after * sizeof(unsigned));
+  memmove(branch->lower_values + position + 1, branch->lower_values + position, n_after * sizeof(double));
+  memmove(branch->lower_ticks + position + 1, branch->lower_ticks + position, n_after * sizeof(unsigned));
+  branch->children[position] = child;
+  branch->counts[position] = count;
+  branch->lower_values[position] = lower_value;
+  branch->lower_ticks[position] = lower_tick;
+  branch->n_children += 1;
+}
+
+static void remove_child_from_branch(struct order_branch* branch, unsigned position) {
+  unsigned n_after = branch->n_children - position - 1;
+  memmove(branch->children + position, branch->children + position + 1, n_after * sizeof(unsigned));
+  memmove(branch->counts + position, branch->counts + position + 1, n_after * sizeof(unsigned));
+  memmove(branch->lower_values + position, branch->lower_values + position + 1, n_after * sizeof(double));
+  memmove(branch->lower_ticks + position, branch->lower_ticks + position + 1, n_after * sizeof(unsigned));
+  branch->n_children -= 1;
+}
+
+/*
+  Splits happen on the way back up, so a node that overflows hands its upper half to a
+  fresh sibling. Returns that sibling's index (and its lower bound through `split_value`
+  and `split_tick`), or the sentinel `(unsigned)-1` when nothing split.
+ */
+static unsigned insert_beneath(struct order_tree* tree, unsigned node, unsigned height,
+    double value, unsigned tick, double* split_value, unsigned* split_tick) {
+  if (height == 0) {
+    struct order_leaf* leaf = tree->leaves + node;
+    unsigned position = search_leaf(leaf, value, tick);
+    if (leaf->n_entries < ORDER_LEAF_CAPACITY) {
+      insert_into_leaf(leaf, position, value, tick);
+      return (unsigned)-1;
+    }
+    unsigned sibling_index = allocate_leaf(tree);
+    leaf = tree->leaves + node; // the pool may have moved
+    struct order_leaf* sibling = tree->leaves + sibling_index;
+    unsigned half = ORDER_LEAF_CAPACITY / 2;
+    memcpy(sibling->values, leaf->values + half, (ORDER_LEAF_CAPACITY - half) * sizeof(double));
+    memcpy(sibling->ticks, leaf->ticks + half, (ORDER_LEAF_CAPACITY - half) * sizeof(unsigned));
+    sibling->n_entries = ORDER_LEAF_CAPACITY - half;
+    leaf->n_entries = half;
+    if (position <= half)
+      insert_into_leaf(leaf, position, value, tick);
+    else
+      insert_into_leaf(sibling, position - half, value, tick);
+    *split_value = sibling->values[0];
+    *split_tick = sibling->ticks[0];
+    return sibling_index;
+  }
+  struct order_branch* branch = tree->branches + node;
+  unsigned i = route_through_branch(branch, value, tick);
+  branch->counts[i] += 1;
+  double child_value;
+  unsigned child_tick;
+  unsigned child_sibling = insert_beneath(tree, branch->children[i], height - 1,
+    value, tick, &child_value, &child_tick);
+  if (child_sibling == (unsigned)-1)
+    return (unsigned)-1;
+  branch = tree->branches + node; // the pool may have moved
+  unsigned sibling_count = count_beneath(tree, child_sibling, height - 1);
+  branch->counts[i] -= sibling_count;
+  if (branch->n_children < ORDER_BRANCH_CAPACITY) {
+    insert_child_into_branch(branch, i + 1, child_sibling, sibling_count, child_value, child_tick);
+    return (unsigned)-1;
+  }
+  unsigned sibling_index = allocate_branch(tree);
+  branch = tree->branches + node;
+  struct order_branch* sibling = tree->branches + sibling_index;
+  unsigned half = ORDER_BRANCH_CAPACITY / 2;
+  unsigned n_moved = ORDER_BRANCH_CAPACITY - half;
+  memcpy(sibling->children, branch->children + half, n_moved * sizeof(unsigned));
+  memcpy(sibling->counts, branch->counts + half, n_moved * sizeof(unsigned));
+  memcpy(sibling->lower_values, branch->lower_values + half, n_moved * sizeof(double));
+  memcpy(sibling->lower_ticks, branch->lower_ticks + half, n_moved * sizeof(unsigned));
+  sibling->n_children = n_moved;
+  branch->n_children = half;
+  if (i + 1 <= half)
+    insert_child_into_branch(branch, i + 1, child_sibling, sibling_count, child_value, child_tick);
+  else
+    insert_child_into_branch(sibling, i + 1 - half, child_sibling, sibling_count, child_value, child_tick);
+  *split_value = sibling->lower_values[0];
+  *split_tick = sibling->lower_ticks[0];
+  return sibling_index;
+}
+
+void insert_into_order_tree(struct order_tree* tree, double value, unsigned tick) {
+  double split_value;
+  unsigned split_tick;
+  unsigned sibling = insert_beneath(tree, tree->root, tree->height, value, tick, &split_value, &split_tick);
+  tree->n_entries += 1;
+  if (sibling == (unsigned)-1)
+    return;
+  unsigned old_root = tree->root;
+  unsigned old_count = count_beneath(tree, old_root, tree->height);
+  unsigned sibling_count = count_beneath(tree, sibling, tree->height);
+  unsigned root = allocate_branch(tree);
+  struct order_branch* branch = tree->branches + root;
+  branch->n_children = 2;
+  branch->children[0] = old_root;
+  branch->counts[0] = old_count;
+  branch->lower_values[0] = -INFINITY; // never consulted
+  branch->lower_ticks[0] = 0;
+  branch->children[1] = sibling;
+  branch->counts[1] = sibling_count;
+  branch->lower_values[1] = split_value;
+  branch->lower_ticks[1] = split_tick;
+  tree->root = root;
+  tree->height += 1;
+}
+
+/*
+  Mends the child at `i` after it fell below half capacity, either by borrowing one
+  entry (or grandchild) from an adjacent sibling or by merging with it when neither can
+  spare anything.
+ */
+static void mend_underflow(struct order_tree* tree, struct order_branch* parent, unsigned i, unsigned child_height) {
+  bool from_left = (i > 0);
+  unsigned left_slot = from_left? (i - 1) : i; // the pair (left_slot, left_slot + 1) is what we work on
+  unsigned right_slot = left_slot + 1;
+  unsigned left_node = parent->children[left_slot], right_node = parent->children[right_slot];
+  if (child_height == 0) {
+    struct order_leaf* left = tree->leaves + left_node;
+    struct order_leaf* right = tree->leaves + right_node;
+    struct order_leaf* donor = from_left? left : right;
+    if (donor->n_entries > MINIMUM_LEAF_FILL) {
+      if (from_left) {
+        unsigned last = left->n_entries - 1;
+        insert_into_leaf(right, 0, left->values[last], left->ticks[last]);
+        left->n_entries -= 1;
+      } else {
+        left->values[left->n_entries] = right->values[0];
+        left->ticks[left->n_entries] = right->ticks[0];
+        left->n_entries += 1;
+        right->n_entries -= 1;
+        memmove(right->values, right->values + 1, right->n_entries * sizeof(double));
+        memmove(right->ticks, right->ticks + 1, right->n_entries * sizeof(unsigned));
+      }
+      parent->counts[left_slot] = left->n_entries;
+      parent->counts[right_slot] = right->n_entries;
+      parent->lower_values[right_slot] = right->values[0];
+      parent->lower_ticks[right_slot] = right->ticks[0];
+      return;
+    }
+    memcpy(left->values + left->n_entries, right->values, right->n_entries * sizeof(double));
+    memcpy(left->ticks + left->n_entries, right->ticks, right->n_entries * sizeof(unsigned));
+    left->n_entries += right->n_entries;
+    parent->counts[left_slot] = left->n_entries;
+    remove_child_from_branch(parent, right_slot);
+    release_to_order_pool(&tree->leaf_pool, right_node);
+    return;
+  }
+  struct order_branch* left = tree->branches + left_node;
+  struct order_branch* right = tree->branches + right_node;
+  struct order_branch* donor = from_left? left : right;
+  // the separator in the parent is the implicit lower bound of the right node's first child
+  right->lower_values[0] = parent->lower_values[right_slot];
+  right->lower_ticks[0] = parent->lower_ticks[right_slot];
+  if (donor->n_children > MINIMUM_BRANCH_FILL) {
+    if (from_left) {
+      unsigned last = left->n_children - 1;
+      insert_child_into_branch(right, 0, left->children[last], left->counts[last],
+        left->lower_values[last], left->lower_ticks[last]);
+      left->n_children -= 1;
+      parent->counts[left_slot] -= right->counts[0];
+      parent->counts[right_slot] += right->counts[0];
+    } else {
+      unsigned end = left->n_children;
+      left->children[end] = right->children[0];
+      left->counts[end] = right->counts[0];
+      left->lower_values[end] = right->lower_values[0];
+      left->lower_ticks[end] = right->lower_ticks[0];
+      left->n_children += 1;
+      parent->counts[left_slot] += right->counts[0];
+      parent->counts[right_slot] -= right->counts[0];
+      remove_child_from_branch(right, 0);
+    }
+    parent->lower_values[right_slot] = right->lower_values[0];
+    parent->lower_ticks[right_slot] = right->lower_ticks[0];
+    return;
+  }
+  unsigned end = left->n_children;
+  memcpy(left->children + end, right->children, right->n_children * sizeof(unsigned));
+  memcpy(left->counts + end, right->counts, right->n_children * sizeof(unsigned));
+  memcpy(left->lower_values + end, right->lower_values, right->n_children * sizeof(double));
+  memcpy(left->lower_ticks + end, right->lower_ticks, right->n_children * sizeof(unsigned));
+  left->n_children += right->n_children;
+  parent->counts[left_slot] += parent->counts[right_slot];
+  remove_child_from_branch(parent, right_slot);
+  release_to_order_pool(&tree->branch_pool, right_node);
+}
+
+static bool remove_beneath(struct order_tree* tree, unsigned node, unsigned height, double value, unsigned tick) {
+  if (height == 0) {
+    struct order_leaf* leaf = tree->leaves + node;
+    unsigned position = search_leaf(leaf, value, tick);
+    if ((position == leaf->n_entries)
+        || (compare_keys(leaf->values[position], leaf->ticks[position], value, tick) != 0))
+      return false;
+    leaf->n_entries -= 1;
+    unsigned n_after = leaf->n_entries - position;
+    memmove(leaf->values + position, leaf->values + position + 1, n_after * sizeof(double));
+    memmove(leaf->ticks + position, leaf->ticks + position + 1, n_after * sizeof(unsigned));
+    return true;
+  }
+  struct order_branch* branch = tree->branches + node;
+  unsigned i = route_through_branch(branch, value, tick);
+  unsigned child = branch->children[i];
+  if (!remove_beneath(tree, child, height - 1, value, tick))
+    return false;
+  branch->counts[i] -= 1;
+  bool underflowed = (height == 1)?
+    (tree->leaves[child].n_entries < MINIMUM_LEAF_FILL)
+    : (tree->branches[child].n_children < MINIMUM_BRANCH_FILL);
+  if (underflowed)
+    mend_underflow(tree, branch, i, height - 1);
+  return true;
+}
+
+bool remove_from_order_tree(struct order_tree* tree, double value, unsigned tick) {
+  if (!remove_beneath(tree, tree->root, tree->height, value, tick))
+    return false;
+  tree->n_entries -= 1;
+  if ((tree->height > 0) && (tree->branches[tree->root].n_children == 1)) { // shrink from the top
+    unsigned old_root = tree->root;
+    tree->root = tree->branches[old_root].children[0];
+    tree->height -= 1;
+    release_to_order_pool(&tree->branch_pool, old_root);
+  }
+  return true;
+}
+
+double select_from_order_tree(struct order_tree* tree, unsigned rank) {
+  if (rank >= tree->n_entries)
+    return NAN;
+  unsigned node = tree->root;
+  for (unsigned height = tree->height; height > 0; height -= 1) {
+    struct order_branch* branch = tree->branches + node;
+    unsigned i = 0;
+    while (rank >= branch->counts[i]) {
+      rank -= branch->counts[i];
+      i += 1;
+    }
+    node = branch->children[i];
+  }
+  return tree->leaves[node].values[rank];
+}
+
+// checks fill, counts, and ordering. every key beneath must lie within [lower, upper)
+static bool verify_beneath(struct order_tree* tree, unsigned node, unsigned height, bool is_root,
+    const double* lower_value, const unsigned* lower_tick,
+    const double* upper_value, const unsigned* upper_tick, unsigned* count) { // NULL bounds are open
+  if (height == 0) {
+    struct order_leaf* leaf = tree->leaves + node;
+    if (!is_root && (leaf->n_entries < MINIMUM_LEAF_FILL))
+      return false;
+    for (unsigned i = 0; i < leaf->n_entries; i += 1) {
+      if ((lower_value != NULL) && (compare_keys(leaf->values[i], leaf->ticks[i], *lower_value, *lower_tick) < 0))
+        return false;
+      if ((upper_value != NULL) && (compare_keys(leaf->values[i], leaf->ticks[i], *upper_value, *upper_tick) >= 0))
+        return false;
+      if ((i > 0) && (compare_keys(leaf->values[i-1], leaf->ticks[i-1], leaf->values[i], leaf->ticks[i]) >= 0))
+        return false;
+    }
+    *count = leaf->n_entries;
+    return true;
+  }
+  struct order_branch* branch = tree->branches + node;
+  if (branch->n_children < (is_root? 2 : MINIMUM_BRANCH_FILL))
+    return false;
+  *count = 0;
+  for (unsigned i = 0; i < branch->n_children; i += 1) {
+    unsigned child_count;
+    bool last = (i+1 == branch->n_children);
+    if (!verify_beneath(tree, branch->children[i], height - 1, false,
+        (i > 0)? (branch->lower_values + i) : lower_value,
+        (i > 0)? (branch->lower_ticks + i) : lower_tick,
+        last? upper_value : (branch->lower_values + i + 1),
+        last? upper_tick : (branch->lower_ticks + i + 1), &child_count))
+      return false;
+    if (child_count != branch->counts[i])
+      return false;
+    *count += child_count;
+  }
+  return true;
+}
+
+bool verify_order_tree(struct order_tree* tree) {
+  unsigned count;
+  if (!verify_beneath(tree, tree->root, tree->height, true, NULL, NULL, NULL, NULL, &count))
+    return false;
+  return count == tree->n_entries;
+}
@@ -0,0 +1,77 @@
+/*
+  Copyright 2021 Myrl Marmarelis
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef TREE_H
+#define TREE_H
+
+#include <stdbool.h>
+#include "state.h"
+
+/*
+  An order-statistic B+tree for windows far larger than the cache. Entries live in wide
+  leaves that are scanned contiguously, and every branch records how many entries sit
+  beneath each of its children, so that the k-th smallest entry is found in one descent.
+  Nodes are addressed by 32-bit indices into two pools rather than by pointers.
+
+  Equal values are told apart by the serial number (`tick`) of their arrival, compared
+  modulo 2^32, which keeps every key unique as long as fewer than 2^31 entries coexist.
+ */
+
+#define ORDER_LEAF_CAPACITY 64
+#define ORDER_BRANCH_CAPACITY 32
+
+struct order_leaf {
+  unsigned n_entries;
+  double values[ORDER_LEAF_CAPACITY];
+  unsigned ticks[ORDER_LEAF_CAPACITY];
+};
+
+struct order_branch {
+  unsigned n_children;
+  unsigned children[ORDER_BRANCH_CAPACITY];
+  unsigned counts[ORDER_BRANCH_CAPACITY]; // number of entries beneath each child
+  double lower_values[ORDER_BRANCH_CAPACITY]; // every key beneath a child is no less than its lower bound
+  unsigned lower_ticks[ORDER_BRANCH_CAPACITY];
+};
+
+struct order_pool { // grows on demand. indices stay valid across reallocations
+  unsigned size;
+  unsigned n_used;
+  unsigned n_free;
+  unsigned* free_list;
+};
+
+struct order_tree {
+  unsigned root;
+  unsigned height; // zero when the root is a leaf
+  unsigned n_entries;
+  struct order_pool leaf_pool;
+  struct order_pool branch_pool;
+  struct order_leaf* leaves;
+  struct order_branch* branches;
+};
+
+struct order_tree* create_order_tree(unsigned expected_entries); // only a hint for the initial pools
+void insert_into_order_tree(struct order_tree* tree, double value, unsigned tick);
+bool remove_from_order_tree(struct order_tree* tree, double value, unsigned tick); // false if the key was absent
+double select_from_order_tree(struct order_tree* tree, unsigned rank); // zero-based; NaN when out of range
+bool verify_order_tree(struct order_tree* tree);
+void save_order_tree(struct order_tree* tree, struct state_stream* stream);
+void restore_order_tree(struct order_tree* tree, struct state_stream* stream); // into any tree, whose pools grow to fit
+void clear_order_tree(struct order_tree* tree); // empties it, but keeps the pools as large as they grew
+void destroy_order_tree(struct order_tree* tree);
+
+#endif